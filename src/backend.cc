@@ -6,8 +6,10 @@
 #include <chrono>
 #include <cmath>   // for exp
 #include <cstdio>  // for snprintf
-#include <deque>   // for deque
-#include <map>     // for multimap
+#include <memory>  // for unique_ptr
+#include <new>     // for placement new
+#include <set>     // for set
+#include <vector>  // for vector
 #include <algorithm>
 
 #include "vm/vm.h"
@@ -47,46 +49,170 @@ std::chrono::milliseconds gametick_to_time(int ticks) {
 
 namespace {
 
-// Global structure to holding all events to be executed on gameticks.
-using TickQueue = std::multimap<decltype(g_current_gametick), TickEvent*, std::less<>>;
-TickQueue g_tick_queue;
+/*
+ * Gametick events live in a hierarchical timing wheel rather than a sorted
+ * container, so scheduling is O(1) no matter how many call_outs are
+ * pending.
+ *
+ * There are kWheelLevels levels of kWheelSlots slots each. An event due on
+ * tick `when` sits on the level of the highest kWheelBits-wide group of
+ * bits in which `when` differs from the wheel's current tick, in the slot
+ * given by that group of `when`. Level 0 therefore holds exactly the events
+ * due in the current 64-tick span, one slot per tick. Whenever the clock
+ * enters a new span of some level, the one slot of that level covering it
+ * is re-filed into the levels below.
+ *
+ * Each slot is a FIFO list. Events due on the same tick always share a
+ * slot, and re-filing keeps their relative order, so they run in the order
+ * they were added -- the ordering call_out.cc relies on, as with the old
+ * multimap.
+ */
+constexpr int kWheelBits = 6;
+constexpr int kWheelSlots = 1 << kWheelBits;
+constexpr int kWheelLevels = (64 + kWheelBits - 1) / kWheelBits;
 
-// Call all events for current tick
-inline void call_tick_events() {
-  // Skip if nothing to do.
-  if (g_tick_queue.empty() || g_tick_queue.begin()->first > g_current_gametick) {
+struct TickSlot {
+  TickEvent* head = nullptr;
+  TickEvent* tail = nullptr;
+};
+
+TickSlot g_tick_wheel[kWheelLevels][kWheelSlots];
+// The tick the wheel is laid out relative to. Only differs from
+// g_current_gametick when something set the clock directly (see
+// sync_tick_wheel()).
+uint64_t g_wheel_tick;
+
+// Storage for pooled TickEvents: allocated in chunks and recycled through a
+// free list, instead of a heap allocation per call_out()/heart_beat tick.
+struct alignas(TickEvent) TickEventStorage {
+  unsigned char bytes[sizeof(TickEvent)];
+};
+const int TICK_EVENT_CHUNK = 256;
+std::vector<std::unique_ptr<TickEventStorage[]>> g_tick_event_chunks;
+std::vector<TickEventStorage*> g_free_tick_events;
+
+TickEvent* new_pooled_tick_event(TickEvent::callback_type& callback) {
+  if (g_free_tick_events.empty()) {
+    auto& chunk = g_tick_event_chunks.emplace_back(new TickEventStorage[TICK_EVENT_CHUNK]);
+    for (int i = TICK_EVENT_CHUNK - 1; i >= 0; i--) {
+      g_free_tick_events.push_back(&chunk[i]);
+    }
+  }
+  auto* storage = g_free_tick_events.back();
+  g_free_tick_events.pop_back();
+  auto* event = new (storage) TickEvent(callback);
+  event->pooled = true;
+  return event;
+}
+
+void free_tick_event(TickEvent* event) {
+  if (!event->pooled) {
+    delete event;
     return;
   }
-  // Loop until there are no more events to run.
-  //
-  // NOTE: some event, like call_out(0), will add event to tick_queue during
-  // callback, We need to keep looping until there isn't any eligible events
-  // left.
-  while (true) {
-    std::deque<TickEvent*> all_events;
-    auto iter_end = g_tick_queue.upper_bound(g_current_gametick);
-    // No more eligible events.
-    if (iter_end == g_tick_queue.begin()) {
-      break;
-    }
-    auto iter_start = g_tick_queue.begin();
+  event->~TickEvent();
+  g_free_tick_events.push_back(reinterpret_cast<TickEventStorage*>(event));
+}
 
-    // Extract all eligible events
-    all_events.clear();
-    for (auto iter = iter_start; iter != iter_end; iter++) {
-      all_events.push_back(iter->second);
-    }
-    g_tick_queue.erase(iter_start, iter_end);
+void tick_slot_push(TickSlot& slot, TickEvent* event) {
+  event->next = nullptr;
+  if (slot.tail) {
+    slot.tail->next = event;
+  } else {
+    slot.head = event;
+  }
+  slot.tail = event;
+}
 
-    // TODO: randomly shuffle the events
+// Detach and return the whole list of a slot.
+TickEvent* tick_slot_take(TickSlot& slot) {
+  auto* head = slot.head;
+  slot.head = slot.tail = nullptr;
+  return head;
+}
+
+// File an event relative to g_wheel_tick; overdue events run on the
+// current tick.
+void tick_wheel_insert(TickEvent* event) {
+  if (event->when < g_wheel_tick) {
+    event->when = g_wheel_tick;
+  }
+  auto diff = event->when ^ g_wheel_tick;
+  int level = 0;
+  while (diff >= kWheelSlots) {
+    diff >>= kWheelBits;
+    level++;
+  }
+  auto slot = (event->when >> (level * kWheelBits)) & (kWheelSlots - 1);
+  tick_slot_push(g_tick_wheel[level][slot], event);
+}
+
+// Move the wheel on to the next tick, re-filing the higher-level slot (if
+// any) whose span starts there. Only the level of the lowest non-zero bit
+// group can have one: every lower level's span just started over at slot 0,
+// which holds nothing that isn't already overdue.
+void tick_wheel_advance() {
+  g_wheel_tick++;
+  auto tick = g_wheel_tick;
+  int level = 0;
+  while (level < kWheelLevels - 1 && (tick & (kWheelSlots - 1)) == 0) {
+    tick >>= kWheelBits;
+    level++;
+  }
+  if (level == 0) {
+    return;
+  }
+  auto* event = tick_slot_take(g_tick_wheel[level][tick & (kWheelSlots - 1)]);
+  while (event) {
+    auto* next = event->next;
+    tick_wheel_insert(event);
+    event = next;
+  }
+}
 
-    for (auto* event : all_events) {
-      backend_dispose_tick_event(event);
+// Re-file every pending event if g_current_gametick was moved by something
+// other than backend_run_one_gametick() (backend() resets it at startup,
+// tests jump it around). Rare, so simply O(n).
+void sync_tick_wheel() {
+  if (g_wheel_tick == g_current_gametick) {
+    return;
+  }
+  std::vector<TickEvent*> pending;
+  for (auto& level : g_tick_wheel) {
+    for (auto& slot : level) {
+      for (auto* event = tick_slot_take(slot); event; event = event->next) {
+        pending.push_back(event);
+      }
     }
   }
+  // Same-tick events share a slot, so a stable sort keeps their order.
+  std::stable_sort(pending.begin(), pending.end(),
+                   [](const TickEvent* a, const TickEvent* b) { return a->when < b->when; });
+  g_wheel_tick = g_current_gametick;
+  for (auto* event : pending) {
+    tick_wheel_insert(event);
+  }
 }
 
-void look_for_objects_to_swap();
+// Call all events for current tick
+inline void call_tick_events() {
+  sync_tick_wheel();
+  // NOTE: some event, like call_out(0), will add event to the current tick
+  // during callback; they are appended to this same slot and run in this
+  // loop too.
+  auto& slot = g_tick_wheel[0][g_wheel_tick & (kWheelSlots - 1)];
+  while (slot.head) {
+    auto* event = slot.head;
+    slot.head = event->next;
+    if (!slot.head) {
+      slot.tail = nullptr;
+    }
+    // TODO: randomly shuffle the events
+    backend_dispose_tick_event(event);
+  }
+}
+
+void sweep_objects_due();
 
 }  // namespace
 
@@ -94,23 +220,29 @@ void backend_dispose_tick_event(TickEvent* event) {
   if (event->valid) {
     event->callback();
   }
-  delete event;
+  free_tick_event(event);
 }
 
 TickEvent* add_gametick_event(int delay_ticks, TickEvent::callback_type callback) {
-  auto* event = new TickEvent(callback);
-  g_tick_queue.insert(TickQueue::value_type(g_current_gametick + delay_ticks, event));
+  sync_tick_wheel();
+  auto* event = new_pooled_tick_event(callback);
+  event->when = g_current_gametick + std::max(delay_ticks, 0);
+  tick_wheel_insert(event);
   return event;
 }
 
 void clear_tick_events() {
   int i = 0;
-  if (!g_tick_queue.empty()) {
-    for (auto& iter : g_tick_queue) {
-      delete iter.second;
-      i++;
+  for (auto& level : g_tick_wheel) {
+    for (auto& slot : level) {
+      auto* event = tick_slot_take(slot);
+      while (event) {
+        auto* next = event->next;
+        free_tick_event(event);
+        event = next;
+        i++;
+      }
     }
-    g_tick_queue.clear();
   }
   i += clear_walltime_events();
   debug_message("clear_tick_events: %d leftover events cleared.\n", i);
@@ -128,14 +260,14 @@ void call_remove_destructed_objects() {
 void backend_run_one_gametick() {
   call_tick_events();
   g_current_gametick++;
+  tick_wheel_advance();
 }
 
 // Register the driver's recurring maintenance events. Called once at
 // startup by the per-target backend() implementation.
 void backend_register_tick_events() {
   add_gametick_event(0, TickEvent::callback_type(call_heart_beat));
-  add_gametick_event(time_to_next_gametick(std::chrono::minutes(5)),
-                     TickEvent::callback_type(look_for_objects_to_swap));
+  add_gametick_event(1, TickEvent::callback_type(sweep_objects_due));
   add_gametick_event(time_to_next_gametick(std::chrono::minutes(30)),
                      TickEvent::callback_type([] { return reclaim_objects(true); }));
 #ifdef PACKAGE_MUDLIB_STATS
@@ -148,132 +280,193 @@ void backend_register_tick_events() {
 
 namespace {
 /*
- * Despite the name, this routine takes care of several things.
- * It will run once every 5 minutes.
+ * Reset and clean_up sweep.
  *
- * . It will loop through all objects.
+ * Objects with O_WILL_RESET/O_WILL_CLEAN_UP are kept in g_sweep_index,
+ * ordered by the gametick their next reset() or clean_up() can be due on
+ * (object_t::sweep_due). Every gametick, sweep_objects_due() takes objects
+ * off the front of the index until it reaches one that isn't due yet or
+ * the 'reset and clean up budget usec' runs out; whatever is left over is
+ * picked up on the next tick. So resets and clean_ups are spread over the
+ * ticks they fall due on instead of all arriving in one walk of obj_list.
  *
- *   . If an object is found in a state of not having done reset, and the
- *     delay to next reset has passed, then reset() will be done.
- *
- *   . If the object has a existed more than the time limit given for swapping,
- *     then 'clean_up' will first be called in the object
- *
- * There are some problems if the object self-destructs in clean_up, so
- * special care has to be taken of how the linked list is used.
+ * The index only has to be exact about next_reset/next_cleanup, which
+ * change in few places (see sweep_schedule_object() callers). time_of_ref
+ * changes on every apply; an object touched since it was filed is simply
+ * found not ready when it comes up and is filed again.
  */
-void look_for_objects_to_swap() {
+std::set<std::pair<uint64_t, object_t*>> g_sweep_index;
+
+// How long to wait before looking again at an object whose reset is
+// overdue but which hasn't been touched since its last reset
+// (O_RESET_STATE): the old full sweep's period.
+uint64_t sweep_recheck_ticks() { return time_to_next_gametick(std::chrono::minutes(5)); }
+
+// The gametick `ob` next needs looking at, or UINT64_MAX for never.
+uint64_t sweep_deadline(object_t* ob) {
+  uint64_t due = UINT64_MAX;
+  if (!CONFIG_INT(__RC_NO_RESETS__) && !CONFIG_INT(__RC_LAZY_RESETS__) &&
+      (ob->flags & O_WILL_RESET)) {
+    due = std::max<int64_t>(ob->next_reset, 0);
+    if (due <= g_current_gametick && (ob->flags & O_RESET_STATE)) {
+      due = g_current_gametick + sweep_recheck_ticks();
+    }
+  }
   auto time_to_clean_up = CONFIG_INT(__TIME_TO_CLEAN_UP__);
+  if (time_to_clean_up > 0 && (ob->flags & O_WILL_CLEAN_UP)) {
+    uint64_t clean_up_due =
+        ob->next_cleanup > 0
+            ? ob->next_cleanup
+            : ob->time_of_ref + time_to_next_gametick(std::chrono::seconds(time_to_clean_up));
+    due = std::min(due, clean_up_due);
+  }
+  return due;
+}
+
+// File `ob` under `due` (UINT64_MAX: drop it). sweep_due 0 means "not
+// filed", so due ticks are stored as at least 1.
+void sweep_file_object(object_t* ob, uint64_t due) {
+  due = std::max<uint64_t>(due, 1);
+  if (ob->sweep_due == due) {
+    return;
+  }
+  if (ob->sweep_due) {
+    g_sweep_index.erase({ob->sweep_due, ob});
+    ob->sweep_due = 0;
+  }
+  if (due != UINT64_MAX) {
+    g_sweep_index.emplace(due, ob);
+    ob->sweep_due = due;
+  }
+}
 
-  /* Next time is in 5 minutes */
-  add_gametick_event(time_to_next_gametick(std::chrono::seconds(5 * 60)),
-                     TickEvent::callback_type(look_for_objects_to_swap));
+/*
+ * Call reset() and/or clean_up() in `ob` if they are due.
+ */
+void sweep_object(object_t* ob) {
+  auto time_to_clean_up = CONFIG_INT(__TIME_TO_CLEAN_UP__);
+  int ready_for_clean_up = 0;
 
-  object_t *ob, *next_ob, *last_good_ob;
   /*
-   * Objects object can be destructed, which means that next object to
-   * investigate is saved in next_ob. If very unlucky, that object can be
-   * destructed too. In that case, the loop is simply restarted.
+   * Check reference time before reset() is called. An explicit
+   * deadline from set_clean_up() overrides the idle-time rule.
    */
-  next_ob = obj_list;
-  last_good_ob = obj_list;
-  while (true) {
-    while ((ob = (object_t*)next_ob)) {
-      int ready_for_clean_up = 0;
-
+  if (ob->next_cleanup > 0) {
+    if (g_current_gametick >= ob->next_cleanup) {
+      ready_for_clean_up = 1;
+      /* one-shot: after the deadline fires, revert to the idle rule */
+      ob->next_cleanup = 0;
+    }
+  } else if (gametick_to_time(g_current_gametick - ob->time_of_ref) >=
+             std::chrono::seconds(time_to_clean_up)) {
+    ready_for_clean_up = 1;
+  }
+  if (!CONFIG_INT(__RC_NO_RESETS__) && !CONFIG_INT(__RC_LAZY_RESETS__)) {
+    /*
+     * Should this object have reset(1) called ?
+     */
+    if ((ob->flags & O_WILL_RESET) && (g_current_gametick >= ob->next_reset) &&
+        !(ob->flags & O_RESET_STATE)) {
+      debug(d_flag, "RESET /%s\n", ob->obname);
+      reset_object(ob);
       if (ob->flags & O_DESTRUCTED) {
-        if (last_good_ob->flags & O_DESTRUCTED) {
-          ob = obj_list; /* restart */
-        } else {
-          ob = (object_t*)last_good_ob;
-        }
+        return;
       }
-      next_ob = ob->next_all;
+    }
+  }
+  if (time_to_clean_up > 0) {
+    /*
+     * Has enough time passed, to give the object a chance to
+     * self-destruct ? Save the O_RESET_STATE, which will be cleared.
+     *
+     * Only call clean_up in objects that has defined such a function.
+     *
+     * Only if the clean_up returns a non-zero value, will it be called
+     * again.
+     */
+
+    if (ready_for_clean_up && (ob->flags & O_WILL_CLEAN_UP)) {
+      int const save_reset_state = ob->flags & O_RESET_STATE;
 
       /*
-       * Check reference time before reset() is called. An explicit
-       * deadline from set_clean_up() overrides the idle-time rule.
+       * Set O_RESET_STATE during the apply so LAZY_RESETS' try_reset()
+       * doesn't fire an overdue reset() on an object that may be about to
+       * destruct; the pending reset fires on the next real touch instead.
        */
-      if (ob->next_cleanup > 0) {
-        if (g_current_gametick >= ob->next_cleanup) {
-          ready_for_clean_up = 1;
-          /* one-shot: after the deadline fires, revert to the idle rule */
-          ob->next_cleanup = 0;
-        }
-      } else if (gametick_to_time(g_current_gametick - ob->time_of_ref) >=
-                 std::chrono::seconds(time_to_clean_up)) {
-        ready_for_clean_up = 1;
-      }
-      if (!CONFIG_INT(__RC_NO_RESETS__) && !CONFIG_INT(__RC_LAZY_RESETS__)) {
-        /*
-         * Should this object have reset(1) called ?
-         */
-        if ((ob->flags & O_WILL_RESET) && (g_current_gametick >= ob->next_reset) &&
-            !(ob->flags & O_RESET_STATE)) {
-          debug(d_flag, "RESET /%s\n", ob->obname);
-          reset_object(ob);
-          if (ob->flags & O_DESTRUCTED) {
-            continue;
-          }
-        }
-      }
-      if (time_to_clean_up > 0) {
-        /*
-         * Has enough time passed, to give the object a chance to
-         * self-destruct ? Save the O_RESET_STATE, which will be cleared.
-         *
-         * Only call clean_up in objects that has defined such a function.
-         *
-         * Only if the clean_up returns a non-zero value, will it be called
-         * again.
-         */
-
-        if (ready_for_clean_up && (ob->flags & O_WILL_CLEAN_UP)) {
-          int const save_reset_state = ob->flags & O_RESET_STATE;
-
-          /*
-           * Set O_RESET_STATE during the apply so LAZY_RESETS' try_reset()
-           * doesn't fire an overdue reset() on an object that may be about to
-           * destruct; the pending reset fires on the next real touch instead.
-           */
-          ob->flags |= O_RESET_STATE;
-
-          debug(d_flag, "clean up /%s\n", ob->obname);
-
-          /*
-           * Supply a flag to the object that says if this program is
-           * inherited by other objects. Cloned objects might as well
-           * believe they are not inherited. Swapped objects will not
-           * have a ref count > 1 (and will have an invalid ob->prog
-           * pointer).
-           *
-           * Note that if it is in the apply_low cache, it will also
-           * get a flag of 1, which may cause the mudlib not to clean
-           * up the object.  This isn't bad because:
-           * (1) one expects it is rare for objects that have untouched
-           * long enough to clean_up to still be in the cache, especially
-           * on busy MUDs.
-           * (2) the ones that are are the more heavily used ones, so
-           * keeping them around seems justified.
-           */
-
-          push_number(ob->flags & (O_CLONE) ? 0 : ob->prog->ref);
-          set_eval(max_eval_cost);
-          auto* svp = safe_apply(APPLY_CLEAN_UP, ob, 1, ORIGIN_DRIVER);
-          if (!svp || (svp->type == T_NUMBER && svp->u.number == 0)) {
-            ob->flags &= ~O_WILL_CLEAN_UP;
-          }
-          ob->flags = (ob->flags & ~O_RESET_STATE) | save_reset_state;
-        }
+      ob->flags |= O_RESET_STATE;
+
+      debug(d_flag, "clean up /%s\n", ob->obname);
+
+      /*
+       * Supply a flag to the object that says if this program is
+       * inherited by other objects. Cloned objects might as well
+       * believe they are not inherited. Swapped objects will not
+       * have a ref count > 1 (and will have an invalid ob->prog
+       * pointer).
+       *
+       * Note that if it is in the apply_low cache, it will also
+       * get a flag of 1, which may cause the mudlib not to clean
+       * up the object.  This isn't bad because:
+       * (1) one expects it is rare for objects that have untouched
+       * long enough to clean_up to still be in the cache, especially
+       * on busy MUDs.
+       * (2) the ones that are are the more heavily used ones, so
+       * keeping them around seems justified.
+       */
+
+      push_number(ob->flags & (O_CLONE) ? 0 : ob->prog->ref);
+      set_eval(max_eval_cost);
+      auto* svp = safe_apply(APPLY_CLEAN_UP, ob, 1, ORIGIN_DRIVER);
+      if (!svp || (svp->type == T_NUMBER && svp->u.number == 0)) {
+        ob->flags &= ~O_WILL_CLEAN_UP;
       }
-      last_good_ob = ob;
+      ob->flags = (ob->flags & ~O_RESET_STATE) | save_reset_state;
     }
-    break;
   }
-} /* look_for_objects_to_swap() */
+} /* sweep_object() */
+
+/*
+ * Runs every gametick: reset() and clean_up() the objects that are due,
+ * within the configured time budget. At least one object is handled per
+ * tick, so a budget smaller than one apply still makes progress.
+ */
+void sweep_objects_due() {
+  add_gametick_event(1, TickEvent::callback_type(sweep_objects_due));
+
+  auto const budget = std::chrono::microseconds(CONFIG_INT(__RC_SWEEP_BUDGET_USEC__));
+  auto const start = std::chrono::steady_clock::now();
+  while (!g_sweep_index.empty() && g_sweep_index.begin()->first <= g_current_gametick) {
+    auto* ob = g_sweep_index.begin()->second;
+    g_sweep_index.erase(g_sweep_index.begin());
+    ob->sweep_due = 0;
+
+    // Hold a ref: the object may destruct itself in reset()/clean_up().
+    add_ref(ob, "sweep_objects_due");
+    sweep_object(ob);
+    if (!(ob->flags & O_DESTRUCTED)) {
+      // Never again this tick, whatever the object did to its deadlines.
+      sweep_file_object(ob, std::max(sweep_deadline(ob), g_current_gametick + 1));
+    }
+    free_object(&ob, "sweep_objects_due");
+
+    if (budget.count() > 0 && std::chrono::steady_clock::now() - start >= budget) {
+      break;
+    }
+  }
+} /* sweep_objects_due() */
 
 }  // namespace
 
+void sweep_schedule_object(object_t* ob) {
+  if (ob->flags & O_DESTRUCTED) {
+    sweep_unschedule_object(ob);
+    return;
+  }
+  sweep_file_object(ob, sweep_deadline(ob));
+}
+
+void sweep_unschedule_object(object_t* ob) { sweep_file_object(ob, UINT64_MAX); }
+
 namespace {
 // TODO: Figure out what to do with this.
 const int K_NUM_CONST = 5;
@@ -2,6 +2,7 @@
 #define BACKEND_H
 
 #include <chrono>
+#include <cstdint>
 #include <functional>
 
 /*
@@ -28,6 +29,13 @@ struct TickEvent {
   using callback_type = std::function<void()>;
   callback_type callback;
 
+  // Gametick bookkeeping, owned by backend.cc: the tick the event is due
+  // on, its link in the timing wheel slot, and whether its storage came
+  // from the event pool (wall-time events are plain new/delete).
+  uint64_t when{0};
+  TickEvent* next{nullptr};
+  bool pooled{false};
+
   TickEvent(callback_type& callback) : callback(callback) {}
 };
 
@@ -61,6 +69,13 @@ int clear_walltime_events();
 // call.
 double wasm_backend_advance(double now_ms);
 
+// Reset/clean_up sweep: (re)file an object under its next reset() or
+// clean_up() deadline. Call after changing next_reset, next_cleanup or
+// O_WILL_RESET/O_WILL_CLEAN_UP; time_of_ref changes are picked up lazily.
+void sweep_schedule_object(struct object_t*);
+// Drop an object from the sweep; called on destruct.
+void sweep_unschedule_object(struct object_t*);
+
 // Util to help translate gameticks with time.
 int time_to_next_gametick(std::chrono::milliseconds msec);
 std::chrono::milliseconds gametick_to_time(int ticks);
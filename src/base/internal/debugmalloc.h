@@ -75,6 +75,9 @@ static const int TAG_SOCKETS = (TAG_PERMANENT + 39);
 // allocate_object_variables) -- separate from the object_t allocation
 // so recompile_object() can swap programs with a different variable count.
 static const int TAG_OBJ_VARS = (TAG_PERMANENT + 40);
+// A connection's input buffer (interactive_t::text) -- separate from the
+// interactive_t allocation so it can grow and shrink with pending input.
+static const int TAG_INPUT_BUF = (TAG_PERMANENT + 41);
 // Compile-arena chunks (compiler/internal/scratchpad.cc): retained across
 // compiles by design -- whitelisted in check_all_blocks like the other
 // persistent driver infrastructure.
@@ -94,10 +94,13 @@ const FlagEntry INT_FLAGS[] = {
      "Maximum number of bytes a single read_bytes()/write_bytes() call may transfer."},
     {"maximum read file size", __MAX_READ_FILE_SIZE__, 1 << 18, 0, INT_MAX, "Limits",
      "Maximum size, in bytes, of a file that read_file() may read."},
+    {"maximum input buffer size", __RC_MAX_INPUT_BUFFER_SIZE__, 1 << 20, 512, INT_MAX, "Limits",
+     "Maximum size, in bytes, a connection's input buffer may grow to while a command is "
+     "incomplete; longer commands are discarded."},
 
     {"hash table size", __SHARED_STRING_HASH_TABLE_SIZE__, 65536, 7001, INT_MAX, "Hash Tables",
-     "Size of the shared-string hash table; should be prime, roughly 1/5 of the number of distinct "
-     "strings."},
+     "Initial number of slots in the shared-string table, rounded up to a power of 2; the table "
+     "grows by itself as strings are added."},
     {"object table size", __OBJECT_HASH_TABLE_SIZE__, 4096, 1024, INT_MAX, "Hash Tables",
      "Size of the object hash table; roughly 1/4 of the number of objects in the game."},
     {"living hash table size", __LIVING_HASH_TABLE_SIZE__, 256, 256, INT_MAX, "Hash Tables",
@@ -107,6 +110,10 @@ const FlagEntry INT_FLAGS[] = {
      "Granularity of in-game time in milliseconds (the shortest visible time interval)."},
     {"heartbeat interval msec", __RC_HEARTBEAT_INTERVAL_MSEC__, 1000, 0, INT_MAX,
      "Timing & Lifecycle", "Heartbeat interval in milliseconds."},
+    {"reset and clean up budget usec", __RC_SWEEP_BUDGET_USEC__, 2000, 0, INT_MAX,
+     "Timing & Lifecycle",
+     "Microseconds per gametick spent calling reset() and clean_up() on objects that are due; "
+     "the rest wait for the next gametick. 0 means no limit."},
     {"sane explode string", __RC_SANE_EXPLODE_STRING__, 1, 0, INT_MAX, "Language Behavior",
      "explode() strips at most one leading delimiter (and still one trailing delimiter)."},
     {"reversible explode string", __RC_REVERSIBLE_EXPLODE_STRING__, 0, 0, INT_MAX,
@@ -190,6 +197,12 @@ const FlagEntry INT_FLAGS[] = {
      "Advertise and enable the MSP telnet protocol."},
     {"enable msdp", __RC_ENABLE_MSDP__, 0, 0, INT_MAX, "Protocol Support",
      "Advertise and enable the MSDP telnet protocol."},
+    {"async worker threads", __RC_ASYNC_WORKER_THREADS__, 4, 1, 1024, "Performance",
+     "Maximum number of worker threads serving async_read(), async_write(), async_getdir() and "
+     "async_db_exec() (package_async); threads are started as requests queue up."},
+    {"async io_uring", __RC_ASYNC_IO_URING__, 0, 0, 1, "Performance",
+     "Serve async_read() and plain async_write() through io_uring, submitted and reaped on the "
+     "main loop (Linux only); falls back to the worker threads where io_uring is unavailable."},
 };
 
 /*
@@ -257,6 +270,11 @@ const StrFlagEntry STR_FLAGS[] = {
      "Security",
      "Colon-separated allow-list of environment variable names that set_os_env() may modify "
      "(package_contrib); these are implicitly readable. Empty (the default) denies all writes."},
+    {"program cache directory", __RC_PROGRAM_CACHE_DIR__, kOptional, "config file: pcd",
+     "Performance",
+     "Directory (absolute, or relative to the mudlib directory) where compiled programs are "
+     "cached on disk so later boots can skip recompiling unchanged files. Empty (the default) "
+     "disables the cache."},
 };
 
 bool scan_config_line(const char* fmt, void* dest, int required) {
@@ -47,3 +47,7 @@ uint64_t total_mapping_nodes = 0;
 uint64_t apply_cache_lookups = 0;
 uint64_t apply_cache_hits = 0;
 uint64_t apply_cache_items = 0;
+uint64_t apply_cache_slots = 0;
+uint64_t apply_tables = 0;
+uint64_t apply_tables_shared = 0;
+uint64_t apply_site_hits = 0;
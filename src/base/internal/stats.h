@@ -46,6 +46,10 @@ extern uint64_t num_mappings, total_mapping_size, total_mapping_nodes;
 extern uint64_t apply_cache_lookups;
 extern uint64_t apply_cache_hits;
 extern uint64_t apply_cache_items;
+extern uint64_t apply_cache_slots;
+extern uint64_t apply_tables;
+extern uint64_t apply_tables_shared;
+extern uint64_t apply_site_hits;
 
 // string allocation stats
 extern uint64_t num_distinct_strings;
@@ -17,6 +17,10 @@
 
 #include <fmt/format.h>
 
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
 /* used temporarily by SVALUE_STRLEN() */
 unsigned int svalue_strlen_size;
 
@@ -45,8 +49,8 @@ void bp(void) {}
  * that is, if you want to avoid space leaks...
  *
  * Current overhead:
- *      sizeof(block_t) per string (string pointer, next pointer, and a short
- *  for refs). Strings are nearly all fairly short, so this is a significant
+ *      sizeof(block_t) per string (hash, size and a short for refs), and
+ *  a pointer and a control byte per table slot. Strings are nearly all fairly short, so this is a significant
  *  overhead - there is also the 4 byte malloc overhead and the fact that
  *  malloc generally allocates blocks which are a power of 2 (should write my
  *      own best-fit malloc specialised to strings); then again, GNU malloc
@@ -71,98 +75,272 @@ uint64_t allocd_bytes = 0;
 uint64_t search_len = 0;
 uint64_t num_str_searches = 0;
 
-#define StrHash(s) (std::hash<std::string_view>{}(std::string_view(s)) & (htable_size_minus_one))
+/*
+ * The table is open-addressed, in the style of a "Swiss table": the strings'
+ * block_t pointers sit in one flat array, and beside it a control byte per
+ * slot holds either 7 bits of the string's hash or one of the markers
+ * below. A lookup examines a whole group of 16 control bytes at once (one
+ * SSE2 compare where available) and only touches the strings whose bits
+ * match, so a miss rarely reads a string at all and a hit rarely reads more
+ * than one. Groups are aligned and probed quadratically; a probe ends at the
+ * first group with an empty slot, so the table never fills past 7/8.
+ *
+ * The full 32 bit hash is kept in the block (HASH()), so growing never
+ * rehashes a string: a larger table is allocated and the old one is drained
+ * into it a group at a time by later inserts and removals, rather than all
+ * at once. Until it is empty, lookups also probe the old table.
+ */
 
-#define hfindblock(s, h) sfindblock(s, (h) = StrHash(s))
-#define findblock(s) sfindblock(s, StrHash(s))
+namespace {
 
-static block_t* sfindblock(const char* /*s*/, int /*h*/);
+constexpr uint8_t kEmpty = 0x80;
+constexpr uint8_t kDeleted = 0xfe;  // tombstone: the probe goes on
+constexpr uint32_t kGroupSize = 16;
 
-/*
- * hash table - list of pointers to heads of string chains.
- * Each string in chain has a pointer to the next string and a
- * reference count (char *, int) stored just before the start of the string.
- * HTABLE_SIZE is in config.h, and should be a prime, probably between
- * 1000 and 5000.
- */
+struct string_table_t {
+  block_t** slots;
+  uint8_t* ctrl;      // one per slot, in the same allocation as slots
+  uint32_t capacity;  // power of two, at least kGroupSize
+  uint32_t live;
+  uint32_t used;  // live + tombstones
+};
+
+string_table_t str_table;      // every insert goes here
+string_table_t old_str_table;  // while growing: being drained into str_table
+uint32_t drain_group;          // next old_str_table group to move
+
+// Groups probed per lookup: 1, 2, 3, 4, 5-8, more.
+uint64_t probe_hist[6];
+uint64_t table_bytes;
+
+inline uint32_t str_hash(const char* s) {
+  return static_cast<uint32_t>(std::hash<std::string_view>{}(std::string_view(s)));
+}
+
+inline uint8_t hash_tag(uint32_t hash) { return hash >> 25; }
+
+// Bit i is set for each control byte i in the group equal to `tag`.
+#ifdef __SSE2__
+inline uint32_t group_match(const uint8_t* group, uint8_t tag) {
+  __m128i const ctrl = _mm_loadu_si128(reinterpret_cast<const __m128i*>(group));
+  return _mm_movemask_epi8(_mm_cmpeq_epi8(ctrl, _mm_set1_epi8(static_cast<char>(tag))));
+}
+
+// Empty or deleted: both markers have the top bit set, no tag does.
+inline uint32_t group_match_free(const uint8_t* group) {
+  return _mm_movemask_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(group)));
+}
+#else
+inline uint32_t group_match(const uint8_t* group, uint8_t tag) {
+  uint32_t mask = 0;
+  for (uint32_t i = 0; i < kGroupSize; i++) {
+    mask |= static_cast<uint32_t>(group[i] == tag) << i;
+  }
+  return mask;
+}
+
+inline uint32_t group_match_free(const uint8_t* group) {
+  uint32_t mask = 0;
+  for (uint32_t i = 0; i < kGroupSize; i++) {
+    mask |= static_cast<uint32_t>(group[i] >> 7) << i;
+  }
+  return mask;
+}
+#endif
+
+// Calls found(slot) for each slot whose tag matches `hash`, in probe order,
+// until it returns true; returns that slot, or -1 once an empty slot shows
+// the string is not there. Counts the groups it looked at in *groups.
+template <typename F>
+int64_t probe(const string_table_t& t, uint32_t hash, F found, uint32_t* groups) {
+  uint32_t const group_mask = t.capacity / kGroupSize - 1;
+  uint8_t const tag = hash_tag(hash);
+  uint32_t g = hash & group_mask;
+  for (uint32_t step = 1;; step++) {
+    const uint8_t* ctrl = t.ctrl + g * kGroupSize;
+    for (uint32_t m = group_match(ctrl, tag); m; m &= m - 1) {
+      uint32_t const slot = g * kGroupSize + __builtin_ctz(m);
+      if (found(slot)) {
+        *groups += step;
+        return slot;
+      }
+    }
+    if (group_match(ctrl, kEmpty)) {
+      *groups += step;
+      return -1;
+    }
+    g = (g + step) & group_mask;
+  }
+}
+
+void alloc_table(string_table_t* t, uint32_t capacity) {
+  size_t const size = capacity * (sizeof(block_t*) + 1);
+  t->slots = reinterpret_cast<block_t**>(DMALLOC(size, TAG_STR_TBL, "alloc_table"));
+  t->ctrl = reinterpret_cast<uint8_t*>(t->slots + capacity);
+  memset(t->ctrl, kEmpty, capacity);
+  t->capacity = capacity;
+  t->live = t->used = 0;
+  table_bytes += size;
+}
+
+void free_table(string_table_t* t) {
+  table_bytes -= t->capacity * (sizeof(block_t*) + 1);
+  FREE(t->slots);
+  *t = string_table_t{};
+}
+
+void insert_block(string_table_t* t, block_t* b) {
+  uint32_t const group_mask = t->capacity / kGroupSize - 1;
+  uint32_t g = HASH(b) & group_mask;
+  for (uint32_t step = 1;; step++) {
+    uint32_t const m = group_match_free(t->ctrl + g * kGroupSize);
+    if (m) {
+      uint32_t const slot = g * kGroupSize + __builtin_ctz(m);
+      if (t->ctrl[slot] == kEmpty) {
+        t->used++;
+      }
+      t->ctrl[slot] = hash_tag(HASH(b));
+      t->slots[slot] = b;
+      t->live++;
+      return;
+    }
+    g = (g + step) & group_mask;
+  }
+}
+
+void remove_slot(string_table_t* t, uint32_t slot) {
+  t->live--;
+  // A probe only ever passes a group that has no empty slot, so if this
+  // one still has one, no probe needs the slot to stay a tombstone.
+  if (group_match(t->ctrl + slot / kGroupSize * kGroupSize, kEmpty)) {
+    t->ctrl[slot] = kEmpty;
+    t->used--;
+  } else {
+    t->ctrl[slot] = kDeleted;
+  }
+}
+
+// Moves one group of old_str_table into str_table, freeing it after the last.
+void drain_step() {
+  const uint8_t* ctrl = old_str_table.ctrl + drain_group * kGroupSize;
+  for (uint32_t m = group_match_free(ctrl) ^ 0xffff; m; m &= m - 1) {
+    uint32_t const slot = drain_group * kGroupSize + __builtin_ctz(m);
+    insert_block(&str_table, old_str_table.slots[slot]);
+    old_str_table.ctrl[slot] = kDeleted;
+    old_str_table.live--;
+  }
+  if (++drain_group == old_str_table.capacity / kGroupSize) {
+    free_table(&old_str_table);
+  }
+}
+
+// Makes room for one more string. Doubles the table, or rebuilds it at the
+// same size if it is mostly tombstones. Draining one group per insert
+// empties the old table well before the new one can fill up.
+void reserve_one() {
+  if (old_str_table.slots) {
+    drain_step();
+  }
+  if (str_table.used + 1 <= str_table.capacity / 8 * 7) {
+    return;
+  }
+  while (old_str_table.slots) {
+    drain_step();
+  }
+  uint32_t capacity = str_table.capacity;
+  if (str_table.live + 1 > capacity / 16 * 7) {
+    capacity *= 2;
+  }
+  old_str_table = str_table;
+  drain_group = 0;
+  alloc_table(&str_table, capacity);
+  drain_step();
+}
+
+// Finds the slot holding `b` itself, in str_table or else old_str_table.
+string_table_t* find_slot(block_t* b, int64_t* slot) {
+  uint32_t groups = 0;
+  auto const is_b = [&](string_table_t* t) {
+    return [=](uint32_t i) { return t->slots[i] == b; };
+  };
+  if ((*slot = probe(str_table, HASH(b), is_b(&str_table), &groups)) >= 0) {
+    return &str_table;
+  }
+  if (old_str_table.slots &&
+      (*slot = probe(old_str_table, HASH(b), is_b(&old_str_table), &groups)) >= 0) {
+    return &old_str_table;
+  }
+  return nullptr;
+}
 
-static block_t** base_table = (block_t**)nullptr;
-static int htable_size;
-static int htable_size_minus_one;
+}  // namespace
 
-static block_t* alloc_new_shared_string(const char* /*string*/, int /*h*/, const char* /*why*/);
+static block_t* findblock(const char* s, uint32_t h);
+static block_t* alloc_new_shared_string(const char* /*string*/, uint32_t /*h*/,
+                                        const char* /*why*/);
 
 void init_strings() {
-  int x, y;
+  uint32_t y, size;
 
   // Idempotent: a real driver process calls this exactly once (vm_init()),
   // but a second call anywhere -- reachable in practice from a test binary
   // that hosts both a lightweight, no-full-boot compiler harness and a
   // real driver boot in the same process -- would otherwise silently
-  // reallocate base_table, orphaning every shared string interned so far
+  // reallocate the table, orphaning every shared string interned so far
   // (still live, valid memory, just unreachable from the fresh table) with
   // no free/migration. The first free_string() of one of those orphaned
   // strings then fails its "is this still in the table" sanity check and
   // aborts the process. Skip rather than orphan: whichever call happens
   // first wins, matching the invariant the driver already relies on.
-  if (base_table) {
+  if (str_table.slots) {
     debug_message("init_strings: called again, ignoring (already initialized).\n");
     return;
   }
 
-  /* ensure that htable size is a power of 2 */
+  /* the initial size; a power of 2, and a whole number of groups */
   y = CONFIG_INT(__SHARED_STRING_HASH_TABLE_SIZE__);
   /* Cap the round-up at 2^30: a larger configured value would shift past
      2^31 and overflow signed int (UB), spinning this loop forever at boot. */
-  for (htable_size = 1; htable_size < y && htable_size < (1 << 30); htable_size <<= 1) {
+  for (size = kGroupSize; size < y && size < (1u << 30); size <<= 1) {
   }
-  CONFIG_INT(__SHARED_STRING_HASH_TABLE_SIZE__) = htable_size;
+  CONFIG_INT(__SHARED_STRING_HASH_TABLE_SIZE__) = size;
 
-  htable_size_minus_one = htable_size - 1;
-  base_table = reinterpret_cast<block_t**>(
-      DCALLOC(htable_size, sizeof(block_t*), TAG_STR_TBL, "init_strings"));
-  overhead_bytes += (sizeof(block_t*) * htable_size);
-
-  for (x = 0; x < htable_size; x++) {
-    base_table[x] = nullptr;
-  }
+  alloc_table(&str_table, size);
 }
 
 /*
  * Looks for a string in the table.  If it finds it, returns a pointer to
- * the start of the string part, and moves the entry for the string to
- * the head of the pointer chain.  One thing (blech!) - puts the previous
- * pointer on the hash chain into fs_prev.
+ * its block.  A lookup never writes to the table.
  */
 
-static block_t* sfindblock(const char* s, int h) {
-  block_t *curr, *prev;
+static block_t* findblock(const char* s, uint32_t h) {
+  uint32_t groups = 0;
+  auto const same = [&](const string_table_t& t) {
+    return [&, h](uint32_t i) {
+      block_t* b = t.slots[i];
+      return HASH(b) == h && !strcmp(STRING(b), s);
+    };
+  };
+
+  block_t* found = nullptr;
+  int64_t slot = probe(str_table, h, same(str_table), &groups);
+  if (slot >= 0) {
+    found = str_table.slots[slot];
+  } else if (old_str_table.slots &&
+             (slot = probe(old_str_table, h, same(old_str_table), &groups)) >= 0) {
+    found = old_str_table.slots[slot];
+  }
 
-  curr = base_table[h];
-  prev = nullptr;
   num_str_searches++;
-
-  while (curr) {
-    search_len++;
-
-    if (*(STRING(curr)) == *s && !strcmp(STRING(curr), s)) { /* found it */
-      if (prev) {                                            /* not at head of list */
-        NEXT(prev) = NEXT(curr);
-        NEXT(curr) = base_table[h];
-        base_table[h] = curr;
-      }
-      return (curr); /* pointer to string */
-    }
-    prev = curr;
-    curr = NEXT(curr);
-  }
-  return ((block_t*)nullptr); /* not found */
+  search_len += groups;
+  probe_hist[groups <= 4 ? groups - 1 : groups <= 8 ? 4 : 5]++;
+  return found;
 }
 
 const char* findstring(const char* s) {
   block_t* b;
 
-  if ((b = findblock(s))) {
+  if ((b = findblock(s, str_hash(s)))) {
     return STRING(b);
   }
   return (nullptr);
@@ -170,7 +348,7 @@ const char* findstring(const char* s) {
 
 /* alloc_new_string: Make a space for a string.  */
 
-static block_t* alloc_new_shared_string(const char* string, int h, const char* why) {
+static block_t* alloc_new_shared_string(const char* string, uint32_t h, const char* why) {
   auto max_string_length = CONFIG_INT(__MAX_STRING_LENGTH__);
 
   block_t* b;
@@ -188,16 +366,16 @@ static block_t* alloc_new_shared_string(const char* string, int h, const char* w
   [len] = '\0'; /* strncpy doesn't put on \0 if 'from' too
                  * long */
   if (cut) {
-    h = StrHash(STRING(b));
+    h = str_hash(STRING(b));
   }
   SIZE(b) = (len > UINT_MAX ? UINT_MAX : len);
   REFS(b) = 1;
   b->ascii = MSTR_ASCII_UNKNOWN;  // computed lazily on first EGC query
   md_record_ref_journal(PTR_TO_NODET(b), true, b->refs,
                         "alloc_new_shared_string: " + std::string(why));
-  NEXT(b) = base_table[h];
   HASH(b) = h;
-  base_table[h] = b;
+  reserve_one();
+  insert_block(&str_table, b);
   ADD_NEW_STRING(SIZE(b), sizeof(block_t));
   ADD_STRING(SIZE(b));
   return (b);
@@ -205,9 +383,9 @@ static block_t* alloc_new_shared_string(const char* string, int h, const char* w
 
 const char* int_make_shared_string(const char* str, const char* desc) {
   block_t* b;
-  int h;
+  uint32_t const h = str_hash(str);
 
-  b = hfindblock(str, h); /* hfindblock macro sets h = StrHash(s) */
+  b = findblock(str, h);
   if (!b) {
     b = alloc_new_shared_string(str, h, desc);
   } else {
@@ -230,8 +408,8 @@ const char* int_ref_string(const char* str, const char* desc) {
   block_t* b;
 
   b = BLOCK(str);
-  DEBUG_CHECK1(b != findblock(str), "stralloc.c: called ref_string on non-shared string: %s.\n",
-               str);
+  DEBUG_CHECK1(b != findblock(str, str_hash(str)),
+               "stralloc.c: called ref_string on non-shared string: %s.\n", str);
   if (REFS(b)) {
     REFS(b)++;
     md_record_ref_journal(PTR_TO_NODET(b), true, b->refs, "ref_string: " + std::string(desc));
@@ -248,12 +426,13 @@ const char* int_ref_string(const char* str, const char* desc) {
  */
 
 void int_free_string(const char* str, const char* desc) {
-  block_t **prev, *b;
-  int h;
+  block_t* b;
+  string_table_t* t;
+  int64_t slot;
 
   b = BLOCK(str);
-  DEBUG_CHECK1(b != findblock(str), "stralloc.c: free_string called on non-shared string: %s.\n",
-               str);
+  DEBUG_CHECK1(b != findblock(str, str_hash(str)),
+               "stralloc.c: free_string called on non-shared string: %s.\n", str);
 
   /*
    * if a string has been ref'd USHRT_MAX times then we assume that its used
@@ -272,18 +451,14 @@ void int_free_string(const char* str, const char* desc) {
     return;
   }
 
-  // h = StrHash(str);
-  h = HASH(BLOCK(str));
-  prev = base_table + h;
-  while ((b = *prev)) {
-    if (STRING(b) == str) {
-      *prev = NEXT(b);
-      break;
-    }
-    prev = &(NEXT(b));
+  t = find_slot(b, &slot);
+  DEBUG_CHECK1(!t, "free_string: not found in string table! (\"%s\")\n", str);
+  if (t) {
+    remove_slot(t, slot);
+  }
+  if (old_str_table.slots) {
+    drain_step();
   }
-
-  DEBUG_CHECK1(!b, "free_string: not found in string table! (\"%s\")\n", str);
 
   SUB_NEW_STRING(SIZE(b), sizeof(block_t));
   FREE(b);
@@ -291,20 +466,15 @@ void int_free_string(const char* str, const char* desc) {
 }
 
 void deallocate_string(char* str) {
-  int h;
-  block_t *b, **prev;
-
-  // h = StrHash(str);
-  h = HASH(BLOCK(str));
-  prev = base_table + h;
-  while ((b = *prev)) {
-    if (STRING(b) == str) {
-      *prev = NEXT(b);
-      break;
-    }
-    prev = &(NEXT(b));
+  block_t* b = BLOCK(str);
+  string_table_t* t;
+  int64_t slot;
+
+  t = find_slot(b, &slot);
+  DEBUG_CHECK1(!t, "stralloc.c: deallocate_string called on non-shared string: %s.\n", str);
+  if (t) {
+    remove_slot(t, slot);
   }
-  DEBUG_CHECK1(!b, "stralloc.c: deallocate_string called on non-shared string: %s.\n", str);
   // printf("freeing string: %s\n", str);
   FREE(b);
 }
@@ -316,25 +486,30 @@ uint64_t add_string_status(outbuffer_t* out, int verbose) {
   }
   if (verbose != -1) {
     outbuf_addv(out, "%-20s %8" PRIu64 " %8" PRIu64 " + %" PRIu64 " overhead\n", "All strings",
-                num_distinct_strings, bytes_distinct_strings, overhead_bytes);
+                num_distinct_strings, bytes_distinct_strings, overhead_bytes + table_bytes);
   }
   if (verbose == 1) {
     outbuf_addv(out, "Total asked for\t\t\t%8" PRIu64 " %8" PRIu64 "\n", allocd_strings,
                 allocd_bytes);
     outbuf_addv(out, "Space actually required/total string bytes %f%%\n",
-                static_cast<double>(bytes_distinct_strings + overhead_bytes) * 100 / allocd_bytes);
-    outbuf_addv(out, "Searches: %" PRIu64 "\tAverage search length: %6.3f\n", num_str_searches,
+                static_cast<double>(bytes_distinct_strings + overhead_bytes + table_bytes) * 100 /
+                    allocd_bytes);
+    outbuf_addv(out, "Searches: %" PRIu64 "\tAverage groups probed: %6.3f\n", num_str_searches,
                 static_cast<double>(search_len) / num_str_searches);
-
-    auto load_factor = num_distinct_strings * 1.0 / htable_size;
-    outbuf_addv(out, "Table size: %d, Load factor: %f\n", htable_size, load_factor);
-    if (load_factor > 0.75) {
-      outbuf_addv(
-          out,
-          "String pool is overloaded, please consider increase in the config 'hash table size'!\n");
+    outbuf_addv(out,
+                "Groups probed:\t1: %" PRIu64 "  2: %" PRIu64 "  3: %" PRIu64 "  4: %" PRIu64
+                "  5-8: %" PRIu64 "  9+: %" PRIu64 "\n",
+                probe_hist[0], probe_hist[1], probe_hist[2], probe_hist[3], probe_hist[4],
+                probe_hist[5]);
+    outbuf_addv(out, "Table size: %u, Load factor: %f (%u tombstones)\n", str_table.capacity,
+                static_cast<double>(str_table.live) / str_table.capacity,
+                str_table.used - str_table.live);
+    if (old_str_table.slots) {
+      outbuf_addv(out, "Growing from %u slots, %u strings left to move\n",
+                  old_str_table.capacity, old_str_table.live);
     }
   }
-  return (bytes_distinct_strings + overhead_bytes);
+  return (bytes_distinct_strings + overhead_bytes + table_bytes);
 }
 
 #ifdef DEBUGMALLOC_EXTENSIONS
@@ -494,9 +669,11 @@ void dump_stralloc(outbuffer_t* out) {
 
   ss << "===STRALLOC DUMP: allocd_strings:" << allocd_strings << "\n";
   // can't direct output to outbuf since it might realloc
-  for (int hsh = 0; hsh < htable_size; hsh++) {
-    for (block_t* entry = base_table[hsh]; entry; entry = entry->next) {
-      stralloc_print_entry(ss, entry);
+  for (const auto* t : {&str_table, &old_str_table}) {
+    for (uint32_t i = 0; i < t->capacity; i++) {
+      if (!(t->ctrl[i] & kEmpty)) {
+        stralloc_print_entry(ss, t->slots[i]);
+      }
     }
   }
   auto res = ss.str();
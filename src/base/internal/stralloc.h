@@ -102,8 +102,7 @@ void check_string_stats(outbuffer_t*);
 
 // The layout of malloc_block_s must be same as block_s
 typedef struct malloc_block_s {
-  void* _padding1;
-  unsigned int _padding2;
+  unsigned int _padding;
 #ifdef DEBUGMALLOC_EXTENSIONS
   unsigned int extra_ref;
 #endif
@@ -151,8 +150,7 @@ typedef struct malloc_block_s {
 #define DEC_COUNTED_REF(x) (!(MSTR_REF(x) == 0 || --MSTR_REF(x) > 0))
 
 typedef struct block_s {
-  struct block_s* next; /* next block in the hash chain */
-  unsigned int hash;
+  unsigned int hash; /* full hash, so the table can grow without rehashing */
 #if defined(DEBUGMALLOC_EXTENSIONS)  //|| (SIZEOF_CHAR_P == 8)
   unsigned int extra_ref;
 #endif
@@ -171,7 +169,6 @@ static_assert(offsetof(malloc_block_t, size) == offsetof(block_t, size) &&
                   offsetof(malloc_block_t, ascii) == offsetof(block_t, ascii),
               "malloc_block_t/block_t field offsets diverged");
 
-#define NEXT(x) (x)->next
 #define REFS(x) (x)->refs
 #define EXTRA_REF(x) (x)->extra_ref
 #define SIZE(x) (x)->size
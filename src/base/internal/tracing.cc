@@ -2,13 +2,19 @@
 //
 // Generate driver tracing data to be viewed in chrome http://about:tracing
 
-#include <vector>
+#include <algorithm>
+#include <cinttypes>
+#include <cstring>
+#include <deque>
 #include <fstream>
+#include <iomanip>
+#include <memory>
 #include <mutex>
-#include <sstream>
 #include <string>
 #include <thread>
+#include <unordered_map>
 #include <utility>
+#include <vector>
 #include <sys/types.h>
 #include <unistd.h>
 #ifdef _WIN32
@@ -22,7 +28,11 @@
 using json = nlohmann::json;
 
 namespace {
-const int MAX_EVENTS = 1'000'000;
+
+constexpr char kTraceMagic[8] = {'F', 'L', 'T', 'R', 'A', 'C', 'E', '\0'};
+constexpr uint32_t kTraceVersion = 1;
+constexpr size_t kRingMask = Tracer::kRingCapacity - 1;
+static_assert((Tracer::kRingCapacity & kRingMask) == 0, "ring capacity must be a power of 2");
 
 unsigned long get_current_process_id() {
   static unsigned long const current_process_id =
@@ -34,146 +44,262 @@ unsigned long get_current_process_id() {
   return current_process_id;
 }
 
-unsigned long thread_id_to_string(std::thread::id id) {
-  std::ostringstream os;
-  os << id;
-  std::string const res = os.str();
+// Bumped by every Tracer::start(); a ring whose generation is older holds a
+// previous trace and is reset by its thread on the next event.
+std::atomic<uint32_t> trace_generation{0};
+
+struct ThreadRing {
+  uint32_t thread_id = 0;
+  std::atomic<uint32_t> generation{0};
+  // Written only by the owning thread; collect() reads it (acquire) to see
+  // how many records are complete.
+  std::atomic<uint64_t> head{0};
+  std::unique_ptr<TraceRecord[]> records;
+  std::unique_ptr<json[]> args;
+  // Owning thread's view of the name table: no locking after a name's first use.
+  std::unordered_map<std::string_view, uint32_t> names;
+  // Guarded by the registry lock.
+  std::string thread_name;
+};
+
+struct Registry {
+  std::mutex lock;
+  // Rings outlive their threads until the next collect, so nothing is lost.
+  std::vector<std::shared_ptr<ThreadRing>> rings;
+  uint32_t next_thread_id = 1;
+  // Interned names; a deque so that the string_views handed out stay valid.
+  std::deque<std::string> names;
+  std::unordered_map<std::string_view, uint32_t> name_ids;
+  std::vector<std::thread> dump_threads;
+
+  ~Registry() {
+    for (auto& t : dump_threads) {
+      if (t.joinable()) {
+        t.join();
+      }
+    }
+  }
+};
 
-  return std::strtoul(res.c_str(), nullptr, 10);
+Registry& registry() {
+  static Registry r;
+  return r;
 }
 
-unsigned long get_current_thread_id() {
-  static thread_local unsigned long const current_thread_id =
-      thread_id_to_string(std::this_thread::get_id());
-  return current_thread_id;
+ThreadRing& this_thread_ring() {
+  static thread_local std::shared_ptr<ThreadRing> ring;
+  if (!ring) {
+    auto& reg = registry();
+    std::lock_guard<std::mutex> const guard(reg.lock);
+    ring = std::make_shared<ThreadRing>();
+    ring->thread_id = reg.next_thread_id++;
+    reg.rings.push_back(ring);
+  }
+  return *ring;
 }
 
-}  // namespace
+uint32_t intern(ThreadRing& ring, std::string_view name) {
+  auto it = ring.names.find(name);
+  if (it != ring.names.end()) {
+    return it->second;
+  }
 
-Event::Event(std::string_view name, EventCategory category, const char* phase,
-             std::optional<json>&& args)
-    : process_id(::get_current_process_id()),
-      thread_id(::get_current_thread_id()),
-      timestamp(Tracer::timestamp()),
-      category(category),
-      phase(phase),
-      name(name),
-      args(args) {}
+  auto& reg = registry();
+  std::lock_guard<std::mutex> const guard(reg.lock);
+  auto global = reg.name_ids.find(name);
+  if (global == reg.name_ids.end()) {
+    reg.names.emplace_back(name);
+    global = reg.name_ids.emplace(reg.names.back(), reg.names.size() - 1).first;
+  }
+  ring.names.emplace(global->first, global->second);
+  return global->second;
+}
 
-class TraceWriter {
- public:
-  ~TraceWriter();
+bool ends_with(const std::string& s, std::string_view suffix) {
+  return s.size() >= suffix.size() && s.compare(s.size() - suffix.size(), suffix.size(),
+                                                suffix.data(), suffix.size()) == 0;
+}
 
-  void log(Event&& e) {
-    std::lock_guard<std::mutex> const guard(lock_);
+template <typename T>
+void put(std::ostream& out, const T& v) {
+  out.write(reinterpret_cast<const char*>(&v), sizeof(v));
+}
 
-    if (!buffer_) {
-      buffer_ = std::make_unique<std::vector<Event>>();
-      buffer_->reserve(MAX_EVENTS);
-    }
+void put_string(std::ostream& out, std::string_view s) {
+  put(out, static_cast<uint32_t>(s.size()));
+  out.write(s.data(), s.size());
+}
 
-    if (buffer_->size() >= MAX_EVENTS) {
-      Tracer::stop();
-    }
+template <typename T>
+bool get(std::istream& in, T* v) {
+  return static_cast<bool>(in.read(reinterpret_cast<char*>(v), sizeof(*v)));
+}
 
-    buffer_->push_back(std::move(e));
+bool get_string(std::istream& in, std::string* s) {
+  uint32_t len;
+  if (!get(in, &len)) {
+    return false;
   }
-  void flush(const std::string& file);
+  s->resize(len);
+  return len == 0 || static_cast<bool>(in.read(s->data(), len));
+}
 
- private:
-  std::mutex lock_;
-  std::unique_ptr<std::vector<Event>> buffer_;
-  std::vector<std::thread> dump_threads_;
-};
+}  // namespace
 
-TraceWriter::~TraceWriter() {
-  std::lock_guard<std::mutex> const lock(lock_);
-  if (buffer_ && !buffer_->empty()) {
-    debug_message("Uncollected profiling events: %ld.\n", buffer_->size());
+bool write_trace_binary(const TraceData& data, std::ostream& out) {
+  out.write(kTraceMagic, sizeof(kTraceMagic));
+  put(out, kTraceVersion);
+  put(out, data.process_id);
+  put(out, data.dropped);
+
+  put(out, static_cast<uint32_t>(data.names.size()));
+  for (const auto& name : data.names) {
+    put_string(out, name);
   }
-  for (auto& t : dump_threads_) {
-    if (t.joinable()) {
-      t.join();
-    }
+  put(out, static_cast<uint32_t>(data.thread_names.size()));
+  for (const auto& [tid, name] : data.thread_names) {
+    put(out, tid);
+    put_string(out, name);
   }
-  dump_threads_.clear();
+  put(out, static_cast<uint64_t>(data.records.size()));
+  out.write(reinterpret_cast<const char*>(data.records.data()),
+            data.records.size() * sizeof(TraceRecord));
+  put(out, static_cast<uint64_t>(data.args.size()));
+  for (const auto& [index, args] : data.args) {
+    put(out, index);
+    put_string(out, args.dump());
+  }
+  return static_cast<bool>(out);
 }
 
-void TraceWriter::flush(const std::string& filename) {
-  std::lock_guard<std::mutex> const guard(lock_);
+bool read_trace_binary(std::istream& in, TraceData* data, std::string* error) {
+  auto fail = [&](const char* what) {
+    *error = what;
+    return false;
+  };
 
-  if (!buffer_ || buffer_->empty()) {
-    return;
+  char magic[sizeof(kTraceMagic)];
+  uint32_t version;
+  if (!in.read(magic, sizeof(magic)) || memcmp(magic, kTraceMagic, sizeof(magic)) != 0) {
+    return fail("not a FluffOS trace file");
+  }
+  if (!get(in, &version) || version != kTraceVersion) {
+    return fail("unsupported trace file version");
+  }
+  if (!get(in, &data->process_id) || !get(in, &data->dropped)) {
+    return fail("truncated header");
   }
 
-  debug_message("Trace duration: %lf us, dumping %ld events to %s in separate thread.\n",
-                Tracer::timestamp(), buffer_->size(), filename.c_str());
-
-  auto dump = [current_buffer = std::move(buffer_), filename] {
-    auto begin = std::chrono::high_resolution_clock::now();
-
-    std::ofstream file(filename, std::ofstream::out | std::ofstream::binary);
-
-    if (!file) {
-      debug_message("Error opening file %s: .\n", filename.c_str());
-      current_buffer->clear();
-      return;
+  uint32_t num_names, num_threads;
+  if (!get(in, &num_names)) {
+    return fail("truncated name table");
+  }
+  data->names.resize(num_names);
+  for (auto& name : data->names) {
+    if (!get_string(in, &name)) {
+      return fail("truncated name table");
+    }
+  }
+  if (!get(in, &num_threads)) {
+    return fail("truncated thread table");
+  }
+  data->thread_names.resize(num_threads);
+  for (auto& [tid, name] : data->thread_names) {
+    if (!get(in, &tid) || !get_string(in, &name)) {
+      return fail("truncated thread table");
     }
+  }
 
-    file << "[";
-
-    bool is_first = true;
-
-    for (auto& e : *current_buffer) {
-      if (is_first)
-        is_first = false;
-      else
-        file << ",";
-      file << "\n";  // use std::endl flush the buffer, best to avoid.
-
-      file << "{"
-           << R"("pid":)" << e.process_id << ","
-           << R"("tid":)" << e.thread_id << ","
-           << R"("ts":)" << e.timestamp << ","
-           << R"("dur":)" << e.duration << ","
-           << R"("ph":")" << e.phase << "\""
-           << ","
-           << R"("cat":")" << e.category_name() << "\""
-           << ","
-           << R"("name":)" << json(e.name);
-
-      if (e.phase[0] == 'X') {
-        file << ","
-             << R"("dur":)" << e.duration;
-      }
+  uint64_t num_records, num_args;
+  if (!get(in, &num_records)) {
+    return fail("truncated records");
+  }
+  data->records.resize(num_records);
+  if (!in.read(reinterpret_cast<char*>(data->records.data()), num_records * sizeof(TraceRecord))) {
+    return fail("truncated records");
+  }
+  for (const auto& r : data->records) {
+    if (r.name >= num_names) {
+      return fail("record names an unknown string");
+    }
+  }
+  if (!get(in, &num_args)) {
+    return fail("truncated args");
+  }
+  data->args.resize(num_args);
+  for (auto& [index, args] : data->args) {
+    std::string text;
+    if (!get(in, &index) || !get_string(in, &text)) {
+      return fail("truncated args");
+    }
+    args = json::parse(text, nullptr, false);
+    if (args.is_discarded()) {
+      return fail("malformed args");
+    }
+  }
+  return true;
+}
 
-      if (e.args && !e.args->empty()) {
-        file << ","
-             << R"("args":)" << *e.args;
-      }
-      file << "}";
+void write_trace_json(const TraceData& data, std::ostream& out) {
+  auto flags = out.flags();
+  auto precision = out.precision();
+  out << std::fixed << std::setprecision(3) << "[";
+
+  bool is_first = true;
+  auto separator = [&] {
+    if (is_first) {
+      is_first = false;
+    } else {
+      out << ",";
     }
+    out << "\n";  // use std::endl flush the buffer, best to avoid.
+  };
 
-    file << "\n"
-         << "]";
+  for (const auto& [tid, name] : data.thread_names) {
+    separator();
+    out << "{"
+        << R"("pid":)" << data.process_id << ","
+        << R"("tid":)" << tid << ","
+        << R"("ts":0,"ph":"M","cat":"__metadata","name":"thread_name","args":)"
+        << json{{"name", name}} << "}";
+  }
 
-    auto dur_us = std::chrono::duration_cast<std::chrono::milliseconds>(
-                      std::chrono::high_resolution_clock::now() - begin)
-                      .count();
+  auto next_args = data.args.begin();
+  for (size_t i = 0; i < data.records.size(); i++) {
+    const auto& e = data.records[i];
+    separator();
+    out << "{"
+        << R"("pid":)" << data.process_id << ","
+        << R"("tid":)" << e.thread_id << ","
+        << R"("ts":)" << e.timestamp << ","
+        << R"("ph":")" << e.phase << "\""
+        << ","
+        << R"("cat":")" << category_name(static_cast<EventCategory>(e.category)) << "\""
+        << ","
+        << R"("name":)" << json(data.names[e.name]);
+
+    if (e.phase == 'X') {
+      out << ","
+          << R"("dur":)" << e.duration;
+    }
 
-    debug_message("[thread %lud]: Dump trace successfully to file %s, cost %lld ms.\n",
-                  get_current_thread_id(), filename.c_str(), dur_us);
-  };
+    while (next_args != data.args.end() && next_args->first < i) {
+      ++next_args;
+    }
+    if (e.has_args && next_args != data.args.end() && next_args->first == i) {
+      out << ","
+          << R"("args":)" << next_args->second;
+    }
+    out << "}";
+  }
 
-#ifdef __EMSCRIPTEN__
-  // No threads on WASM: write the trace synchronously.
-  dump();
-#else
-  this->dump_threads_.emplace_back(std::move(dump));
-#endif
+  out << "\n"
+      << "]";
+  out.flags(flags);
+  out.precision(precision);
 }
 
-bool Tracer::is_enabled = false;
+std::atomic<bool> Tracer::is_enabled{false};
 std::string Tracer::filename;
 
 #ifdef _WIN32
@@ -182,84 +308,224 @@ LARGE_INTEGER Tracer::basetime;
 std::chrono::high_resolution_clock::time_point Tracer::basetime;
 #endif
 
-void Tracer::log(Event&& e) {
-  if (Tracer::enabled()) {
-    instance().log(std::move(e));
+void Tracer::start(const char* file) {
+  // If there is already events, flush it out first.
+  if (enabled()) {
+    collect();
+  }
+#ifdef _WIN32
+  QueryPerformanceCounter(&basetime);
+#else
+  basetime = std::chrono::high_resolution_clock::now();
+#endif
+  filename = file;
+  trace_generation.fetch_add(1, std::memory_order_release);
+  is_enabled.store(true, std::memory_order_release);
+}
+
+void Tracer::record(const std::string_view& name, EventCategory category, char phase,
+                    double timestamp, double duration, std::optional<json>&& args) {
+  auto& ring = this_thread_ring();
+
+  auto generation = trace_generation.load(std::memory_order_acquire);
+  if (ring.generation.load(std::memory_order_relaxed) != generation) {
+    if (!ring.records) {
+      ring.records = std::make_unique<TraceRecord[]>(kRingCapacity);
+      ring.args = std::make_unique<json[]>(kRingCapacity);
+    }
+    ring.head.store(0, std::memory_order_relaxed);
+    ring.generation.store(generation, std::memory_order_release);
   }
+
+  auto head = ring.head.load(std::memory_order_relaxed);
+  auto slot = head & kRingMask;
+  auto& r = ring.records[slot];
+  r.timestamp = timestamp;
+  r.duration = duration;
+  r.name = intern(ring, name);
+  r.thread_id = ring.thread_id;
+  r.category = static_cast<uint8_t>(category);
+  r.phase = phase;
+  r.has_args = args && !args->empty();
+  if (r.has_args) {
+    ring.args[slot] = std::move(*args);
+  }
+  ring.head.store(head + 1, std::memory_order_release);
 }
 
 void Tracer::logSimpleEvent(const std::string_view& name, const EventCategory& category) {
   if (Tracer::enabled()) {
-    log({name, category, "i"});
+    record(name, category, 'i', timestamp(), 0, std::nullopt);
   }
 }
 void Tracer::begin(const std::string_view& name, const EventCategory& category, json&& args) {
   if (Tracer::enabled()) {
-    log({name, category, "B", std::move(args)});
+    record(name, category, 'B', timestamp(), 0, std::move(args));
   }
 }
 void Tracer::begin(const std::string_view& name, const EventCategory& category) {
   if (Tracer::enabled()) {
-    log({name, category, "B"});
+    record(name, category, 'B', timestamp(), 0, std::nullopt);
   }
 }
 void Tracer::end(const std::string_view& name, const EventCategory& category) {
   if (Tracer::enabled()) {
-    log({name, category, "E"});
+    record(name, category, 'E', timestamp(), 0, std::nullopt);
   }
 }
-
-void Tracer::setThreadName(const std::string_view& name) {
+void Tracer::complete(const std::string_view& name, const EventCategory& category,
+                      double timestamp, double duration, std::optional<json>&& args) {
   if (Tracer::enabled()) {
-    Event e("thread_name", EventCategory::DEFAULT, "M",
-            json{
-                {"name", name},
-            });
-    e.timestamp = 0;
-    log(std::move(e));
+    record(name, category, 'X', timestamp, duration, std::move(args));
   }
 }
 
+void Tracer::setThreadName(const std::string_view& name) {
+  // Kept on the ring rather than as an event, so that it survives wraparound
+  // and is known to every later trace.
+  auto& ring = this_thread_ring();
+  auto& reg = registry();
+  std::lock_guard<std::mutex> const guard(reg.lock);
+  ring.thread_name = name;
+}
+
 void Tracer::counter(const std::string_view& name, long n) {
   if (Tracer::enabled()) {
-    counter(name, {{name, n}});
+    counter(name, std::optional<json>(json{{name, n}}));
   }
 }
 
 void Tracer::counter(const std::string_view& name, std::optional<json>&& args) {
   if (Tracer::enabled()) {
-    log({name, EventCategory::DEFAULT, "C", std::move(args)});
+    record(name, EventCategory::DEFAULT, 'C', timestamp(), 0, std::move(args));
   }
 }
 
+TraceData Tracer::snapshot() {
+  stop();
+
+  TraceData data;
+  data.process_id = get_current_process_id();
+
+  auto& reg = registry();
+  std::lock_guard<std::mutex> const guard(reg.lock);
+  auto generation = trace_generation.load(std::memory_order_acquire);
+  std::vector<uint32_t> name_map(reg.names.size(), UINT32_MAX);
+
+  for (auto& ring : reg.rings) {
+    if (!ring->thread_name.empty()) {
+      data.thread_names.emplace_back(ring->thread_id, ring->thread_name);
+    }
+    if (ring->generation.load(std::memory_order_acquire) != generation) {
+      continue;
+    }
+
+    auto head = ring->head.load(std::memory_order_acquire);
+    uint64_t first = 0;
+    bool wrapped = head > kRingCapacity;
+    if (wrapped) {
+      // A thread that saw tracing still enabled may be overwriting the
+      // oldest slot right now; leave it out.
+      first = head - kRingCapacity + 1;
+      data.dropped += first;
+    }
+
+    // Once the ring has wrapped, the begin events of its oldest ends are gone.
+    int depth = 0;
+    for (auto i = first; i < head; i++) {
+      auto r = ring->records[i & kRingMask];
+      if (r.phase == 'B') {
+        depth++;
+      } else if (r.phase == 'E') {
+        if (depth == 0 && wrapped) {
+          data.dropped++;
+          continue;
+        }
+        depth--;
+      }
+      if (name_map[r.name] == UINT32_MAX) {
+        name_map[r.name] = data.names.size();
+        data.names.push_back(reg.names[r.name]);
+      }
+      r.name = name_map[r.name];
+      if (r.has_args) {
+        data.args.emplace_back(data.records.size(), ring->args[i & kRingMask]);
+      }
+      data.records.push_back(r);
+    }
+  }
+
+  // Forget the rings of threads that have exited.
+  reg.rings.erase(std::remove_if(reg.rings.begin(), reg.rings.end(),
+                                 [](const auto& ring) { return ring.use_count() == 1; }),
+                  reg.rings.end());
+  return data;
+}
+
 void Tracer::collect() {
   // It's possible that we are over limit and collection was disabled.
-  if (!filename.empty()) {
-    instance().flush(filename);
+  if (filename.empty()) {
+    return;
+  }
+
+  auto data = std::make_shared<TraceData>(snapshot());
+  std::string file = filename;
+  filename.clear();
 
-    filename.clear();
-    is_enabled = false;
+  if (data->records.empty()) {
+    return;
   }
-}
 
-TraceWriter& Tracer::instance() {
-  static TraceWriter trace_writer;
-  return trace_writer;
+  debug_message("Trace duration: %lf us, dumping %zu events to %s in separate thread.\n",
+                Tracer::timestamp(), data->records.size(), file.c_str());
+
+  auto dump = [data, file] {
+    auto begin = std::chrono::high_resolution_clock::now();
+
+    std::ofstream out(file, std::ofstream::out | std::ofstream::binary);
+
+    if (!out) {
+      debug_message("Error opening file %s: .\n", file.c_str());
+      return;
+    }
+
+    if (ends_with(file, ".json")) {
+      write_trace_json(*data, out);
+    } else {
+      write_trace_binary(*data, out);
+    }
+
+    auto dur_us = std::chrono::duration_cast<std::chrono::milliseconds>(
+                      std::chrono::high_resolution_clock::now() - begin)
+                      .count();
+
+    debug_message("Dump trace successfully to file %s (%" PRIu64 " events dropped), cost %lld ms.\n",
+                  file.c_str(), data->dropped, static_cast<long long>(dur_us));
+  };
+
+#ifdef __EMSCRIPTEN__
+  // No threads on WASM: write the trace synchronously.
+  dump();
+#else
+  auto& reg = registry();
+  std::lock_guard<std::mutex> const guard(reg.lock);
+  reg.dump_threads.emplace_back(std::move(dump));
+#endif
 }
 
-ScopedTracerInner::ScopedTracerInner(const std::string& name, const EventCategory category,
+ScopedTracerInner::ScopedTracerInner(std::string_view name, const EventCategory category,
                                      std::optional<std::function<json()>> lazy_arg,
                                      double time_limit_usec)
-    : time_limit_usec(time_limit_usec),
-      event(std::make_unique<Event>(
-          name, category, "X", lazy_arg ? std::make_optional<json>((*lazy_arg)()) : std::nullopt)) {
-}
+    : name(name),
+      category(category),
+      time_limit_usec(time_limit_usec),
+      start(Tracer::timestamp()),
+      args(std::move(lazy_arg)) {}
 
 ScopedTracerInner::~ScopedTracerInner() {
-  if (!this->event) return;
-
-  this->event->duration = Tracer::timestamp() - this->event->timestamp;
-  if (this->event->duration >= time_limit_usec) {
-    Tracer::log(std::move(*this->event));
+  auto duration = Tracer::timestamp() - start;
+  if (duration >= time_limit_usec && Tracer::enabled()) {
+    Tracer::complete(name, category, start, duration,
+                     args ? std::make_optional<json>((*args)()) : std::nullopt);
   }
 }
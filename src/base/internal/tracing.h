@@ -6,15 +6,19 @@
 #include <chrono>
 #endif
 
-#include <string>
-#include <optional>
+#include <atomic>
+#include <cstdint>
 #include <functional>
+#include <iosfwd>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
 
 #include <nlohmann/json.hpp>
 using json = nlohmann::json;
 
-class TraceWriter;
-
 enum EventCategory {
   METADATA,
   DEFAULT,
@@ -27,82 +31,94 @@ enum EventCategory {
   LPC_EFUN,
 };
 
-class Event {
- public:
-  Event(std::string_view name, EventCategory category, const char* phase,
-        std::optional<json>&& args = std::nullopt);
-
-  unsigned long process_id;
-  unsigned long thread_id;
-  double timestamp;
-  double duration{};
-  EventCategory category = EventCategory::DEFAULT;
-  const char* phase = "i";
-  std::string name = "DEFAULT";
-  std::optional<json> args = std::nullopt;
-
-  inline const char* category_name() {
-    switch (this->category) {
-      case EventCategory::METADATA:
-        return "__metadata";
-      case EventCategory::DEFAULT:
-        return "DEFAULT";
-      case EventCategory::IO_FS:
-        return "IO: Filesystem";
-      case EventCategory::VM_COMPILE_FILE:
-        return "VM: Compile File";
-      case EventCategory::VM_LOAD_OBJECT:
-        return "VM: Load Object";
-      case EventCategory::APPLY_CACHE:
-        return "Apply cache lookup";
-      case EventCategory::LPC_CATCH:
-        return "LPC Catch";
-      case EventCategory::LPC_FUNCTION:
-        return "LPC Function";
-      case EventCategory::LPC_EFUN:
-        return "LPC EFUN";
-    }
-    return "Unknown";
+inline const char* category_name(EventCategory category) {
+  switch (category) {
+    case EventCategory::METADATA:
+      return "__metadata";
+    case EventCategory::DEFAULT:
+      return "DEFAULT";
+    case EventCategory::IO_FS:
+      return "IO: Filesystem";
+    case EventCategory::VM_COMPILE_FILE:
+      return "VM: Compile File";
+    case EventCategory::VM_LOAD_OBJECT:
+      return "VM: Load Object";
+    case EventCategory::APPLY_CACHE:
+      return "Apply cache lookup";
+    case EventCategory::LPC_CATCH:
+      return "LPC Catch";
+    case EventCategory::LPC_FUNCTION:
+      return "LPC Function";
+    case EventCategory::LPC_EFUN:
+      return "LPC EFUN";
   }
-
- public:
-  // Move only
-  Event(Event&& other) = default;
-  Event& operator=(Event&& other) = default;
-  // The copy operations are implicitly deleted, but you can
-  // spell that out explicitly if you want:
-  Event(const Event&) = delete;
-  Event& operator=(const Event&) = delete;
+  return "Unknown";
+}
+
+/*
+ * One traced event, as stored in a thread's ring buffer and in the binary
+ * trace file. Names are interned: `name` indexes TraceData::names. Arguments
+ * are kept as json beside the ring and only serialized when the trace is
+ * written out.
+ */
+struct TraceRecord {
+  double timestamp;  // usec since trace start
+  double duration;   // usec, 'X' events only
+  uint32_t name;
+  uint32_t thread_id;
+  uint8_t category;
+  char phase;  // B, E, X, i or C
+  uint8_t has_args;
+  uint8_t reserved[5];
+};
+static_assert(sizeof(TraceRecord) == 32, "trace records are written out as-is");
+
+// A collected trace: what Tracer::collect() snapshots from the ring buffers,
+// and exactly what the binary trace file holds.
+struct TraceData {
+  uint32_t process_id = 0;
+  uint64_t dropped = 0;  // events lost to ring wraparound
+  std::vector<std::string> names;
+  std::vector<std::pair<uint32_t, std::string>> thread_names;
+  std::vector<TraceRecord> records;
+  std::vector<std::pair<uint64_t, json>> args;  // (record index, args), by index
 };
 
+// Binary trace file: see docs/concepts/general/tracing.md for the layout.
+bool write_trace_binary(const TraceData& data, std::ostream& out);
+bool read_trace_binary(std::istream& in, TraceData* data, std::string* error);
+// Chrome Trace Event Format (JSON array form), readable by Chrome, Firefox
+// and Perfetto.
+void write_trace_json(const TraceData& data, std::ostream& out);
+
+/*
+ * The driver tracer. Every thread records into its own fixed-size ring of
+ * TraceRecords with no locking; only the first sighting of a name on a thread
+ * takes the name table lock. A long trace keeps its most recent events.
+ * collect() snapshots the rings and writes the file in a separate thread:
+ * JSON if the file name ends in ".json", the binary format otherwise (convert
+ * it offline with trace2json).
+ */
 class Tracer {
  public:
+  // Records per thread ring: 32 bytes each, plus 16 for the args slot.
+  static constexpr size_t kRingCapacity = 1 << 19;
+
   static void setThreadName(const std::string_view& name);
-  static void log(Event&& e);
   static void counter(const std::string_view& name, long n);
   static void counter(const std::string_view& name, std::optional<json>&& args = std::nullopt);
   static void logSimpleEvent(const std::string_view& name, const EventCategory& category);
   static void begin(const std::string_view& name, const EventCategory& category, json&& args);
   static void begin(const std::string_view& name, const EventCategory& category);
   static void end(const std::string_view&, const EventCategory& category);
+  static void complete(const std::string_view& name, const EventCategory& category,
+                       double timestamp, double duration, std::optional<json>&& args);
 
-  static inline void start(const char* file) {
-    // If there is already events, flush it out first.
-    if (is_enabled) {
-      collect();
-    }
-#ifdef _WIN32
-    QueryPerformanceCounter(&basetime);
-#else
-    basetime = std::chrono::high_resolution_clock::now();
-#endif
-    filename = file;
-    is_enabled = true;
-  }
+  static void start(const char* file);
 
-  static inline void stop() { is_enabled = false; }
+  static inline void stop() { is_enabled.store(false, std::memory_order_relaxed); }
 
-  static inline bool enabled() { return is_enabled; }
+  static inline bool enabled() { return is_enabled.load(std::memory_order_relaxed); }
 
   static inline double timestamp() {
 #ifdef _WIN32
@@ -124,7 +140,10 @@ class Tracer {
 #endif
   }
 
+  // Stop tracing and write the trace out to the file given to start().
   static void collect();
+  // Stop tracing and return what the rings hold for the current trace.
+  static TraceData snapshot();
 
 #ifdef _WIN32
   static LARGE_INTEGER basetime;
@@ -132,8 +151,11 @@ class Tracer {
   static std::chrono::high_resolution_clock::time_point basetime;
 #endif
   static std::string filename;
-  static bool is_enabled;
-  static TraceWriter& instance();
+  static std::atomic<bool> is_enabled;
+
+ private:
+  static void record(const std::string_view& name, EventCategory category, char phase,
+                     double timestamp, double duration, std::optional<json>&& args);
 
  public:
   // Not copyable or movable
@@ -145,17 +167,26 @@ class Tracer {
   Tracer& operator=(Tracer&&) = delete;
 };
 
+/*
+ * Records one complete ('X') event for its scope, if the scope took at least
+ * time_limit_usec. `name` is interned only then, so it must outlive the scope
+ * (a literal or a static table entry). `args` is likewise only called then,
+ * at the end of the scope, so it must not read state the scope consumes.
+ */
 class ScopedTracerInner {
  public:
-  ScopedTracerInner(const std::string& name, const EventCategory category = EventCategory::DEFAULT,
+  ScopedTracerInner(std::string_view name, const EventCategory category = EventCategory::DEFAULT,
                     std::optional<std::function<json()>> args = std::nullopt,
                     double time_limit_usec = 100);
 
   virtual ~ScopedTracerInner();
 
  private:
+  std::string_view name;
+  EventCategory category;
   double time_limit_usec;
-  std::unique_ptr<Event> event;
+  double start;
+  std::optional<std::function<json()>> args;
 
  public:
   // Not copyable or movable
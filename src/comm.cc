@@ -7,6 +7,7 @@
 
 #include "comm.h"
 
+#include <algorithm>  // for max, min
 #include <cstdarg>   // for va_end, va_list, va_copy, etc
 #include <cstdio>    // for snprintf, vsnprintf, fwrite, etc
 #include <cstring>   // for NULL, memcpy, strlen, etc
@@ -309,14 +310,61 @@ void flush_message_all() {
   users_foreach([](interactive_t* user) { flush_message(user); });
 }
 
+/*
+ * Largest ip->text may grow to ('maximum input buffer size').
+ */
+static int max_input_buffer() {
+  return std::max(static_cast<int>(CONFIG_INT(__RC_MAX_INPUT_BUFFER_SIZE__)), INITIAL_TEXT);
+}
+
+/*
+ * Resize ip->text to exactly `size` bytes. Pending input (text_start..
+ * text_end) must already fit.
+ */
+static void resize_input_buffer(interactive_t* ip, int size) {
+  ip->text = reinterpret_cast<char*>(
+      DREALLOC(ip->text, size, TAG_INPUT_BUF, "resize_input_buffer"));
+  ip->text_size = size;
+}
+
+/*
+ * Grow ip->text to hold at least `size` bytes, doubling from its current
+ * size but never beyond 'maximum input buffer size'. Returns the resulting
+ * buffer size, which is below `size` when the cap got in the way.
+ */
+int comm_grow_input_buffer(interactive_t* ip, size_t size) {
+  const size_t cap = max_input_buffer();
+  if (size > cap) {
+    size = cap;
+  }
+  if (size > static_cast<size_t>(ip->text_size)) {
+    size_t new_size = ip->text_size;
+    while (new_size < size) {
+      new_size *= 2;
+    }
+    resize_input_buffer(ip, std::min(new_size, cap));
+  }
+  return ip->text_size;
+}
+
 /*
  * Make room in ip->text for at least min_space incoming bytes: compact
- * already-consumed input first and, as a last resort, drop the (overlong)
- * pending command. Returns the usable free space. Shared by every input
- * transport (socket, websocket, WASM JS bridge).
+ * already-consumed input first, then grow the buffer up to its cap and, as
+ * a last resort, drop the (overlong) pending command. A drained buffer that
+ * grew for an earlier burst is shrunk back to INITIAL_TEXT here, so idle
+ * connections only hold a small buffer. Returns the usable free space.
+ * Shared by every input transport (socket, websocket, WASM JS bridge).
+ *
+ * Only called from the input path: first_cmd_in_buf() hands out pointers
+ * into ip->text that must stay valid while the command runs.
  */
 size_t comm_reserve_input_space(interactive_t* ip, size_t min_space) {
-  size_t text_space = sizeof(ip->text) - ip->text_end;
+  if (ip->text_start == ip->text_end && ip->text_size > INITIAL_TEXT &&
+      min_space <= INITIAL_TEXT) {
+    ip->text_start = ip->text_end = 0;
+    resize_input_buffer(ip, INITIAL_TEXT);
+  }
+  size_t text_space = ip->text_size - ip->text_end;
   if (text_space < min_space) {
     if (ip->text_start > 0) {
       memmove(ip->text, ip->text + ip->text_start, ip->text_end - ip->text_start);
@@ -324,10 +372,13 @@ size_t comm_reserve_input_space(interactive_t* ip, size_t min_space) {
       ip->text_end -= ip->text_start;
       ip->text_start = 0;
     }
+    if (text_space < min_space) {
+      text_space = comm_grow_input_buffer(ip, ip->text_end + min_space) - ip->text_end;
+    }
     if (text_space < min_space) {
       ip->iflags |= SKIP_COMMAND;
       ip->text_start = ip->text_end = 0;
-      text_space = sizeof(ip->text);
+      text_space = comm_grow_input_buffer(ip, min_space);
     }
   }
   return text_space;
@@ -412,7 +463,10 @@ static const int ANSI_SUBSTITUTE = 0x20;
 // each time.
 void on_user_input(interactive_t* ip, const char* data, size_t len) {
   for (int i = 0; i < len; i++) {
-    if (ip->text_end == sizeof(ip->text) - 1) {
+    // Grow in place rather than compacting: callers hold offsets into
+    // ip->text (see comm_telnet_received()).
+    if (ip->text_end >= ip->text_size - 1 &&
+        comm_grow_input_buffer(ip, ip->text_end + (len - i) + 1) - 1 <= ip->text_end) {
       // No more space
       break;
     }
@@ -474,7 +528,7 @@ static int single_char_bytes(const interactive_t* ip) {
   }
   if (avail < len) {
     /* wait for the rest, unless the buffer can never grow */
-    return ip->text_end == sizeof(ip->text) - 1 ? 1 : 0;
+    return ip->text_end >= max_input_buffer() - 1 ? 1 : 0;
   }
   for (int i = 1; i < len; i++) {
     if ((p[i] & 0xc0) != 0x80) {
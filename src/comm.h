@@ -72,6 +72,7 @@ void on_user_logon(interactive_t*);
 int cmd_in_buf(interactive_t* ip);
 void on_user_input(interactive_t* ip, const char* data, size_t len);
 size_t comm_reserve_input_space(interactive_t* ip, size_t min_space);
+int comm_grow_input_buffer(interactive_t* ip, size_t size);
 void comm_text_received(interactive_t* ip, const char* data, size_t len);
 void comm_telnet_received(interactive_t* ip, const char* data, size_t len);
 
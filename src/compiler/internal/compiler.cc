@@ -3,6 +3,7 @@
 #include "compiler.h"
 #include "compiler/internal/compiler_utils.h"
 
+#include <algorithm>  // for std::find
 #include <cstdlib>  // for qsort
 #include <cstdio>   // for sprintf
 
@@ -26,6 +27,7 @@
 #include <utility>
 #include <vector>
 
+#include "vm/internal/base/apply_cache.h"
 #include "vm/internal/base/machine.h"  // for error(), FIXME
 
 #ifdef PACKAGE_MUDLIB_STATS
@@ -3122,7 +3124,9 @@ static program_t* epilog(void) {
     prog->inherit = nullptr;
   }
 
-  prog->apply_lookup_table.reset(nullptr);
+  prog->apply_table = nullptr;
+  prog->num_call_sites = g_compile.num_call_sites;
+  prog->call_site_caches.reset(nullptr);
 
 #ifdef DEBUG
   if (p - reinterpret_cast<char*>(prog) != size) {
@@ -3140,6 +3144,17 @@ static program_t* epilog(void) {
     }
   }
 
+  // Hand the include list to the program cache before A_INCLUDES goes.
+  for (i = 0; i < mem_block[A_INCLUDES].current_size;) {
+    const char* inc = mem_block[A_INCLUDES].block + i;
+    if (std::find(g_compile.includes.begin(), g_compile.includes.end(), inc) ==
+        g_compile.includes.end()) {
+      g_compile.includes.emplace_back(inc);
+    }
+    i += strlen(inc) + 1;
+  }
+  g_compile.save_binary = (pragmas & PRAGMA_SAVE_BINARY) != 0;
+
   // Buffer teardown BEFORE the mem_block frees, mirroring clean_parser:
   // pops perform include accounting that writes into mem_block. (On this
   // success path all buffers already drained at EOF -- ordering kept
@@ -3165,6 +3180,7 @@ static program_t* epilog(void) {
   for (i = 0; static_cast<unsigned>(i) < prog->num_inherited; i++) {
     reference_prog(prog->inherit[i].prog, "inheritance");
   }
+  build_apply_table(prog);
   release_tree();
   uninitialize_parser();
   clean_up_locals();
@@ -3209,6 +3225,9 @@ static bool prolog(std::string_view source, const char* name, void* scanner) {
   current_file = make_shared_string(name);
   current_file_id = add_program_file(name, 1);
 
+  // Cleared here rather than in start_new_file(): get_include_path below
+  // is already one of this compile's master calls.
+  g_compile.master_calls.clear();
   init_include_path();
 
   /*
@@ -366,6 +366,17 @@ struct PpMacro {
 // it is stock unordered_map surface.
 using LpcMacroTable = std::unordered_map<std::string, PpMacro>;
 
+// One master apply made during a compile (include_file, inherit_program,
+// get_include_path, valid_override): the arguments as pushed and a digest
+// of the answer. A cached program is only reused if replaying these calls
+// still gets the same answers.
+struct CompileMasterCall {
+  int apply;
+  std::vector<std::string> args;  // numbers are stored in decimal ...
+  unsigned number_args;           // ... and flagged here, bit i for args[i]
+  uint64_t result;
+};
+
 struct CompileState {
   // Identity of the running compile; filename null outside any compile.
   const char* filename = nullptr;
@@ -414,9 +425,34 @@ struct CompileState {
   // typeless global variable declaration) with a targeted error instead
   // of silently declaring 'var' with unknown type.
   int class_def_cooldown = 0;
+
+  // Inline cache slots handed out to F_CALL_OTHER_SITE instructions so
+  // far; epilog() stores the count in program_t::num_call_sites.
+  int num_call_sites = 0;
+
+  // Facts the program cache (vm/internal/program_cache.h) needs about the
+  // compile that just finished, beyond the program_t itself. Reset by
+  // start_new_file() (master_calls by prolog()); `includes` is filled by
+  // epilog() from A_INCLUDES.
+  //   includes              every #include'd file, as resolved on disk
+  //   string_switch_tables  bytecode offset (the byte after F_SWITCH) of
+  //                         each string switch, whose case keys are
+  //                         shared-string addresses sorted by address
+  //   master_calls          every master apply the compile consulted,
+  //                         see compile_apply_master()
+  //   save_binary           PRAGMA_SAVE_BINARY was still on at the end
+  std::vector<std::string> includes;
+  std::vector<uint32_t> string_switch_tables;
+  std::vector<CompileMasterCall> master_calls;
+  bool save_binary = false;
 };
 extern CompileState g_compile;
 
+// safe_apply_master_ob() for applies the compiler consults mid-compile;
+// also logs the call in g_compile.master_calls. The arguments must be
+// strings or numbers.
+struct svalue_t* compile_apply_master(int fun, int num_arg);
+
 inline vm_context_t*& compiler_vm_context = g_compile.vm_context;
 inline std::vector<Diagnostic>& compiler_diags = g_compile.diags;
 
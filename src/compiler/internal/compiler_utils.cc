@@ -12,6 +12,7 @@
 #include "lexer.h"
 #include "compiler.h"
 #include "vm/vm.h"
+#include "vm/internal/program_cache.h"
 
 #define OR_BUFFER | T_BUFFER
 
@@ -100,6 +101,11 @@ void init_instrs() {
   add_instr_name("ne_range", "f_extract_range(0);\n", F_NE_RANGE, T_ARRAY | T_STRING OR_BUFFER);
   add_instr_name("global", "C_GLOBAL(%i);\n", F_GLOBAL, T_ANY);
   add_instr_name("local", "C_LOCAL(%i);\n", F_LOCAL, T_ANY);
+  add_instr_name("local_local_add", 0, F_LOCAL_LOCAL_ADD, T_ANY);
+  add_instr_name("local_index", 0, F_LOCAL_INDEX, T_ANY);
+  add_instr_name("global_index", 0, F_GLOBAL_INDEX, T_ANY);
+  add_instr_name("local_number_branch", 0, F_LOCAL_NUMBER_BRANCH, -1);
+  add_instr_name("call_other_site", 0, F_CALL_OTHER_SITE, T_ANY);
   add_instr_name("make_ref", "c_make_ref(%i);\n", F_MAKE_REF, T_REF);
   add_instr_name("kill_refs", "c_kill_refs(%i);\n", F_KILL_REFS, T_ANY);
   add_instr_name("ref", "C_REF(%i);\n", F_REF, T_ANY);
@@ -251,3 +257,20 @@ void report_compile_diagnostic(const Diagnostic& d) {
   copy_and_push_string(text.c_str());
   safe_apply_master_ob(APPLY_LOG_ERROR, 2);
 }
+
+svalue_t* compile_apply_master(int fun, int num_arg) {
+  CompileMasterCall call{fun, {}, 0, 0};
+  for (int i = 0; i < num_arg; i++) {
+    svalue_t* arg = sp - num_arg + 1 + i;
+    if (arg->type == T_STRING) {
+      call.args.emplace_back(arg->u.string);
+    } else {
+      call.args.emplace_back(std::to_string(arg->u.number));
+      call.number_args |= 1U << i;
+    }
+  }
+  svalue_t* ret = safe_apply_master_ob(fun, num_arg);
+  call.result = program_cache_digest(ret);
+  g_compile.master_calls.push_back(std::move(call));
+  return ret;
+}
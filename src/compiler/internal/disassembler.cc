@@ -367,7 +367,7 @@ static void disassemble(DisSink& sink, char* code, int start, int end, program_t
     }
 
     auto saved_pc = pc;
-    instr = *pc++;
+    instr = EXTRACT_UCHAR(pc++);
     buff[0] = 0;
     sarg = 0;
 
@@ -574,6 +574,7 @@ static void disassemble(DisSink& sink, char* code, int start, int end, program_t
         break;
       }
       case F_GLOBAL_LVALUE:
+      case F_GLOBAL_INDEX:
       case F_GLOBAL: {
         short iarg;
         LOAD2(iarg, pc);
@@ -598,6 +599,7 @@ static void disassemble(DisSink& sink, char* code, int start, int end, program_t
       case F_TRANSFER_LOCAL:
       case F_LOCAL:
       case F_LOCAL_LVALUE:
+      case F_LOCAL_INDEX:
       case F_VOID_ASSIGN_LOCAL:
       case F_REF:
       case F_REF_LVALUE:
@@ -619,6 +621,25 @@ static void disassemble(DisSink& sink, char* code, int start, int end, program_t
         sprintf(buff, "LV%d < %" LPC_INT_FMTSTR_P " branch back %04x (%04x)", i, iarg, sarg,
                 offset);
         break;
+      case F_LOCAL_LOCAL_ADD:
+        sprintf(buff, "LV%d + LV%d", EXTRACT_UCHAR(pc), EXTRACT_UCHAR(pc + 1));
+        pc += 2;
+        break;
+      case F_LOCAL_NUMBER_BRANCH: {
+        // 1-byte local, the F_BRANCH_xx it replaces, sizeof(LPC_INT)
+        // literal, 2-byte forward branch offset.
+        i = EXTRACT_UCHAR(pc++);
+        int const kind = EXTRACT_UCHAR(pc++);
+        COPY_INT(&iarg, pc);
+        pc += sizeof(LPC_INT);
+        COPY_SHORT(&sarg, pc);
+        offset = (pc - code) + sarg;
+        pc += 2;
+        sprintf(buff, "LV%d, %" LPC_INT_FMTSTR_P " %s %04x (%04x)", i, iarg,
+                query_instr_name(kind), static_cast<unsigned>(sarg),
+                static_cast<unsigned>(offset));
+        break;
+      }
       case F_LOOP_COND_LOCAL:
         i = EXTRACT_UCHAR(pc++);
         iarg = *pc++;
@@ -848,6 +869,13 @@ static void disassemble(DisSink& sink, char* code, int start, int end, program_t
         sprintf(buff, "EFUN: %s(%d)", query_instr_name(efun), efun);
         break;
       }
+      case F_CALL_OTHER_SITE: {
+        unsigned short site;
+        LOAD_SHORT(site, pc);
+        auto args = EXTRACT_UCHAR(pc++);
+        sprintf(buff, "SITE %d (ARGS: %d)", site, args);
+        break;
+      }
       case F_EFUN0:
       case F_EFUN1:
       case F_EFUN2:
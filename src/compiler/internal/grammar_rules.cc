@@ -76,7 +76,7 @@ bool rule_inheritence(parse_node_t** result_node, int type_mod,
     push_malloced_string(add_slash(main_file_name()));
     push_malloced_string(string_copy(inherit_path.c_str(), "inherit_program"));
     push_number((type_mod & DECL_PRIVATE) ? 1 : 0);
-    svalue_t* ret = safe_apply_master_ob(APPLY_INHERIT_PROGRAM, 3);
+    svalue_t* ret = compile_apply_master(APPLY_INHERIT_PROGRAM, 3);
     if (ret && ret != reinterpret_cast<svalue_t*>(-1)) {
       if (ret->type == T_STRING) {
         inherit_path = ScratchString(ret->u.string);
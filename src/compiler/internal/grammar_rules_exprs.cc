@@ -116,7 +116,7 @@ LPC_INT rule_efun_override(const ScratchString* identifier) {
     push_malloced_string(the_file_name(current_file));
     share_and_push_string(identifier->c_str());
     push_malloced_string(add_slash(main_file_name()));
-    svalue_t* ret = safe_apply_master_ob(APPLY_VALID_OVERRIDE, 3);
+    svalue_t* ret = compile_apply_master(APPLY_VALID_OVERRIDE, 3);
     if (!MASTER_APPROVED(ret)) {
       yyerror("Invalid simulated efunction override");
       res = -1;
@@ -129,7 +129,7 @@ LPC_INT rule_efun_override_new() {
   push_malloced_string(the_file_name(current_file));
   push_constant_string("new");
   push_malloced_string(add_slash(main_file_name()));
-  svalue_t* res = safe_apply_master_ob(APPLY_VALID_OVERRIDE, 3);
+  svalue_t* res = compile_apply_master(APPLY_VALID_OVERRIDE, 3);
   if (!MASTER_APPROVED(res)) {
     yyerror("Invalid simulated efunction override");
     return -1;
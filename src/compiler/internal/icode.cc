@@ -37,6 +37,8 @@ static void i_generate_loop(int /*test_first*/, parse_node_t* /*block*/, parse_n
                             parse_node_t* /*test*/);
 static void i_update_branch_list(parse_node_t* /*bl*/, const char* /*what*/);
 static int try_to_push(int /*kind*/, int /*value*/);
+static int try_to_fuse(parse_node_t* /*expr*/);
+static void add_forward_branch(void);
 
 static int foreach_depth = 0;
 
@@ -358,6 +360,48 @@ static int try_to_push(int kind, int value) {
   return 0;
 }
 
+/* F_TRANSFER_LOCAL pushes exactly what F_LOCAL does. */
+static int is_local_read(parse_node_t* expr) {
+  return IS_NODE(expr, NODE_OPCODE_1, F_LOCAL) || IS_NODE(expr, NODE_OPCODE_1, F_TRANSFER_LOCAL);
+}
+
+/*
+ * Superinstructions: emit one fused opcode for the commonest short runs
+ * (see the end of ops.spec). Returns 1 if it generated the whole of 'expr'.
+ */
+static int try_to_fuse(parse_node_t* expr) {
+  switch (expr->v.number) {
+    case F_ADD:
+      /* local + local */
+      if (is_local_read(expr->l.expr) && is_local_read(expr->r.expr)) {
+        end_pushes();
+        ins_byte(F_LOCAL_LOCAL_ADD);
+        ins_byte(expr->l.expr->l.number);
+        ins_byte(expr->r.expr->l.number);
+        return 1;
+      }
+      break;
+    case F_INDEX:
+      /* index, local/global, F_INDEX */
+      if (is_local_read(expr->r.expr)) {
+        i_generate_node(expr->l.expr);
+        end_pushes();
+        ins_byte(F_LOCAL_INDEX);
+        ins_byte(expr->r.expr->l.number);
+        return 1;
+      }
+      if (IS_NODE(expr->r.expr, NODE_OPCODE_1, F_GLOBAL)) {
+        i_generate_node(expr->l.expr);
+        end_pushes();
+        ins_byte(F_GLOBAL_INDEX);
+        INS_GLOBAL_INDEX(expr->r.expr->l.number);
+        return 1;
+      }
+      break;
+  }
+  return 0;
+}
+
 namespace {
 // A left-nested chain of binary/unary/ternary operators (e.g. tens of
 // thousands of '+' terms) builds a parse tree of matching depth with no
@@ -403,6 +447,9 @@ void i_generate_node(parse_node_t* expr) {
       expr = expr->r.expr;
     /* fall through */
     case NODE_BINARY_OP:
+      if (try_to_fuse(expr)) {
+        break;
+      }
       i_generate_node(expr->l.expr);
     /* fall through */
     case NODE_UNARY_OP:
@@ -772,6 +819,9 @@ void i_generate_node(parse_node_t* expr) {
           mem_block[A_PROGRAM].block[addr] = static_cast<char>(0xf0 + i);
         } else {
           mem_block[A_PROGRAM].block[addr] = static_cast<char>(i * 0x10 + 0x0f);
+          // The keys are shared-string addresses; a program cache image
+          // has to rewrite (and re-sort) them, so remember where they are.
+          g_compile.string_switch_tables.push_back(static_cast<uint32_t>(addr));
         }
       }
       i_update_branch_list(branch_list[CJ_BREAK_SWITCH], "switch break");
@@ -871,8 +921,17 @@ void i_generate_node(parse_node_t* expr) {
 
       generate_expr_list(expr->r.expr);
       end_pushes();
-      /* max_arg == -1 must use F_EFUNV so that varargs expansion works*/
-      if (expr->l.number < 4 && instrs[f].max_arg != -1) {
+      /* call_other() with a constant function name gets an inline cache
+       * (type & 1 marks an argument expanded with ...) */
+      if (f == F__CALL_OTHER && expr->l.number >= 2 && !(expr->r.expr->type & 1) &&
+          !(expr->r.expr->r.expr->type & 1) &&
+          expr->r.expr->r.expr->v.expr->kind == NODE_STRING &&
+          g_compile.num_call_sites < USHRT_MAX) {
+        ins_byte(F_CALL_OTHER_SITE);
+        ins_short(g_compile.num_call_sites++);
+        ins_byte(expr->l.number); /* num args */
+      } else if (expr->l.number < 4 && instrs[f].max_arg != -1) {
+        /* max_arg == -1 must use F_EFUNV so that varargs expansion works*/
         ins_byte(F_EFUN0 + expr->l.number); /* F_EFUN0 to F_EFUN3 */
         ins_short(f);                       /* efun instruction */
       } else {
@@ -978,6 +1037,16 @@ static void i_generate_if_branch(parse_node_t* node, int invert) {
           break;
       }
   }
+  if (generate_both && is_local_read(node->l.expr) && node->r.expr->kind == NODE_NUMBER) {
+    /* local, number, F_BRANCH_xx */
+    end_pushes();
+    ins_byte(F_LOCAL_NUMBER_BRANCH);
+    ins_byte(node->l.expr->l.number);
+    ins_byte(branch);
+    ins_int(node->r.expr->v.number);
+    add_forward_branch();
+    return;
+  }
   if (generate_both) {
     i_generate_node(node->l.expr);
     i_generate_node(node->r.expr);
@@ -999,6 +1068,11 @@ void i_generate_inherited_init_call(int index, short f) {
 void i_generate_forward_branch(char b) {
   end_pushes();
   ins_byte(b);
+  add_forward_branch();
+}
+
+/* Leave room for a branch offset here, filled in by i_update_forward_branch() */
+static void add_forward_branch() {
   if (nforward_branches == nforward_branches_max) {
     nforward_branches_max += 10;
     forward_branches =
@@ -1149,6 +1223,9 @@ void optimize_icode(char* start, char* pc, char* end) {
       case F_CALL_FUNCTION_BY_ADDRESS:
         pc += 3;
         break;
+      case F_LOCAL_NUMBER_BRANCH:
+        pc += 2 + sizeof(LPC_INT) + 2;
+        break;
       case F_BRANCH_NE:
       case F_BRANCH_GE:
       case F_BRANCH_LE:
@@ -1248,6 +1325,8 @@ void optimize_icode(char* start, char* pc, char* end) {
       case F_NEXT_FOREACH:
       case F_GLOBAL:
       case F_GLOBAL_LVALUE:
+      case F_GLOBAL_INDEX:
+      case F_LOCAL_LOCAL_ADD:
       case F_STRING:
 #ifdef F_JUMP_WHEN_ZERO
       case F_JUMP_WHEN_ZERO:
@@ -1263,6 +1342,7 @@ void optimize_icode(char* start, char* pc, char* end) {
       case F_WHILE_DEC:
       case F_LOCAL:
       case F_LOCAL_LVALUE:
+      case F_LOCAL_INDEX:
       case F_REF:
       case F_REF_LVALUE:
       case F_SSCANF:
@@ -1313,6 +1393,9 @@ void optimize_icode(char* start, char* pc, char* end) {
         pc++;
         break;
       }
+      case F_CALL_OTHER_SITE:
+        pc += 3;
+        break;
       case F_EFUNV:
         pc++;
         // fall through
@@ -261,6 +261,7 @@ static pragma_t our_pragmas[] = {{"strict_types", PRAGMA_STRICT_TYPES},
                                  {"warnings", PRAGMA_WARNINGS},
                                  {"optimize", PRAGMA_OPTIMIZE},
                                  {"show_error_context", PRAGMA_ERROR_CONTEXT},
+                                 {"save_binary", PRAGMA_SAVE_BINARY},
                                  {nullptr, 0}};
 
 void handle_pragma(char* str) {
@@ -1352,6 +1353,10 @@ static void start_new_file_prepared(char* prepared_base, size_t prepared_body, v
   rule_clear_operand_ranges();
   compiler_directive_start_line = 0;
   g_compile.class_def_cooldown = 0;
+  g_compile.num_call_sites = 0;
+  g_compile.includes.clear();
+  g_compile.string_switch_tables.clear();
+  g_compile.save_binary = false;
 
   // lpc_lex_reset pops any pushed buffers an aborted compile left stacked
   // (it walks lpc_lex_pushed_depth(), so the kind stack must still be
@@ -2077,7 +2082,7 @@ void init_include_path() {
   }
 
   push_malloced_string(add_slash(current_file));
-  svalue_t* ret = safe_apply_master_ob(APPLY_GET_INCLUDE_PATH, 1);
+  svalue_t* ret = compile_apply_master(APPLY_GET_INCLUDE_PATH, 1);
 
   if (!ret || ret == reinterpret_cast<svalue_t*>(-1)) {
     return;
@@ -2205,7 +2210,7 @@ bool lpc_lex_handle_include(std::string_view rest, void* yyscanner) {
       push_malloced_string(add_slash(main_file_name()));
       push_malloced_string(add_slash(current_file));
       push_malloced_string(string_copy(filename.c_str(), "include_file"));
-      svalue_t* ret = safe_apply_master_ob(APPLY_INCLUDE_FILE, 3);
+      svalue_t* ret = compile_apply_master(APPLY_INCLUDE_FILE, 3);
       if (ret && ret != reinterpret_cast<svalue_t*>(-1)) {
         if (ret->type == T_STRING) {
           if (filename != ret->u.string) {
@@ -39,6 +39,7 @@
 #define __FFI_ALLOWED_LIBRARIES__ CFG_STR(16)
 #define __OS_ENV_READABLE__ CFG_STR(17)
 #define __OS_ENV_WRITABLE__ CFG_STR(18)
+#define __RC_PROGRAM_CACHE_DIR__ CFG_STR(19)
 
 #define RC_LAST_CONFIG_STR CFG_STR(255)
 /*
@@ -116,6 +117,10 @@
 #define __RC_ENABLE_MSP__ CFG_INT(63)
 #define __RC_ENABLE_MSDP__ CFG_INT(64)
 #define __RC_DISPLAY_PRELOAD_PROGRESS__ CFG_INT(65)
+#define __RC_MAX_INPUT_BUFFER_SIZE__ CFG_INT(66)
+#define __RC_SWEEP_BUDGET_USEC__ CFG_INT(67)
+#define __RC_ASYNC_WORKER_THREADS__ CFG_INT(68)
+#define __RC_ASYNC_IO_URING__ CFG_INT(69)
 
 #define RC_LAST_CONFIG_INT CFG_INT(255)
 #endif /* RUNTIME_CONFIG_H */
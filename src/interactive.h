@@ -5,7 +5,10 @@
 
 #include "vm/vm.h"  // FIXME: for union string_or_func
 
+/* default for 'maximum input buffer size', the cap ip->text grows to */
 #define MAX_TEXT (1 * 1024 * 1024)
+/* size ip->text starts at, and shrinks back to once drained */
+#define INITIAL_TEXT 512
 
 #define I_NOECHO 0x1          /* input_to flag */
 #define I_NOESC 0x2           /* input_to flag */
@@ -56,7 +59,8 @@ struct interactive_t {
   int local_port;      /* which of our ports they connected to    */
   int external_port;   /* external port index for connection      */
   const char* prompt;  /* prompt string for interactive object    */
-  char text[MAX_TEXT]; /* input buffer for interactive object     */
+  char* text;          /* input buffer for interactive object     */
+  int text_size;       /* allocated size of text                  */
   int text_end;        /* first free char in buffer               */
   int text_start;      /* where we are up to in user command buffer */
   time_t last_time;    /* time of last command executed           */
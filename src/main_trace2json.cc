@@ -0,0 +1,63 @@
+#include "base/std.h"
+
+#include <iostream>
+#include <fstream>
+#include <string>
+
+#include <argparse/argparse.hpp>
+
+#include "base/internal/tracing.h"
+
+int main(int argc, char** argv) {
+  argparse::ArgumentParser program("trace2json");
+
+  program.add_argument("trace_file").help("binary trace written by trace_start(), - for stdin");
+  program.add_argument("json_file")
+      .default_value("-")
+      .help("json file to write, if omitted, then stdout is used");
+
+  try {
+    program.parse_args(argc, argv);
+  } catch (const std::exception& err) {
+    std::cerr << err.what() << std::endl;
+    std::cerr << program;
+    return 1;
+  }
+
+  TraceData data;
+  std::string error;
+  auto trace_file = program.get("trace_file");
+  bool ok;
+  if (trace_file == "-") {
+    ok = read_trace_binary(std::cin, &data, &error);
+  } else {
+    std::ifstream ifs(trace_file, std::ios::binary);
+    if (!ifs) {
+      std::cerr << "Error: cannot open file " << trace_file << std::endl;
+      return 1;
+    }
+    ok = read_trace_binary(ifs, &data, &error);
+  }
+  if (!ok) {
+    std::cerr << "Error: " << trace_file << ": " << error << std::endl;
+    return 1;
+  }
+
+  auto json_file = program.get("json_file");
+  if (json_file == "-") {
+    write_trace_json(data, std::cout);
+  } else {
+    std::ofstream ofs(json_file, std::ios::binary);
+    if (!ofs) {
+      std::cerr << "Error: cannot open file " << json_file << std::endl;
+      return 1;
+    }
+    write_trace_json(data, ofs);
+  }
+
+  if (data.dropped) {
+    std::cerr << data.dropped << " events were dropped when the trace buffers wrapped."
+              << std::endl;
+  }
+  return 0;
+}
@@ -22,6 +22,7 @@
 #include <event2/event.h>     // for EV_TIMEOUT, etc
 #include <event2/listener.h>  // for evconnlistener_free, etc
 #include <event2/util.h>      // for evutil_closesocket, etc
+#include <algorithm>          // for min, max
 #include <cstring>            // for memcpy
 // Network stuff
 #ifndef _WIN32
@@ -346,6 +347,22 @@ interactive_t* new_user(port_def_t* port, evutil_socket_t fd, sockaddr* addr,
 }
 
 namespace {
+/*
+ * Make room in ip->text for the input pending in the user's bufferevent.
+ * Only a 1/16 share of the cap is required (falling short of that drops an
+ * overlong command, see comm_reserve_input_space()); beyond it the buffer
+ * grows as far as its cap allows. Returns the usable free space.
+ */
+int reserve_pending_input(interactive_t* ip) {
+  size_t const pending = evbuffer_get_length(bufferevent_get_input(ip->ev_buffer));
+  size_t const required = std::min<size_t>(pending, CONFIG_INT(__RC_MAX_INPUT_BUFFER_SIZE__) / 16);
+  int text_space = comm_reserve_input_space(ip, std::max<size_t>(required, 1));
+  if (static_cast<size_t>(text_space) < pending) {
+    text_space = comm_grow_input_buffer(ip, ip->text_end + pending) - ip->text_end;
+  }
+  return text_space;
+}
+
 /*
  * Read pending data for a user into user->interactive->text.
  * This also does telnet negotiation.
@@ -364,18 +381,14 @@ void get_user_data(interactive_t* ip) {
       // Impossible, we don't handle it here.
       break;
     case PORT_TYPE_TELNET:
-      text_space = comm_reserve_input_space(ip, sizeof(ip->text) / 16);
-      break;
-
     case PORT_TYPE_ASCII:
-      // Like PORT_TYPE_TELNET: PORT_TYPE_ASCII also accumulates into
-      // ip->text (below) tracked by ip->text_end, so the read must be
-      // bounded by the ACTUAL remaining room there, not by the local
-      // scratch buffer's size -- falling through to the `default:` case
-      // (which just uses sizeof(buf)) let a client withholding a
-      // newline grow ip->text_end near MAX_TEXT and then overflow
-      // ip->text on the next read.
-      text_space = comm_reserve_input_space(ip, sizeof(ip->text) / 16);
+      // Both accumulate into ip->text tracked by ip->text_end, so the read
+      // must be bounded by the ACTUAL room there, not by the local scratch
+      // buffer's size -- otherwise a client withholding a newline could
+      // grow ip->text_end to the end of ip->text and overflow it on the
+      // next read. Size the room to what is pending, so the buffer only
+      // grows as far as the input actually needs.
+      text_space = reserve_pending_input(ip);
       break;
 
     case PORT_TYPE_MUD:
@@ -434,6 +447,12 @@ void get_user_data(interactive_t* ip) {
       break;
 
     case PORT_TYPE_MUD:
+      // Room for the message plus the terminating NUL added below; the
+      // length prefix was already checked against the cap.
+      if (comm_grow_input_buffer(ip, ip->text_end + num_bytes + 1) < ip->text_end + num_bytes + 1) {
+        remove_interactive(ip->ob, 0);
+        break;
+      }
       memcpy(ip->text + ip->text_end, buf, num_bytes);
       ip->text_end += num_bytes;
 
@@ -443,7 +462,7 @@ void get_user_data(interactive_t* ip) {
           int const msg_len = *reinterpret_cast<volatile int*>(ip->text);
           // Reject non-positive (a negative prefix would drive a negative
           // text_space) and oversized message lengths.
-          if (msg_len <= 0 || msg_len > MAX_TEXT - 5) {
+          if (msg_len <= 0 || msg_len > CONFIG_INT(__RC_MAX_INPUT_BUFFER_SIZE__) - 5) {
             remove_interactive(ip->ob, 0);
           }
         } else {
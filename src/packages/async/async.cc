@@ -2,13 +2,18 @@
 
 #include "packages/async/async.h"
 
+#include <algorithm>
+#include <atomic>
 #include <chrono>
+#include <condition_variable>
 #include <deque>
+#include <event2/event.h>
 #include <memory>
 #include <mutex>
 #include <set>
 #include <string>
 #include <thread>
+#include <vector>
 
 #if HAVE_DIRENT_H
 #include <dirent.h>
@@ -39,10 +44,16 @@
 
 #include "packages/core/file.h"  // check_valid_path, FIXME
 
+#ifdef HAVE_LINUX_IO_URING_H
+#include "packages/async/async_uring.h"
+#endif
+
 namespace {
 
 enum atypes { AREAD, AWRITE, AGETDIR, ADBEXEC, ADONE };
 
+const char* const atype_names[] = {"read", "write", "getdir", "db_exec"};
+
 enum astates { BUSY, DONE };
 
 struct Request {
@@ -65,6 +76,15 @@ struct Request {
      registering stack frame is gone. fun->args/fun->narg are repointed at
      this array's storage; null when there are no bound args. */
   array_t* bound_args = nullptr;
+  /* When the request was queued, for the latency reported by mud_status. */
+  std::chrono::steady_clock::time_point queued_at;
+#ifdef HAVE_LINUX_IO_URING_H
+  /* Progress of a request served by io_uring (see uring_step()). */
+  int step = 0;
+  int fd = -1;
+  size_t transferred = 0;
+  struct statx stx;
+#endif
 };
 
 /* Capture the current user context on a new request (issue #1104). */
@@ -82,24 +102,79 @@ struct Work {
 
 std::deque<struct Work*> reqs;
 std::mutex reqs_lock;
+// Workers sleep on this while reqs is empty.
+// Both condition variables are deliberately never destroyed: pool workers
+// are still waiting on reqs_cv when exit() runs static destructors, and
+// destroying a condition variable with waiters blocks forever.
+std::condition_variable& reqs_cv = *new std::condition_variable;
+// complete_all_asyncio() sleeps on this until every request has finished.
+std::condition_variable& drained_cv = *new std::condition_variable;
+
+// The worker pool. Threads are started on demand, up to the configured
+// 'async worker threads', and then stay for the life of the driver, waiting
+// on reqs_cv for more work. Guarded by reqs_lock.
+int workers_started = 0;
+int workers_idle = 0;
 
 // Works a worker thread is CURRENTLY processing: popped from reqs but not yet
 // moved to finished_reqs. Guarded by reqs_lock so async_mark_request() (main
 // thread, via check_memory) can account for their callback funptr /
 // command_giver during that window -- otherwise a DEBUGMALLOC sweep that lands
 // mid-processing false-flags the ref (Windows Debug hit this on async_read.lpc).
-//
-// This is a SET, not a single pointer: do_stuff() spawns a fresh worker thread
-// whenever reqs is momentarily empty, which happens while an earlier worker is
-// still inside a slow w->func() (it has already popped its request). So two or
-// more workers can run at once; a single `current_work` pointer only tracked
-// the last one and left the others' refs unaccounted -> flaky "Bad ref count"
-// (gcc Debug hit this via the async_* tests firing in quick succession).
+// Every worker in the pool may be inside a slow w->func() at once, so this is
+// a set rather than a single pointer.
 std::set<struct Work*> current_works;
 
+// async_db_exec() requests queued or running on a handle's DbWorker (see
+// below) and not yet in finished_reqs. Guarded by reqs_lock; counted so
+// complete_all_asyncio() waits for them too.
+int db_pending = 0;
+
+bool all_drained() { return reqs.empty() && current_works.empty() && db_pending == 0; }
+
+// Completion queue: workers push, the main thread drains it in check_reqs().
 std::deque<struct Request*> finished_reqs;
 std::mutex finished_reqs_lock;
 
+// Requests check_reqs() has taken off finished_reqs and is running the
+// callbacks of. Main thread only; kept visible for async_mark_request().
+std::deque<struct Request*> completed_reqs;
+
+// One libevent event wakes the main loop for any number of completions:
+// only the worker that finds wakeup_pending clear activates it, and the
+// main thread clears it before draining finished_reqs, so a completion
+// published after that point activates it again.
+struct event* wakeup_event = nullptr;
+std::atomic<bool> wakeup_pending{false};
+
+struct AsyncStats {
+  uint64_t queued[ADONE];
+  uint64_t completed[ADONE];
+  uint64_t latency_usec[ADONE];  // total, queued until callback
+  uint64_t max_latency_usec[ADONE];
+  uint64_t max_queue_depth;
+  uint64_t wakeups;
+  uint64_t uring_requests;   // started on io_uring
+  uint64_t uring_fallbacks;  // of those, handed to the workers part way
+} stats;
+
+void on_async_wakeup(evutil_socket_t /*fd*/, short /*what*/, void* /*arg*/) {
+  stats.wakeups++;
+  check_reqs();
+}
+
+void wake_main_loop() {
+  if (wakeup_pending.exchange(true)) {
+    return;
+  }
+  if (wakeup_event) {
+    event_active(wakeup_event, EV_TIMEOUT, 0);
+  } else {
+    add_walltime_event(std::chrono::milliseconds(0),
+                       TickEvent::callback_type([] { check_reqs(); }));
+  }
+}
+
 void thread_func() {
   Tracer::setThreadName("Package Async thread");
 
@@ -108,23 +183,23 @@ void thread_func() {
   while (true) {
     struct Work* w = nullptr;
     {
-      std::lock_guard<std::mutex> const lock(reqs_lock);
-      if (reqs.empty()) {
-        return;
-      }
+      std::unique_lock<std::mutex> lock(reqs_lock);
+      workers_idle++;
+      reqs_cv.wait(lock, [] { return !reqs.empty(); });
+      workers_idle--;
       w = reqs.front();
       reqs.pop_front();
       current_works.insert(w);  // in-flight: keep it accountable while we process
     }
 
-    if (w) {
-      {
-        ScopedTracer const work_tracer("Async thread work", EventCategory::DEFAULT,
-                                       [=] { return json{{"type", w->data->type}}; });
+    {
+      ScopedTracer const work_tracer("Async thread work", EventCategory::DEFAULT,
+                                     [=] { return json{{"type", w->data->type}}; });
 
-        w->func(w->data);
-      }
-      if (w->data->status == DONE) {
+      w->func(w->data);
+    }
+    if (w->data->status == DONE) {
+      {
         // Clear current_work and publish to finished_reqs atomically
         // w.r.t. async_mark_request (which takes both locks in this
         // order) so the funptr is marked exactly once across the move.
@@ -133,46 +208,84 @@ void thread_func() {
         current_works.erase(w);
         finished_reqs.push_back(w->data);
         delete w;
-      } else {
-        std::lock_guard<std::mutex> const lock(reqs_lock);
-        current_works.erase(w);
-        reqs.push_back(w);
+        if (all_drained()) {
+          drained_cv.notify_all();
+        }
       }
-
-      add_walltime_event(std::chrono::milliseconds(0),
-                         TickEvent::callback_type([] { check_reqs(); }));
+      wake_main_loop();
+    } else {
+      std::lock_guard<std::mutex> const lock(reqs_lock);
+      current_works.erase(w);
+      reqs.push_back(w);
     }
   }
 }
 
-void do_stuff(void* (*func)(struct Request*), struct Request* data) {
-  std::lock_guard<std::mutex> const lock(reqs_lock);
-
-  if (reqs.empty()) {
-    std::thread(thread_func).detach();
+void init_wakeup_event() {
+  if (!wakeup_event && g_event_base) {
+    wakeup_event = event_new(g_event_base, -1, 0, on_async_wakeup, nullptr);
   }
+}
+
+void do_stuff(void* (*func)(struct Request*), struct Request* data) {
+  init_wakeup_event();
 
   auto* i = new Work;
   i->func = func;
   i->data = data;
+  // Requests io_uring hands back part way were already counted.
+  bool const fresh = data->queued_at == std::chrono::steady_clock::time_point{};
+  if (fresh) {
+    data->queued_at = std::chrono::steady_clock::now();
+  }
 
+  std::lock_guard<std::mutex> const lock(reqs_lock);
   reqs.push_back(i);
+  if (fresh) {
+    stats.queued[data->type]++;
+  }
+  stats.max_queue_depth = std::max<uint64_t>(stats.max_queue_depth, reqs.size());
+
+  if (workers_idle < static_cast<int>(reqs.size()) &&
+      workers_started < CONFIG_INT(__RC_ASYNC_WORKER_THREADS__)) {
+    workers_started++;
+    std::thread(thread_func).detach();
+  }
+  reqs_cv.notify_one();
 }
 
 void* gzreadthread(struct Request* req) {
   gzFile file = gzopen(req->path.c_str(), "rb");
-  req->ret = gzread(file, (void*)(req->data.data()), req->data.size());
-  req->status = DONE;
+  if (!file) {
+    req->ret = -1;
+    req->status = DONE;
+    return nullptr;
+  }
+  // A plain file is read into a buffer of exactly its size. A compressed
+  // one (or one whose size stat() can't tell, like /proc) starts there or
+  // at 64 KiB and doubles as it fills, up to 'maximum read file size'.
+  size_t const max_size = CONFIG_INT(__MAX_READ_FILE_SIZE__);
+  struct stat st;
+  size_t const file_size = stat(req->path.c_str(), &st) == 0 ? st.st_size : 0;
+  req->data.resize(std::min(max_size, file_size ? file_size : size_t{64 * 1024}));
+
+  size_t size = 0;
+  int ret = 0;
+  while (size < req->data.size()) {
+    ret = gzread(file, (void*)(req->data.data() + size), req->data.size() - size);
+    if (ret <= 0) break;
+    size += ret;
+    if (size == req->data.size() && size < max_size && !(gzdirect(file) && size >= file_size)) {
+      req->data.resize(std::min(max_size, size * 2));
+    }
+  }
   gzclose(file);
+  req->data.resize(size);
+  req->ret = ret < 0 ? -1 : static_cast<int>(size);
+  req->status = DONE;
   return nullptr;
 }
 
-int aio_gzread(struct Request* req) {
-  req->status = BUSY;
-  do_stuff(gzreadthread, req);
-  return 0;
-}
-
 void* gzwritethread(struct Request* req) {
   int const fd = open(req->path.c_str(),
                       req->flags & 1 ? O_CREAT | O_WRONLY | O_TRUNC : O_CREAT | O_WRONLY | O_APPEND,
@@ -202,8 +315,167 @@ void* writethread(struct Request* req) {
   return nullptr;
 }
 
+#ifdef HAVE_LINUX_IO_URING_H
+/*
+ * The io_uring engine. A request is a chain of operations, one in flight
+ * at a time, each queued from the completion of the one before:
+ *
+ *   read:  statx -> openat -> read... -> close
+ *   write: openat -> write... -> close
+ *
+ * Reads are sized from statx. A file that turns out to be gzip'd (or has
+ * no usable size) is handed to the worker threads, which go through zlib.
+ * Everything runs on the main thread; finished requests are delivered
+ * through the same completion queue and wakeup as the workers'.
+ */
+enum usteps { USTAT, UOPEN, UREAD, UWRITE };
+
+// Requests with an operation on the ring. Main thread only.
+std::set<struct Request*> uring_reqs;
+
+void uring_finish(struct Request* req, int ret) {
+  if (req->fd >= 0) {
+    uring_close(req->fd, nullptr);
+    req->fd = -1;
+  }
+  uring_reqs.erase(req);
+  req->ret = ret;
+  req->status = DONE;
+  {
+    std::lock_guard<std::mutex> const lock(finished_reqs_lock);
+    finished_reqs.push_back(req);
+  }
+  wake_main_loop();
+}
+
+void uring_fallback(struct Request* req) {
+  if (req->fd >= 0) {
+    uring_close(req->fd, nullptr);
+    req->fd = -1;
+  }
+  uring_reqs.erase(req);
+  stats.uring_fallbacks++;
+  do_stuff(gzreadthread, req);
+}
+
+void uring_step(void* data, int res) {
+  auto* req = static_cast<struct Request*>(data);
+  switch (req->step) {
+    case USTAT: {
+      if (res < 0) {
+        uring_finish(req, -1);
+        return;
+      }
+      if (!S_ISREG(req->stx.stx_mode) || req->stx.stx_size == 0) {
+        uring_fallback(req);
+        return;
+      }
+      size_t const max_size = CONFIG_INT(__MAX_READ_FILE_SIZE__);
+      req->data.resize(std::min<size_t>(max_size, req->stx.stx_size));
+      req->step = UOPEN;
+      uring_openat(req->path.c_str(), O_RDONLY, 0, req);
+      return;
+    }
+    case UOPEN:
+      if (res < 0) {
+        uring_finish(req, -1);
+        return;
+      }
+      req->fd = res;
+      if (req->type == AREAD) {
+        req->step = UREAD;
+        uring_read(req->fd, (void*)req->data.data(), req->data.size(), 0, req);
+      } else {
+        req->step = UWRITE;
+        // Offset -1: the file position, which O_TRUNC/O_APPEND already set.
+        uring_write(req->fd, req->data.data(), req->data.size(), -1, req);
+      }
+      return;
+    case UREAD:
+      if (res < 0) {
+        uring_finish(req, -1);
+        return;
+      }
+      req->transferred += res;
+      if (res > 0 && req->transferred < req->data.size()) {
+        uring_read(req->fd, (void*)(req->data.data() + req->transferred),
+                   req->data.size() - req->transferred, req->transferred, req);
+        return;
+      }
+      req->data.resize(req->transferred);
+      if (req->data.size() >= 2 && req->data[0] == '\x1f' && req->data[1] == '\x8b') {
+        uring_fallback(req);
+        return;
+      }
+      uring_finish(req, static_cast<int>(req->transferred));
+      return;
+    case UWRITE:
+      if (res < 0) {
+        uring_finish(req, -1);
+        return;
+      }
+      req->transferred += res;
+      if (res > 0 && req->transferred < req->data.size()) {
+        uring_write(req->fd, req->data.data() + req->transferred,
+                    req->data.size() - req->transferred, -1, req);
+        return;
+      }
+      uring_finish(req, static_cast<int>(req->transferred));
+      return;
+  }
+}
+
+// Start `req` on io_uring if it is enabled, available and has room;
+// false means the caller should use the worker threads.
+bool aio_uring(struct Request* req) {
+  static int available = -1;
+  if (!CONFIG_INT(__RC_ASYNC_IO_URING__) || !g_event_base) {
+    return false;
+  }
+  if (available < 0) {
+    available = uring_init(g_event_base, 256, uring_step);
+    if (!available) {
+      debug_message("async io_uring: not available, using worker threads.\n");
+    }
+  }
+  if (!available || uring_in_flight() >= uring_capacity()) {
+    return false;
+  }
+  if (!wakeup_event) {
+    wakeup_event = event_new(g_event_base, -1, 0, on_async_wakeup, nullptr);
+  }
+
+  req->queued_at = std::chrono::steady_clock::now();
+  stats.queued[req->type]++;
+  stats.uring_requests++;
+  uring_reqs.insert(req);
+  if (req->type == AREAD) {
+    req->step = USTAT;
+    uring_statx(req->path.c_str(), &req->stx, req);
+  } else {
+    req->step = UOPEN;
+    uring_openat(req->path.c_str(),
+                 req->flags & 1 ? O_CREAT | O_WRONLY | O_TRUNC : O_CREAT | O_WRONLY | O_APPEND,
+                 S_IRWXU | S_IRWXG, req);
+  }
+  return true;
+}
+#endif
+
+int aio_gzread(struct Request* req) {
+  req->status = BUSY;
+#ifdef HAVE_LINUX_IO_URING_H
+  if (aio_uring(req)) return 0;
+#endif
+  do_stuff(gzreadthread, req);
+  return 0;
+}
+
 int aio_write(struct Request* req) {
   req->status = BUSY;
+#ifdef HAVE_LINUX_IO_URING_H
+  if (aio_uring(req)) return 0;
+#endif
   do_stuff(writethread, req);
   return 0;
 }
@@ -215,10 +487,14 @@ void* readthread(struct Request* req) {
     req->status = DONE;
     return nullptr;
   }
-  // Bound the read by the buffer's ACTUAL size, not max_size() (~2^62) --
-  // the caller sizes req->data before dispatching (mirror gzreadthread just
-  // above, which correctly uses .size()). A short read shrinks the buffer;
-  // a negative return leaves it untouched.
+  // Size the buffer from the file, bounded by 'maximum read file size' (a
+  // file fstat() reports as empty, like those in /proc, gets the whole
+  // bound). A short read shrinks the buffer; a negative return leaves it
+  // untouched.
+  size_t const max_size = CONFIG_INT(__MAX_READ_FILE_SIZE__);
+  struct stat st;
+  size_t const file_size = fstat(fd, &st) == 0 ? st.st_size : 0;
+  req->data.resize(file_size ? std::min(max_size, file_size) : max_size);
   auto size = read(fd, (void*)(req->data.data()), req->data.size());
   close(fd);
   if (size >= 0) {
@@ -238,17 +514,41 @@ int aio_read(struct Request* req) {
 }  // namespace
 
 #ifdef F_ASYNC_DB_EXEC
-pthread_mutex_t* db_mut = nullptr;
+// Each database handle gets a thread of its own for async_db_exec(), so a
+// slow query on one connection never holds up another, while the queries
+// on one connection run (and their callbacks fire) in the order they were
+// issued. The worker is started by the handle's first async_db_exec() and
+// lives until db_close() (async_db_close()), when it fails whatever is still
+// queued and deletes itself.
+struct DbWorker {
+  db_t* db;
+  std::deque<struct Request*> queue;
+  struct Request* running = nullptr;
+  bool closing = false;
+  std::mutex lock;  // guards everything above except db
+  std::condition_variable cv;
+
+  // For db_status(); guarded by lock.
+  size_t max_depth = 0;
+  uint64_t executed = 0;
+  uint64_t latency_usec = 0;  // total, queued until the result is ready
+  uint64_t max_latency_usec = 0;
+};
+
+namespace {
+
+// Every live DbWorker, for async_mark_request(). Lock order: reqs_lock,
+// db_workers_lock, DbWorker::lock, finished_reqs_lock. A worker never holds
+// its own lock while it waits for db->lock.
+std::set<DbWorker*> db_workers;
+std::mutex db_workers_lock;
 
-void* dbexecthread(struct Request* req) {
+void db_execute(db_t* db, struct Request* req) {
   ScopedTracer const work_tracer("db_exec", EventCategory::DEFAULT,
                                  [=] { return json{req->data}; });
 
-  pthread_mutex_lock(db_mut);
-  // see add_db_exec
-  db_t* db = find_db_conn(req->handle);
   int ret = -1;
-  if (db && db->type->execute) {
+  if (db->type->execute) {
     if (db->type->cleanup) {
       db->type->cleanup(&(db->c));
     }
@@ -266,18 +566,123 @@ void* dbexecthread(struct Request* req) {
   } else {
     req->path = std::string("No database exec function!");
   }
-  pthread_mutex_unlock(db_mut);
-
   req->ret = ret;
-  req->status = DONE;
-  return nullptr;
 }
 
-int aio_db_exec(struct Request* req) {
+void db_worker_func(DbWorker* w) {
+  Tracer::setThreadName("Package Async db thread");
+
+  while (true) {
+    struct Request* req;
+    {
+      std::unique_lock<std::mutex> lock(w->lock);
+      w->cv.wait(lock, [=] { return w->closing || !w->queue.empty(); });
+      if (w->queue.empty()) {
+        break;
+      }
+      req = w->running = w->queue.front();
+      w->queue.pop_front();
+    }
+
+    {
+      std::lock_guard<std::mutex> const dblock(w->db->lock);
+      // db_close() detaches the worker under this same lock; after that
+      // the connection is gone, or is already somebody else's.
+      if (w->db->worker == w) {
+        db_execute(w->db, req);
+      } else {
+        req->ret = -1;
+        req->path = "Database handle closed";
+      }
+    }
+    req->status = DONE;
+
+    {
+      // Clear running and publish atomically w.r.t. async_mark_request().
+      std::lock_guard<std::mutex> const lock(w->lock);
+      std::lock_guard<std::mutex> const flock(finished_reqs_lock);
+      w->running = nullptr;
+      uint64_t const latency = std::chrono::duration_cast<std::chrono::microseconds>(
+                                   std::chrono::steady_clock::now() - req->queued_at)
+                                   .count();
+      w->executed++;
+      w->latency_usec += latency;
+      w->max_latency_usec = std::max(w->max_latency_usec, latency);
+      finished_reqs.push_back(req);
+    }
+    {
+      std::lock_guard<std::mutex> const lock(reqs_lock);
+      if (--db_pending == 0 && all_drained()) {
+        drained_cv.notify_all();
+      }
+    }
+    wake_main_loop();
+  }
+
+  {
+    std::lock_guard<std::mutex> const lock(db_workers_lock);
+    db_workers.erase(w);
+  }
+  delete w;
+}
+
+int aio_db_exec(db_t* db, struct Request* req) {
+  init_wakeup_event();
   req->status = BUSY;
-  do_stuff(dbexecthread, req);
+  req->queued_at = std::chrono::steady_clock::now();
+  {
+    std::lock_guard<std::mutex> const lock(reqs_lock);
+    stats.queued[ADBEXEC]++;
+    db_pending++;
+  }
+
+  DbWorker* w = db->worker;  // only ever written on this thread
+  if (!w) {
+    w = new DbWorker;
+    w->db = db;
+    {
+      std::lock_guard<std::mutex> const lock(db_workers_lock);
+      db_workers.insert(w);
+    }
+    {
+      std::lock_guard<std::mutex> const lock(db->lock);
+      db->worker = w;
+    }
+    std::thread(db_worker_func, w).detach();
+  }
+
+  std::lock_guard<std::mutex> const lock(w->lock);
+  w->queue.push_back(req);
+  w->max_depth = std::max(w->max_depth, w->queue.size() + (w->running ? 1 : 0));
+  w->cv.notify_one();
   return 0;
 }
+
+}  // namespace
+
+void async_db_close(db_t* db) {
+  DbWorker* w = db->worker;
+  if (!w) {
+    return;
+  }
+  db->worker = nullptr;
+  std::lock_guard<std::mutex> const lock(w->lock);
+  w->closing = true;
+  w->cv.notify_one();
+}
+
+void async_db_status(db_t* db, outbuffer_t* out) {
+  DbWorker* w = db->worker;
+  if (!w) {
+    return;
+  }
+  std::lock_guard<std::mutex> const lock(w->lock);
+  outbuf_addv(out,
+              "Async queue:   %zu queued, %d running, %zu max\n"
+              "Async queries: %" PRIu64 ", avg %" PRIu64 " usec, max %" PRIu64 " usec\n",
+              w->queue.size(), w->running ? 1 : 0, w->max_depth, w->executed,
+              w->executed ? w->latency_usec / w->executed : 0, w->max_latency_usec);
+}
 #endif
 
 #ifdef F_ASYNC_GETDIR
@@ -321,12 +726,9 @@ int aio_getdir(struct Request* req) {
 #endif
 
 int add_read(const char* fname, function_to_call_t* fun) {
-  const auto read_file_max_size = CONFIG_INT(__MAX_READ_FILE_SIZE__);
-
   if (fname) {
     auto* req = new Request();
-    // printf("fname: %s\n", fname);
-    req->data.resize(read_file_max_size);
+    // The engine sizes the buffer once it knows the file's size.
     req->fun = fun;
     req->type = AREAD;
     capture_command_giver(req);
@@ -387,7 +789,8 @@ int add_write(const char* fname, const char* buf, int size, char flags, function
 }
 
 #ifdef F_ASYNC_DB_EXEC
-int add_db_exec(int handle, const char* sql, function_to_call_t* fun, array_t* bound_args) {
+int add_db_exec(db_t* db, int handle, const char* sql, function_to_call_t* fun,
+                array_t* bound_args) {
   auto* req = new Request();
   req->fun = fun;
   req->bound_args = bound_args;
@@ -395,7 +798,7 @@ int add_db_exec(int handle, const char* sql, function_to_call_t* fun, array_t* b
   capture_command_giver(req);
   req->handle = handle;
   req->data = sql;
-  return aio_db_exec(req);
+  return aio_db_exec(db, req);
 }
 #endif
 
@@ -475,12 +878,31 @@ void handle_db_exec(struct Request* req) {
 void check_reqs() {
   ScopedTracer const tracer("Async callback");
 
-  std::lock_guard<std::mutex> const lock(finished_reqs_lock);
-  while (!finished_reqs.empty()) {
-    auto* req = finished_reqs.front();
-    finished_reqs.pop_front();
+  wakeup_pending = false;
+  {
+    std::lock_guard<std::mutex> const lock(finished_reqs_lock);
+    if (completed_reqs.empty()) {
+      completed_reqs.swap(finished_reqs);
+    } else {
+      // check_reqs() re-entered from a callback: keep the outer batch.
+      completed_reqs.insert(completed_reqs.end(), finished_reqs.begin(), finished_reqs.end());
+      finished_reqs.clear();
+    }
+  }
+
+  auto const now = std::chrono::steady_clock::now();
+  while (!completed_reqs.empty()) {
+    auto* req = completed_reqs.front();
+    completed_reqs.pop_front();
 
     enum atypes const type = (req->type);
+    if (type < ADONE) {
+      uint64_t const latency =
+          std::chrono::duration_cast<std::chrono::microseconds>(now - req->queued_at).count();
+      stats.completed[type]++;
+      stats.latency_usec[type] += latency;
+      stats.max_latency_usec[type] = std::max(stats.max_latency_usec[type], latency);
+    }
     req->type = ADONE;
     /* Restore the user context captured at registration (issue #1104). */
     object_t* new_command_giver = nullptr;
@@ -525,14 +947,58 @@ void check_reqs() {
 }
 
 void complete_all_asyncio() {
-  while (true) {
-    std::lock_guard<std::mutex> const lock(reqs_lock);
+#ifdef HAVE_LINUX_IO_URING_H
+  // Runs io_uring chains to the end; any handed to the workers on the way
+  // are waited for below.
+  uring_wait();
+#endif
+  {
+    std::unique_lock<std::mutex> lock(reqs_lock);
+    drained_cv.wait(lock, all_drained);
+  }
+  check_reqs();
+}
 
-    if (reqs.empty()) {
-      break;
+uint64_t async_status(outbuffer_t* out, int verbose) {
+  if (verbose == -1) return 0;
+
+  size_t depth, in_flight, finished;
+  int started;
+  {
+    std::lock_guard<std::mutex> const rlock(reqs_lock);
+    std::lock_guard<std::mutex> const flock(finished_reqs_lock);
+    depth = reqs.size();
+    in_flight = current_works.size();
+    finished = finished_reqs.size();
+    started = workers_started;
+  }
+
+  if (verbose == 1) {
+    outbuf_add(out, "Async requests:\n");
+    outbuf_add(out, "-------------------------\n");
+    outbuf_addv(out,
+                "Workers:\t\t%d of %d\nQueued:\t\t\t%zu\nRunning:\t\t%zu\n"
+                "Awaiting callback:\t%zu\nMax queued:\t\t%" PRIu64 "\nWakeups:\t\t%" PRIu64
+                "\n",
+                started, CONFIG_INT(__RC_ASYNC_WORKER_THREADS__), depth, in_flight, finished,
+                stats.max_queue_depth, stats.wakeups);
+    outbuf_addv(out, "%-10s %10s %10s %14s %14s\n", "Type", "Queued", "Completed",
+                "Avg usec", "Max usec");
+    for (int i = 0; i < ADONE; i++) {
+      outbuf_addv(out, "%-10s %10" PRIu64 " %10" PRIu64 " %14" PRIu64 " %14" PRIu64 "\n",
+                  atype_names[i], stats.queued[i], stats.completed[i],
+                  stats.completed[i] ? stats.latency_usec[i] / stats.completed[i] : 0,
+                  stats.max_latency_usec[i]);
     }
+#ifdef HAVE_LINUX_IO_URING_H
+    outbuf_addv(out, "io_uring:\t\t%" PRIu64 " requests, %" PRIu64 " handed to workers, %u in flight\n",
+                stats.uring_requests, stats.uring_fallbacks, uring_in_flight());
+#endif
+  } else {
+    outbuf_addv(out, "%-20s %8zu queued, %zu running, %d workers\n", "Async requests", depth,
+                in_flight, started);
   }
-  check_reqs();
+  return 0;
 }
 
 #ifdef F_ASYNC_READ
@@ -649,24 +1115,16 @@ void f_async_db_exec() {
     error("Attempt to exec on an invalid database handle\n");
   }
 
-  if (!db_mut) {
-    db_mut = (pthread_mutex_t*)DMALLOC(sizeof(pthread_mutex_t), TAG_PERMANENT, "async_db_exec");
-    pthread_mutex_init(db_mut, nullptr);
-  }
   handed_off = true;
   bound_args_handed_off = true;
-  add_db_exec((sp - 1)->u.number, sp->u.string, cb.release(), bound_args);
+  add_db_exec(db, (sp - 1)->u.number, sp->u.string, cb.release(), bound_args);
   pop_2_elems();
 }
 #endif
 
 void async_mark_request() {
 #ifdef DEBUGMALLOC_EXTENSIONS
-  std::lock_guard<std::mutex> const lock(reqs_lock);
-  std::lock_guard<std::mutex> const flock(finished_reqs_lock);
-
-  for (auto& work : reqs) {
-    auto* req = work->data;
+  auto mark = [](struct Request* req) {
     if (req->fun != nullptr) {
       req->fun->f.fp->hdr.extra_ref++;
     }
@@ -676,33 +1134,49 @@ void async_mark_request() {
     if (req->bound_args != nullptr) {
       req->bound_args->extra_ref++;
     }
+  };
+
+  std::lock_guard<std::mutex> const lock(reqs_lock);
+#ifdef F_ASYNC_DB_EXEC
+  // Every worker's lock at once, so a request moving from running to
+  // finished_reqs is seen exactly once.
+  std::lock_guard<std::mutex> const dblock(db_workers_lock);
+  std::vector<std::unique_lock<std::mutex>> worker_locks;
+  for (auto* w : db_workers) {
+    worker_locks.emplace_back(w->lock);
+    for (auto* req : w->queue) {
+      mark(req);
+    }
+    if (w->running) {
+      mark(w->running);
+    }
+  }
+#endif
+  std::lock_guard<std::mutex> const flock(finished_reqs_lock);
+
+  for (auto& work : reqs) {
+    mark(work->data);
   }
 
   // Requests a worker is mid-processing (popped from reqs, not yet in
   // finished_reqs); guarded by reqs_lock, held above. There may be several
   // concurrent workers, so mark every in-flight work, not just one.
   for (auto* work : current_works) {
-    if (work->data->fun != nullptr) {
-      work->data->fun->f.fp->hdr.extra_ref++;
-    }
-    if (work->data->command_giver != nullptr) {
-      work->data->command_giver->extra_ref++;
-    }
-    if (work->data->bound_args != nullptr) {
-      work->data->bound_args->extra_ref++;
-    }
+    mark(work->data);
   }
 
-  for (auto& req : finished_reqs) {
-    if (req->fun != nullptr) {
-      req->fun->f.fp->hdr.extra_ref++;
-    }
-    if (req->command_giver != nullptr) {
-      req->command_giver->extra_ref++;
-    }
-    if (req->bound_args != nullptr) {
-      req->bound_args->extra_ref++;
-    }
+  for (auto* req : finished_reqs) {
+    mark(req);
+  }
+
+  // completed_reqs (and uring_reqs) are main-thread only, like this function.
+  for (auto* req : completed_reqs) {
+    mark(req);
+  }
+#ifdef HAVE_LINUX_IO_URING_H
+  for (auto* req : uring_reqs) {
+    mark(req);
   }
 #endif
+#endif
 }
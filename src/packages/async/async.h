@@ -1,7 +1,17 @@
 #ifndef ASYNC_H_
 #define ASYNC_H_
 
+#include <cstdint>
+
+struct outbuffer_t;
+struct db_t;
+
 void check_reqs();
 void complete_all_asyncio();
 void async_mark_request();
+uint64_t async_status(outbuffer_t* out, int verbose);
+
+// async_db_exec()'s per-handle worker; called with db->lock held.
+void async_db_close(db_t* db);
+void async_db_status(db_t* db, outbuffer_t* out);
 #endif /*ASYNC_H_*/
@@ -0,0 +1,246 @@
+#include "base/std.h"
+
+#include "packages/async/async_uring.h"
+
+#include <cerrno>
+#include <cstring>
+#include <event2/event.h>
+#include <fcntl.h>
+#include <linux/io_uring.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace {
+
+int ring_fd = -1;
+int completion_fd = -1;
+uring_callback_t on_complete = nullptr;
+
+struct {
+  unsigned* head;
+  unsigned* tail;
+  unsigned* ring_mask;
+  unsigned* array;
+  unsigned entries;
+  struct io_uring_sqe* sqes;
+} sq;
+
+struct {
+  unsigned* head;
+  unsigned* tail;
+  unsigned* ring_mask;
+  struct io_uring_cqe* cqes;
+} cq;
+
+// Prepared in the SQ ring but not yet handed to the kernel.
+unsigned sq_pending = 0;
+// Queued and not yet reaped.
+unsigned in_flight = 0;
+
+struct event* completion_event = nullptr;
+struct event* submit_event = nullptr;
+
+int sys_io_uring_setup(unsigned entries, struct io_uring_params* p) {
+  return static_cast<int>(syscall(__NR_io_uring_setup, entries, p));
+}
+
+int sys_io_uring_enter(unsigned to_submit, unsigned min_complete, unsigned flags) {
+  return static_cast<int>(
+      syscall(__NR_io_uring_enter, ring_fd, to_submit, min_complete, flags, nullptr, 0));
+}
+
+int sys_io_uring_register(unsigned opcode, void* arg, unsigned nr_args) {
+  return static_cast<int>(syscall(__NR_io_uring_register, ring_fd, opcode, arg, nr_args));
+}
+
+bool ops_supported() {
+  const int ops[] = {IORING_OP_STATX, IORING_OP_OPENAT, IORING_OP_READ, IORING_OP_WRITE,
+                     IORING_OP_CLOSE};
+  size_t const size = sizeof(struct io_uring_probe) + 256 * sizeof(struct io_uring_probe_op);
+  auto* probe = static_cast<struct io_uring_probe*>(calloc(1, size));
+  bool ok = sys_io_uring_register(IORING_REGISTER_PROBE, probe, 256) == 0;
+  for (auto op : ops) {
+    if (ok && (op > probe->last_op || !(probe->ops[op].flags & IO_URING_OP_SUPPORTED))) {
+      ok = false;
+    }
+  }
+  free(probe);
+  return ok;
+}
+
+void submit_pending() {
+  while (sq_pending > 0) {
+    int const ret = sys_io_uring_enter(sq_pending, 0, 0);
+    if (ret < 0) {
+      if (errno == EINTR) continue;
+      // EAGAIN/EBUSY: the kernel is short of resources; the entries stay in
+      // the ring and go out with the next submission or reap.
+      return;
+    }
+    sq_pending -= ret;
+  }
+}
+
+void reap() {
+  unsigned head = *cq.head;
+  while (head != __atomic_load_n(cq.tail, __ATOMIC_ACQUIRE)) {
+    auto* cqe = &cq.cqes[head & *cq.ring_mask];
+    auto* data = reinterpret_cast<void*>(static_cast<uintptr_t>(cqe->user_data));
+    int const res = cqe->res;
+    __atomic_store_n(cq.head, ++head, __ATOMIC_RELEASE);
+    in_flight--;
+    if (data) {
+      on_complete(data, res);
+    }
+  }
+  // Operations the callbacks chained on go out in this same pass.
+  submit_pending();
+}
+
+void on_completion(evutil_socket_t fd, short /*what*/, void* /*arg*/) {
+  uint64_t count;
+  while (read(fd, &count, sizeof(count)) > 0) {
+  }
+  reap();
+}
+
+void on_submit(evutil_socket_t /*fd*/, short /*what*/, void* /*arg*/) { submit_pending(); }
+
+struct io_uring_sqe* get_sqe(uint8_t opcode, int fd, void* data) {
+  unsigned const tail = *sq.tail;
+  if (tail - __atomic_load_n(sq.head, __ATOMIC_ACQUIRE) == sq.entries) {
+    // Only reachable if the kernel refused an earlier submission.
+    submit_pending();
+  }
+  unsigned const index = tail & *sq.ring_mask;
+  auto* sqe = &sq.sqes[index];
+  memset(sqe, 0, sizeof(*sqe));
+  sqe->opcode = opcode;
+  sqe->fd = fd;
+  sqe->user_data = reinterpret_cast<uintptr_t>(data);
+  sq.array[index] = index;
+  return sqe;
+}
+
+// Publish the entry get_sqe() returned; the whole batch is submitted once
+// control is back in the event loop.
+void queue_sqe() {
+  __atomic_store_n(sq.tail, *sq.tail + 1, __ATOMIC_RELEASE);
+  in_flight++;
+  if (sq_pending++ == 0) {
+    event_active(submit_event, EV_TIMEOUT, 0);
+  }
+}
+
+}  // namespace
+
+bool uring_init(struct event_base* base, unsigned entries, uring_callback_t callback) {
+  struct io_uring_params params {};
+  ring_fd = sys_io_uring_setup(entries, &params);
+  if (ring_fd < 0) {
+    ring_fd = -1;
+    return false;
+  }
+
+  size_t sq_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+  size_t cq_size = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+  bool const single_mmap = params.features & IORING_FEAT_SINGLE_MMAP;
+  if (single_mmap) {
+    sq_size = cq_size = std::max(sq_size, cq_size);
+  }
+  void* sq_ptr = mmap(nullptr, sq_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                      ring_fd, IORING_OFF_SQ_RING);
+  void* cq_ptr = single_mmap ? sq_ptr
+                             : mmap(nullptr, cq_size, PROT_READ | PROT_WRITE,
+                                    MAP_SHARED | MAP_POPULATE, ring_fd, IORING_OFF_CQ_RING);
+  void* sqes = mmap(nullptr, params.sq_entries * sizeof(struct io_uring_sqe),
+                    PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd, IORING_OFF_SQES);
+  completion_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+  if (sq_ptr == MAP_FAILED || cq_ptr == MAP_FAILED || sqes == MAP_FAILED || completion_fd < 0 ||
+      !ops_supported() ||
+      sys_io_uring_register(IORING_REGISTER_EVENTFD, &completion_fd, 1) != 0) {
+    // The mappings go away with the ring fd.
+    if (completion_fd >= 0) close(completion_fd);
+    close(ring_fd);
+    ring_fd = completion_fd = -1;
+    return false;
+  }
+
+  auto* sq_base = static_cast<char*>(sq_ptr);
+  sq.head = reinterpret_cast<unsigned*>(sq_base + params.sq_off.head);
+  sq.tail = reinterpret_cast<unsigned*>(sq_base + params.sq_off.tail);
+  sq.ring_mask = reinterpret_cast<unsigned*>(sq_base + params.sq_off.ring_mask);
+  sq.array = reinterpret_cast<unsigned*>(sq_base + params.sq_off.array);
+  sq.entries = params.sq_entries;
+  sq.sqes = static_cast<struct io_uring_sqe*>(sqes);
+
+  auto* cq_base = static_cast<char*>(cq_ptr);
+  cq.head = reinterpret_cast<unsigned*>(cq_base + params.cq_off.head);
+  cq.tail = reinterpret_cast<unsigned*>(cq_base + params.cq_off.tail);
+  cq.ring_mask = reinterpret_cast<unsigned*>(cq_base + params.cq_off.ring_mask);
+  cq.cqes = reinterpret_cast<struct io_uring_cqe*>(cq_base + params.cq_off.cqes);
+
+  on_complete = callback;
+  completion_event =
+      event_new(base, completion_fd, EV_READ | EV_PERSIST, on_completion, nullptr);
+  event_add(completion_event, nullptr);
+  submit_event = event_new(base, -1, 0, on_submit, nullptr);
+  return true;
+}
+
+unsigned uring_capacity() { return ring_fd < 0 ? 0 : sq.entries; }
+
+unsigned uring_in_flight() { return in_flight; }
+
+void uring_statx(const char* path, struct statx* out, void* data) {
+  auto* sqe = get_sqe(IORING_OP_STATX, AT_FDCWD, data);
+  sqe->addr = reinterpret_cast<uintptr_t>(path);
+  sqe->len = STATX_TYPE | STATX_SIZE;
+  sqe->off = reinterpret_cast<uintptr_t>(out);
+  queue_sqe();
+}
+
+void uring_openat(const char* path, int flags, mode_t mode, void* data) {
+  auto* sqe = get_sqe(IORING_OP_OPENAT, AT_FDCWD, data);
+  sqe->addr = reinterpret_cast<uintptr_t>(path);
+  sqe->len = mode;
+  sqe->open_flags = flags | O_CLOEXEC;
+  queue_sqe();
+}
+
+void uring_read(int fd, void* buf, unsigned len, uint64_t offset, void* data) {
+  auto* sqe = get_sqe(IORING_OP_READ, fd, data);
+  sqe->addr = reinterpret_cast<uintptr_t>(buf);
+  sqe->len = len;
+  sqe->off = offset;
+  queue_sqe();
+}
+
+void uring_write(int fd, const void* buf, unsigned len, uint64_t offset, void* data) {
+  auto* sqe = get_sqe(IORING_OP_WRITE, fd, data);
+  sqe->addr = reinterpret_cast<uintptr_t>(buf);
+  sqe->len = len;
+  sqe->off = offset;
+  queue_sqe();
+}
+
+void uring_close(int fd, void* data) {
+  get_sqe(IORING_OP_CLOSE, fd, data);
+  queue_sqe();
+}
+
+void uring_wait() {
+  while (in_flight > 0) {
+    int const ret = sys_io_uring_enter(sq_pending, 1, IORING_ENTER_GETEVENTS);
+    if (ret < 0 && errno != EINTR) {
+      return;
+    }
+    if (ret > 0) {
+      sq_pending -= ret;
+    }
+    reap();
+  }
+}
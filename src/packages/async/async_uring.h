@@ -0,0 +1,42 @@
+#ifndef PACKAGES_ASYNC_ASYNC_URING_H_
+#define PACKAGES_ASYNC_ASYNC_URING_H_
+
+/*
+ * A small io_uring ring driven from the libevent loop, for the async file
+ * efuns. Uses the raw syscalls (no liburing). Submissions made while LPC
+ * runs are batched into one io_uring_enter(); completions are signalled
+ * through an eventfd registered with the ring and reaped on the main
+ * thread, where each one is handed, with its result (a byte count, fd, 0,
+ * or -errno), to the callback given to uring_init().
+ *
+ * Callers must keep uring_in_flight() below uring_capacity(); every
+ * buffer and path passed in must stay valid until its completion.
+ */
+#include <cstdint>
+#include <sys/types.h>
+
+struct event_base;
+struct statx;
+
+using uring_callback_t = void (*)(void* data, int res);
+
+// Set up the ring; false if io_uring or one of the operations below is
+// unavailable on this kernel (or blocked, e.g. by seccomp).
+bool uring_init(struct event_base* base, unsigned entries, uring_callback_t on_complete);
+
+unsigned uring_capacity();
+unsigned uring_in_flight();
+
+// Queue an operation. `data` is passed back on completion; nullptr means
+// nobody is interested in the result.
+void uring_statx(const char* path, struct statx* out, void* data);
+void uring_openat(const char* path, int flags, mode_t mode, void* data);
+void uring_read(int fd, void* buf, unsigned len, uint64_t offset, void* data);
+void uring_write(int fd, const void* buf, unsigned len, uint64_t offset, void* data);
+void uring_close(int fd, void* data);
+
+// Block until every queued operation, including any queued by the
+// completion callback meanwhile, has completed.
+void uring_wait();
+
+#endif  // PACKAGES_ASYNC_ASYNC_URING_H_
@@ -377,6 +377,11 @@ void trace_start(string, int default: 10);
 // stop to collect tracing data right away.
 void trace_end();
 
+// start sampling LPC call stacks every N usec of driver CPU time
+void profile_start(int default: 1000);
+// stop sampling, return (and optionally write out) the collapsed stacks
+mapping profile_stop(string | void);
+
 // return highest resolution clock in platform dependent unit
 int perf_counter_ns();
 // Return nanosecond time
@@ -36,6 +36,10 @@
 #include "packages/core/custom_crypt.h"
 #include "packages/core/ed.h"
 #include "packages/core/heartbeat.h"
+#include "vm/internal/program_cache.h"
+#ifdef PACKAGE_ASYNC
+#include "packages/async/async.h"
+#endif
 
 int data_size(object_t* ob);
 void reload_object(object_t* obj);
@@ -172,7 +176,8 @@ void f_bind() {
 #endif
 
 static int print_cache_stats(outbuffer_t* ob, int verbose) {
-  auto size = apply_cache_items * sizeof(lookup_entry_s);
+  auto size =
+      apply_cache_slots * sizeof(apply_table_t::slot_t) + apply_tables * sizeof(apply_table_t);
   if (verbose == 1) {
     outbuf_add(ob, "Apply lookup cache information\n");
     outbuf_add(ob, "-------------------------------\n");
@@ -180,6 +185,12 @@ static int print_cache_stats(outbuffer_t* ob, int verbose) {
                 100 * (static_cast<LPC_FLOAT>(apply_cache_hits) / apply_cache_lookups));
     outbuf_addv(ob, "total lookup:     %10lu\n", apply_cache_lookups);
     outbuf_addv(ob, "cache hits:      %10lu\n", apply_cache_hits);
+    outbuf_addv(ob, "call site hits:  %10lu\n", apply_site_hits);
+    outbuf_addv(ob, "tables:          %10lu\n", apply_tables);
+    outbuf_addv(ob, "reused tables:   %10lu\n", apply_tables_shared);
+    outbuf_addv(ob, "entries:         %10lu\n", apply_cache_items);
+    outbuf_addv(ob, "%% slots used:    %10.2f\n",
+                100 * (static_cast<LPC_FLOAT>(apply_cache_items) / apply_cache_slots));
     outbuf_addv(ob, "cache size (bytes w/o overhead):  %10lu\n", size);
   } else if (verbose != -1) {
     outbuf_addv(ob, "%-20s %8lu %8lu\n", "Apply cache", apply_cache_items, size);
@@ -204,7 +215,10 @@ void f__call_other() {
   const char* funcname;
   int num_arg = st_num_arg;
   object_t* ob;
+  /* Only set for this one call, by F_CALL_OTHER_SITE */
+  apply_site_cache_t* site = call_other_site;
 
+  call_other_site = nullptr;
   if (current_object->flags & O_DESTRUCTED) { /* No external calls allowed */
     pop_n_elems(num_arg);
     push_undefined();
@@ -242,7 +256,8 @@ void f__call_other() {
     }
   }
   /* Send the remaining arguments to the function. */
-  if (apply(funcname, ob, num_arg - 2, ORIGIN_CALL_OTHER) == nullptr) { /* Function not found */
+  if (apply(funcname, ob, num_arg - 2, ORIGIN_CALL_OTHER, site) == nullptr) {
+    /* Function not found */
     pop_2_elems();
     push_undefined();
     return;
@@ -1747,6 +1762,9 @@ int calculate_and_maybe_print_memory_info(outbuffer_t* ob, int verbose) {
 
   auto total_users = (uint64_t)users_num(true);
   auto total_users_size = total_users * sizeof(interactive_t);
+  for (auto* user : users()) {
+    total_users_size += user->text_size;
+  }
   if (verbose != -1) {
     outbuf_addv(ob, "%-20s %8" PRIu64 " %8" PRIu64 "\n", "Interactives", total_users,
                 total_users_size);
@@ -1792,6 +1810,14 @@ int calculate_and_maybe_print_memory_info(outbuffer_t* ob, int verbose) {
   tot += scratchpad_status(ob, verbose);
   if (verbose && verbose != -1) outbuf_add(ob, "\n");
 
+  tot += program_cache_status(ob, verbose);
+  if (verbose && verbose != -1) outbuf_add(ob, "\n");
+
+#ifdef PACKAGE_ASYNC
+  tot += async_status(ob, verbose);
+  if (verbose && verbose != -1) outbuf_add(ob, "\n");
+#endif
+
   return tot;
 }
 }  // namespace
@@ -3786,6 +3812,7 @@ void f_request_clean_up() {
   // define clean_up() are put back on the sweep's query list (issue #917).
   if (!(ob->flags & O_DESTRUCTED) && function_exists(APPLY_CLEAN_UP, ob, 1)) {
     ob->flags |= O_WILL_CLEAN_UP;
+    sweep_schedule_object(ob);
     success = 1;
   }
   free_object(&sp->u.ob, "f_request_clean_up");
@@ -3811,6 +3838,7 @@ void f_set_clean_up() {
   if (!(ob->flags & O_DESTRUCTED) && function_exists(APPLY_CLEAN_UP, ob, 1)) {
     ob->flags |= O_WILL_CLEAN_UP;
   }
+  sweep_schedule_object(ob);
 
   if (st_num_arg == 2) {
     free_object(&(--sp)->u.ob, "f_set_clean_up:1");
@@ -3828,12 +3856,14 @@ void f_set_reset() {
   if (st_num_arg == 2) {
     (sp - 1)->u.ob->next_reset =
         g_current_gametick + time_to_next_gametick(std::chrono::seconds(sp->u.number));
+    sweep_schedule_object((sp - 1)->u.ob);
     free_object(&(--sp)->u.ob, "f_set_reset:1");
     sp--;
   } else {
     sp->u.ob->next_reset =
         g_current_gametick + time_to_next_gametick(std::chrono::seconds(
                                  time_to_reset / 2 + random_number(time_to_reset / 2)));
+    sweep_schedule_object(sp->u.ob);
     free_object(&(sp--)->u.ob, "f_set_reset:2");
   }
 }
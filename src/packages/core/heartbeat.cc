@@ -7,24 +7,81 @@
 #include "packages/core/heartbeat.h"
 
 #include <algorithm>
-#include <deque>
-#include <set>
+#include <queue>
+#include <unordered_map>
 #include <vector>
 
 struct heart_beat_t {
-  object_t* ob;              // nullptr also means deleted entries.
-  short heart_beat_ticks;    // remaining ticks
-  short time_to_heart_beat;  // interval
+  object_t* ob;
+  int time_to_heart_beat;  // interval
+  uint64_t seq;            // registration order, which is also execution order
+  uint64_t due;            // heartbeat round it next runs on
+  uint64_t stamp;          // identifies the one live hb_ref_t pointing here
+};
+
+// A scheduled run of a heartbeat. Rescheduling just files a new ref with a
+// new stamp; refs whose stamp no longer matches (or whose object lost its
+// heartbeat) are stale and dropped when reached.
+struct hb_ref_t {
+  object_t* ob;
+  uint64_t stamp;
+  uint64_t seq;
 };
 
 // Global pointer to current object executing heartbeat.
 object_t* g_current_heartbeat_obj;
 
 /*
- * TODO: ideally we should be using vector here for performance, however dealing with
- * enable/disable heartbeat during execution make it difficult to implement correctly.
+ * Heartbeats are bucketed by the round they are next due on, so a round
+ * only touches the objects that actually run in it instead of counting
+ * down every registered heartbeat.
+ *
+ * hb_wheel[due % HB_WHEEL_SIZE] holds the refs due on that round (or, for
+ * intervals longer than the wheel, on a later lap of it). Due refs run in
+ * registration order, the order the old single queue ran them in.
  */
-static std::deque<heart_beat_t> heartbeats, heartbeats_next;
+static std::unordered_map<object_t*, heart_beat_t> heartbeats;
+
+static const int HB_WHEEL_SIZE = 256;
+static std::vector<hb_ref_t> hb_wheel[HB_WHEEL_SIZE];
+// scratch vector the current slot is swapped into, keeps its capacity.
+static std::vector<hb_ref_t> hb_slot_scratch;
+
+struct hb_ref_later {
+  bool operator()(const hb_ref_t& a, const hb_ref_t& b) const { return a.seq > b.seq; }
+};
+// Refs due this round, in registration order.
+static std::priority_queue<hb_ref_t, std::vector<hb_ref_t>, hb_ref_later> hb_due;
+
+// Current (or last finished) heartbeat round.
+static uint64_t hb_round;
+static uint64_t hb_next_seq = 1;
+static uint64_t hb_next_stamp;
+
+// While call_heart_beat() runs: entries with seq in
+// (hb_current_seq, hb_round_start_seq) haven't had their turn this round.
+static bool hb_in_round;
+static uint64_t hb_current_seq;
+static uint64_t hb_round_start_seq;
+
+static heart_beat_t* live_heart_beat(const hb_ref_t& ref) {
+  auto it = heartbeats.find(ref.ob);
+  if (it == heartbeats.end() || it->second.stamp != ref.stamp) {
+    return nullptr;
+  }
+  return &it->second;
+}
+
+static void schedule_heart_beat(heart_beat_t& hb, uint64_t due) {
+  hb.due = due;
+  hb.stamp = ++hb_next_stamp;
+  hb_ref_t const ref{hb.ob, hb.stamp, hb.seq};
+  if (hb_in_round && due == hb_round) {
+    hb_due.push(ref);
+  } else {
+    hb_wheel[due % HB_WHEEL_SIZE].push_back(ref);
+  }
+}
 
 /* Call all heart_beat() functions in all objects.
  *
@@ -38,33 +95,50 @@ void call_heart_beat() {
       time_to_next_gametick(std::chrono::milliseconds(CONFIG_INT(__RC_HEARTBEAT_INTERVAL_MSEC__))),
       TickEvent::callback_type(call_heart_beat));
 
-  heartbeats.insert(heartbeats.end(), heartbeats_next.begin(), heartbeats_next.end());
-  heartbeats_next.clear();
-  // During the execution of heartbeat func, object can add/delete heartbeats, thus we can't use a
-  // simple loop here. Instead, we extract each heartbeats, execute it, add it to
-  // heartbeats_next. After all execution, heartbeats_after and heartbeats is swapped.
+  hb_round++;
+
+  // Pick this round's refs out of its slot; refs for a later lap stay.
+  auto& slot = hb_wheel[hb_round % HB_WHEEL_SIZE];
+  hb_slot_scratch.swap(slot);
+  for (auto& ref : hb_slot_scratch) {
+    auto* hb = live_heart_beat(ref);
+    if (hb == nullptr) {
+      continue;
+    }
+    if (hb->due == hb_round) {
+      hb_due.push(ref);
+    } else {
+      slot.push_back(ref);
+    }
+  }
+  hb_slot_scratch.clear();
+
+  // During the execution of heartbeat func, object can add/delete/modify
+  // heartbeats: additions and modifications are filed for a later round
+  // (or, for a not-yet-run entry shortened to 1, pushed onto hb_due) and
+  // removals leave stale refs behind, which are skipped.
   //
   // NOTE: The order of heartbeat execution is preserved.
-  while (!heartbeats.empty()) {
-    {
-      auto& hb = heartbeats.front();
-      // skip invalid entries.
-      if (hb.ob == nullptr || !(hb.ob->flags & O_HEART_BEAT) || hb.ob->flags & O_DESTRUCTED) {
-        heartbeats.pop_front();
-        continue;
-      }
-      // place into next queue.
-      heartbeats_next.push_back(hb);
-      heartbeats.pop_front();
+  hb_in_round = true;
+  hb_current_seq = 0;
+  hb_round_start_seq = hb_next_seq;
+  while (!hb_due.empty()) {
+    auto const ref = hb_due.top();
+    hb_due.pop();
+
+    auto* hb = live_heart_beat(ref);
+    if (hb == nullptr) {
+      continue;
     }
-    auto* curr_hb = &heartbeats_next.back();
-
-    if (--curr_hb->heart_beat_ticks > 0) {
+    auto* ob = hb->ob;
+    if (!(ob->flags & O_HEART_BEAT) || ob->flags & O_DESTRUCTED) {
+      heartbeats.erase(ob);
       continue;
     }
-    curr_hb->heart_beat_ticks = curr_hb->time_to_heart_beat;
+    hb_current_seq = hb->seq;
+    schedule_heart_beat(*hb, hb_round + hb->time_to_heart_beat);
+    hb = nullptr;
 
-    auto* ob = curr_hb->ob;
     // No heartbeat function
     if (ob->prog->heart_beat == 0) {
       continue;
@@ -112,27 +186,20 @@ void call_heart_beat() {
     restore_command_giver();
     current_interactive = nullptr;
     g_current_heartbeat_obj = nullptr;
-    curr_hb = nullptr;
   }
+  hb_in_round = false;
 } /* call_heart_beat() */
 
 // Query heartbeat interval for a object
-// NOTE: Not a very efficient function.
 int query_heart_beat(object_t* ob) {
   if (!(ob->flags & O_HEART_BEAT)) {
     return 0;
   }
-  for (auto& hb : heartbeats) {
-    if (hb.ob == ob) {
-      return hb.time_to_heart_beat;
-    }
-  }
-  for (auto& hb : heartbeats_next) {
-    if (hb.ob == ob) {
-      return hb.time_to_heart_beat;
-    }
+  auto it = heartbeats.find(ob);
+  if (it == heartbeats.end()) {
+    return 0;
   }
-  return 0;
+  return it->second.time_to_heart_beat;
 } /* query_heart_beat() */
 
 // Modifying heartbeat for a object.
@@ -140,8 +207,12 @@ int query_heart_beat(object_t* ob) {
 // NOTE: This may get called during heartbeat. Care must be taken to
 // make sure it works.
 //
-// Removing heartbeat just need to remove the flag from objects.
-// New heartbeats must be added to heartbeats_next.
+// Removing heartbeat drops the entry; its scheduled ref goes stale.
+// New heartbeats run `to` rounds from now, after every existing heartbeat
+// due on the same round. A modified heartbeat keeps its place in the
+// execution order, and if it hasn't had its turn in the running round yet
+// that turn counts as its first tick, as it did when every heartbeat was
+// counted down each round.
 int set_heart_beat(object_t* ob, int to) {
   if (ob->flags & O_DESTRUCTED) {
     return 0;
@@ -153,59 +224,30 @@ int set_heart_beat(object_t* ob, int to) {
     to = 1;
   }
 
-  // Here are 3 possible cases:
-  // 1) Object is modifying itself during its heartbeat execution.
-  // 2) Object currently have heartbeat and is in the queue.
-  // 3) Object currently doesn't have heartbeat.
-
-  // Removal: set the flag and hb will be deleted in next round.
+  // Removal: set the flag and drop the entry.
   if (to == 0) {
     ob->flags &= ~O_HEART_BEAT;
-
-    bool found = false;
-    for (auto& hb : heartbeats) {
-      if (hb.ob == ob) {
-        hb.ob = nullptr;
-        found = true;
-      }
-    }
-    for (auto& hb : heartbeats_next) {
-      if (hb.ob == ob) {
-        hb.ob = nullptr;
-        found = true;
-      }
-    }
-    return found ? 1 : 0;
+    return heartbeats.erase(ob) ? 1 : 0;
   }
   ob->flags |= O_HEART_BEAT;
 
-  heart_beat_t* target_hb = nullptr;
-  for (auto& hb : heartbeats) {
-    if (hb.ob == ob) {
-      target_hb = &hb;
-      break;
-    }
-  }
-  for (auto& hb : heartbeats_next) {
-    if (hb.ob == ob) {
-      target_hb = &hb;
-      break;
-    }
-  }
-  // Add: Didn't find target_hb, we need to create a new one.
-  if (target_hb == nullptr) {
-    target_hb = &heartbeats_next.emplace_back();
-    target_hb->ob = ob;
-    target_hb->time_to_heart_beat = to;
-    target_hb->heart_beat_ticks = to;
-    return 1;
-  } else {
-    // Modifying: target_hb is found.
-    target_hb->ob = ob;
-    target_hb->time_to_heart_beat = to;
-    target_hb->heart_beat_ticks = to;
+  auto it = heartbeats.find(ob);
+  // Add: Didn't find it, we need to create a new one.
+  if (it == heartbeats.end()) {
+    auto& hb = heartbeats[ob];
+    hb.ob = ob;
+    hb.time_to_heart_beat = to;
+    hb.seq = hb_next_seq++;
+    schedule_heart_beat(hb, hb_round + to);
     return 1;
   }
+  // Modifying: keep seq, reschedule.
+  auto& hb = it->second;
+  hb.time_to_heart_beat = to;
+  bool const runs_later_this_round =
+      hb_in_round && hb.seq > hb_current_seq && hb.seq < hb_round_start_seq;
+  schedule_heart_beat(hb, hb_round + to - (runs_later_this_round ? 1 : 0));
+  return 1;
 }
 
 int heart_beat_status(outbuffer_t* buf, int verbose) {
@@ -213,42 +255,39 @@ int heart_beat_status(outbuffer_t* buf, int verbose) {
     outbuf_add(buf, "Heart beat information:\n");
     outbuf_add(buf, "-----------------------\n");
     outbuf_addv(buf, "Number of objects with heart beat: %" PRIu64 ".\n",
-                heartbeats.size() + heartbeats_next.size());
+                static_cast<uint64_t>(heartbeats.size()));
   }
-  // may overcount, but this usually not called during heartbeat.
-  return (heartbeats.size() + heartbeats_next.size()) *
-         (sizeof(heart_beat_t*) + sizeof(heart_beat_t));
+  // ignores stale refs, but this usually not called during heartbeat.
+  return heartbeats.size() * (sizeof(heart_beat_t) + sizeof(hb_ref_t) + sizeof(void*));
 } /* heart_beat_status() */
 
 #ifdef F_HEART_BEATS
 array_t* get_heart_beats() {
-  std::vector<object_t*> result;
-  result.reserve(heartbeats.size() + heartbeats_next.size());
+  std::vector<const heart_beat_t*> result;
+  result.reserve(heartbeats.size());
 
   bool display_hidden = true;
 #ifdef F_SET_HIDE
   display_hidden = valid_hide(current_object);
 #endif
 
-  auto fn = [&](heart_beat_t& hb) {
-    if (hb.ob) {
-      if (hb.ob->flags & O_HIDDEN) {
-        if (!display_hidden) {
-          return;
-        }
+  for (auto& [ob, hb] : heartbeats) {
+    if (ob->flags & O_HIDDEN) {
+      if (!display_hidden) {
+        continue;
       }
-      result.push_back(hb.ob);
     }
-  };
-
-  std::for_each(heartbeats.begin(), heartbeats.end(), fn);
-  std::for_each(heartbeats_next.begin(), heartbeats_next.end(), fn);
+    result.push_back(&hb);
+  }
+  // Report them in execution order.
+  std::sort(result.begin(), result.end(),
+            [](const heart_beat_t* a, const heart_beat_t* b) { return a->seq < b->seq; });
 
   array_t* arr = allocate_empty_array(result.size());
   int i = 0;
-  for (auto* obj : result) {
+  for (const auto* hb : result) {
     arr->item[i].type = T_OBJECT;
-    arr->item[i].u.ob = obj;
+    arr->item[i].u.ob = hb->ob;
     add_ref(arr->item[i].u.ob, "get_heart_beats");
     i++;
   }
@@ -257,16 +296,9 @@ array_t* get_heart_beats() {
 #endif
 
 void check_heartbeats() {
-  std::set<object_t*> objset;
-  for (auto& hb : heartbeats) {
-    if (hb.ob) {
-      DEBUG_CHECK(!objset.insert(hb.ob).second, "Driver BUG: Duplicated/Missing heartbeats found");
-    }
-  }
-  for (auto& hb : heartbeats_next) {
-    if (hb.ob) {
-      DEBUG_CHECK(!objset.insert(hb.ob).second, "Driver BUG: Duplicated/Missing heartbeats found");
-    }
+  for (auto& [ob, hb] : heartbeats) {
+    DEBUG_CHECK(hb.ob != ob, "Driver BUG: Corrupted heartbeat table found");
+    DEBUG_CHECK(hb.due <= hb_round && !hb_in_round, "Driver BUG: Missed heartbeat found");
   }
 }
 
@@ -274,5 +306,8 @@ void clear_heartbeats() {
   // TODO: instead of clearing everything blindly, should go through all objects with heartbeat flag
   // and delete corresponding heartbeats, thus exposing leftovers.
   heartbeats.clear();
-  heartbeats_next.clear();
+  for (auto& slot : hb_wheel) {
+    slot.clear();
+  }
+  hb_due = {};
 }
@@ -1,6 +1,9 @@
 #include "base/package_api.h"
 
+#include <fstream>
+
 #include "file.h"
+#include "vm/internal/profiler.h"
 
 #ifdef F_DUMP_TRACE
 void f_dump_trace() { push_array(get_svalue_trace()); }
@@ -45,3 +48,44 @@ void f_trace_end() {
   Tracer::collect();
 }
 #endif
+
+#ifdef F_PROFILE_START
+void f_profile_start() {
+  auto interval_usec = sp->u.number;
+  if (interval_usec < 100 || interval_usec > 1000000) {
+    error("Invalid sampling interval, must be between 100 and 1000000 usec.\n");
+  }
+  if (!profile_start(interval_usec)) {
+    error("Sampling profiler is not supported on this platform.\n");
+  }
+  pop_stack();
+}
+#endif
+
+#ifdef F_PROFILE_STOP
+void f_profile_stop() {
+  profile_stop();
+  const auto& samples = profile_samples();
+
+  if (st_num_arg) {
+    const auto* realfile = check_valid_path(sp->u.string, current_object, "profile_stop", 1);
+    if (!realfile) {
+      error("Permission denied for profile file: %s\n", sp->u.string);
+    }
+    std::ofstream out(realfile, std::ofstream::out | std::ofstream::trunc);
+    for (const auto& [stack, count] : samples) {
+      out << stack << ' ' << count << '\n';
+    }
+    if (!out) {
+      error("Failed to write profile file: %s\n", sp->u.string);
+    }
+    pop_stack();
+  }
+
+  auto* m = allocate_mapping(samples.size());
+  for (const auto& [stack, count] : samples) {
+    add_mapping_pair(m, stack.c_str(), count);
+  }
+  push_refed_mapping(m);
+}
+#endif
@@ -53,6 +53,8 @@
  ****          for the dbdefn_t structure.  Minimum requirements would be
  ****          connect, close, fetch and execute and cleanup if you need to
  ****          cleanup memory allocated between searches.
+ ****        + prepare, execute_prepared and finalize (prepared statements)
+ ****          and fetch_rows (db_fetch_rows()) are optional.
  ****
  ****    TODO:
  ****      . Decent Error Message reporting
@@ -70,49 +72,41 @@
 #include "packages/core/file.h"
 #include "packages/core/outbuf.h"
 
-#ifdef PACKAGE_ASYNC
-#include <pthread.h>
+#ifdef F_ASYNC_DB_EXEC
+#include "packages/async/async.h"
 #endif
 
+#include <climits>
+#include <memory>
+#include <string>
+#include <vector>
+
 static int db_conn_alloc, db_conn_used;
-static db_t* db_conn_list;
+static db_t** db_conn_list;
 
 db_t* find_db_conn(int);
 static int create_db_conn();
 static void free_db_conn(db_t*);
-
-// package/async runs db_exec() queries on a DETACHED WORKER THREAD
-// (async.cc's dbexecthread), which locks db_mut around its
-// find_db_conn()+execute() on the shared db_conn_list / dbconn_t. Every
-// main-thread efun that touches a connection (or the list) must take the
-// SAME lock, or a concurrent async_db_exec() races a main-thread
+static int add_db_stmt(db_t*, void*);
+static void* find_db_stmt(db_t*, int);
+static void finalize_db_stmts(db_t*);
+
+// package/async runs each handle's async_db_exec() queries on a worker
+// thread of that handle's own (async.cc's DbWorker), holding db->lock
+// around the execute. Every main-thread efun that touches a connection must
+// take the SAME lock, or a concurrent async_db_exec() races a main-thread
 // db_close()/db_fetch()/db_commit()/db_rollback() on the same handle -- a
-// use-after-free (close frees the dbconn_t the worker is mid-execute on) or
-// a data race on the result set. Only f_db_exec() took the lock; the others
-// forgot it (the same "teardown path missing the primitive its sibling uses"
-// shape as AGENTS.md section 13's socket_acquire flag gap).
+// use-after-free (close frees what the worker is mid-execute on) or a data
+// race on the result set. The lock is per handle, so a slow query on one
+// connection never holds up another.
 //
-// db_mut is lazily created by the first async_db_exec(); a null db_mut means
-// no worker thread was ever spawned, so there is nothing to race and the
-// lock is unnecessary. Guarding on non-null keeps this a no-op for the
-// common (no async DB) case and avoids locking an uninitialized mutex.
+// The workers only ever see their own db_t, never db_conn_list, which is
+// why each db_t is allocated on its own and never freed: the list can grow
+// (and move) under a running query, and a closed slot is reused in place.
 #ifdef PACKAGE_ASYNC
-extern pthread_mutex_t* db_mut;
-namespace {
-struct DbAsyncLock {
-  DbAsyncLock() {
-    if (db_mut) pthread_mutex_lock(db_mut);
-  }
-  ~DbAsyncLock() {
-    if (db_mut) pthread_mutex_unlock(db_mut);
-  }
-  DbAsyncLock(const DbAsyncLock&) = delete;
-  DbAsyncLock& operator=(const DbAsyncLock&) = delete;
-};
-}  // namespace
-#define DB_ASYNC_LOCK() DbAsyncLock _db_async_lock_guard
+#define DB_ASYNC_LOCK(db) std::lock_guard<std::mutex> const _db_async_lock_guard((db)->lock)
 #else
-#define DB_ASYNC_LOCK() ((void)0)
+#define DB_ASYNC_LOCK(db) ((void)0)
 #endif
 
 #ifdef USE_MSQL
@@ -124,7 +118,8 @@ static void msql_cleanup(dbconn_t*);
 static char* msql_errormsg(dbconn_t*);
 
 static db_defn_t msql = {"mSQL", msql_connect, msql_close,   msql_execute, msql_fetch,
-                         NULL,   NULL,         msql_cleanup, NULL,         msql_errormsg};
+                         NULL,   NULL,         msql_cleanup, NULL,         msql_errormsg,
+                         NULL,   NULL,         NULL,         NULL};
 #endif
 
 #ifdef USE_MYSQL
@@ -134,9 +129,16 @@ static int MySQL_execute(dbconn_t*, const char*);
 static array_t* MySQL_fetch(dbconn_t*, int);
 static void MySQL_cleanup(dbconn_t*);
 static char* MySQL_errormsg(dbconn_t*);
-
-static db_defn_t mysql = {"MySQL", MySQL_connect, MySQL_close,   MySQL_execute, MySQL_fetch,
-                          nullptr, nullptr,       MySQL_cleanup, nullptr,       MySQL_errormsg};
+static void* MySQL_prepare(dbconn_t*, const char*);
+static int MySQL_execute_prepared(dbconn_t*, void*, svalue_t*, int);
+static array_t* MySQL_fetch_rows(dbconn_t*, int);
+static void MySQL_finalize(dbconn_t*, void*);
+
+static db_defn_t mysql = {
+    "MySQL",          MySQL_connect,          MySQL_close,   MySQL_execute,
+    MySQL_fetch,      nullptr,                nullptr,       MySQL_cleanup,
+    nullptr,          MySQL_errormsg,         MySQL_prepare, MySQL_execute_prepared,
+    MySQL_fetch_rows, MySQL_finalize};
 #endif
 
 #ifdef USE_POSTGRES
@@ -146,10 +148,16 @@ static int Postgres_execute(dbconn_t*, const char*);
 static array_t* Postgres_fetch(dbconn_t*, int);
 static void Postgres_cleanup(dbconn_t*);
 static char* Postgres_errormsg(dbconn_t*);
+static void* Postgres_prepare(dbconn_t*, const char*);
+static int Postgres_execute_prepared(dbconn_t*, void*, svalue_t*, int);
+static array_t* Postgres_fetch_rows(dbconn_t*, int);
+static void Postgres_finalize(dbconn_t*, void*);
 
 static db_defn_t postgres = {
-    "Postgres", Postgres_connect, Postgres_close, Postgres_execute, Postgres_fetch, NULL,
-    NULL,       Postgres_cleanup, NULL,           Postgres_errormsg};
+    "Postgres",          Postgres_connect,          Postgres_close,   Postgres_execute,
+    Postgres_fetch,      NULL,                      NULL,             Postgres_cleanup,
+    NULL,                Postgres_errormsg,         Postgres_prepare, Postgres_execute_prepared,
+    Postgres_fetch_rows, Postgres_finalize};
 #endif
 
 #ifdef USE_SQLITE3
@@ -159,14 +167,20 @@ static int SQLite3_execute(dbconn_t*, const char*);
 static array_t* SQLite3_fetch(dbconn_t*, int);
 static void SQLite3_cleanup(dbconn_t*);
 static char* SQLite3_errormsg(dbconn_t*);
+static void* SQLite3_prepare(dbconn_t*, const char*);
+static int SQLite3_execute_prepared(dbconn_t*, void*, svalue_t*, int);
+static array_t* SQLite3_fetch_rows(dbconn_t*, int);
+static void SQLite3_finalize(dbconn_t*, void*);
 
 static db_defn_t SQLite3 = {
-    "SQLite3", SQLite3_connect, SQLite3_close, SQLite3_execute, SQLite3_fetch, NULL,
-    NULL,      SQLite3_cleanup, NULL,          SQLite3_errormsg};
+    "SQLite3",          SQLite3_connect,          SQLite3_close,   SQLite3_execute,
+    SQLite3_fetch,      NULL,                     NULL,            SQLite3_cleanup,
+    NULL,               SQLite3_errormsg,         SQLite3_prepare, SQLite3_execute_prepared,
+    SQLite3_fetch_rows, SQLite3_finalize};
 #endif
 
-static db_defn_t no_db = {"None",  nullptr, nullptr, nullptr, nullptr,
-                          nullptr, nullptr, nullptr, nullptr, nullptr};
+static db_defn_t no_db = {"None",  nullptr, nullptr, nullptr, nullptr, nullptr, nullptr,
+                          nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr};
 
 /* valid_database
  *
@@ -214,13 +228,18 @@ void f_db_close() {
     error("Attempt to close an invalid database handle\n");
   }
 
-  // Serialize against package/async's DB worker thread (see DbAsyncLock).
-  DB_ASYNC_LOCK();
+  // Serialize against package/async's DB worker thread (see DB_ASYNC_LOCK).
+  DB_ASYNC_LOCK(db);
+#ifdef F_ASYNC_DB_EXEC
+  // Queries still queued on the handle fail rather than run.
+  async_db_close(db);
+#endif
 
   /* Cleanup any memory structures left around */
   if (db->type->cleanup) {
     db->type->cleanup(&(db->c));
   }
+  finalize_db_stmts(db);
 
   if (db->type->close) {
     ret = db->type->close(&(db->c));
@@ -255,7 +274,7 @@ void f_db_commit() {
     error("Attempt to commit an invalid database handle\n");
   }
 
-  DB_ASYNC_LOCK();  // serialize against the async DB worker thread
+  DB_ASYNC_LOCK(db);  // serialize against the async DB worker thread
 
   if (db->type->commit) {
     ret = db->type->commit(&(db->c));
@@ -395,9 +414,6 @@ void f_db_connect() {
  * NOTE: the number of rows on INSERT, UPDATE, and DELETE statements will
  * be zero since there is no result set.
  */
-#ifdef PACKAGE_ASYNC
-extern pthread_mutex_t* db_mut;
-#endif
 #ifdef F_DB_EXEC
 void f_db_exec() {
   int ret = 0;
@@ -414,9 +430,8 @@ void f_db_exec() {
     error("Attempt to exec on an invalid database handle\n");
   }
 
-#ifdef PACKAGE_ASYNC
-  pthread_mutex_lock(db_mut);
-#endif
+  DB_ASYNC_LOCK(db);  // serialize against the async DB worker thread
+
   if (db->type->cleanup) {
     db->type->cleanup(&(db->c));
   }
@@ -438,9 +453,75 @@ void f_db_exec() {
   } else {
     sp->u.number = ret;
   }
-#ifdef PACKAGE_ASYNC
-  pthread_mutex_unlock(db_mut);
+}
 #endif
+
+/* mixed db_execute_prepared(int handle, int statement, ...)
+ *
+ * Runs a statement made by db_prepare() with the remaining arguments bound
+ * to its placeholders in order: ints, floats, strings and buffers, with an
+ * undefined value binding NULL. Like db_exec() this ends the previous
+ * result set on the handle.
+ *
+ * Returns the number of rows changed by a statement that returns no rows,
+ * 0 for a query (its rows are read with db_fetch_rows() as they arrive),
+ * or an error string on failure.
+ */
+#ifdef F_DB_EXECUTE_PREPARED
+void f_db_execute_prepared() {
+  int i, ret = 0;
+  // valid_database() runs master LPC, which clobbers st_num_arg.
+  int const num_arg = st_num_arg;
+  int const num_params = num_arg - 2;
+  svalue_t* args = sp - num_arg + 1;
+  db_t* db;
+  void* stmt;
+
+  valid_database("execute_prepared", &the_null_array);
+
+  db = find_db_conn(args[0].u.number);
+  if (!db) {
+    error("Attempt to execute on an invalid database handle\n");
+  }
+
+  for (i = 0; i < num_params; i++) {
+    switch (args[i + 2].type) {
+      case T_NUMBER:
+      case T_REAL:
+      case T_STRING:
+      case T_BUFFER:
+        break;
+      default:
+        error("Bad argument %d to db_execute_prepared(): expected int, float, string or buffer\n",
+              i + 3);
+    }
+  }
+
+  DB_ASYNC_LOCK(db);  // serialize against the async DB worker thread
+
+  stmt = find_db_stmt(db, args[1].u.number);
+  if (!stmt) {
+    error("Attempt to execute an invalid prepared statement\n");
+  }
+
+  if (db->type->cleanup) {
+    db->type->cleanup(&(db->c));
+  }
+
+  if (db->type->execute_prepared) {
+    ret = db->type->execute_prepared(&(db->c), stmt, args + 2, num_params);
+  }
+
+  pop_n_elems(num_arg);
+  if (ret == -1) {
+    if (db->type->error) {
+      push_malloced_string(db->type->error(&(db->c)));
+    } else {
+      push_constant_string("Unknown error");
+    }
+  } else {
+    push_number(ret);
+  }
 }
 #endif
 
@@ -480,7 +561,7 @@ void f_db_fetch() {
     error("Attempt to fetch from an invalid database handle\n");
   }
 
-  DB_ASYNC_LOCK();  // serialize against the async DB worker thread
+  DB_ASYNC_LOCK(db);  // serialize against the async DB worker thread
 
   if (db->type->fetch) {
     ret = db->type->fetch(&(db->c), sp->u.number);
@@ -504,6 +585,134 @@ void f_db_fetch() {
 }
 #endif
 
+/* mixed db_fetch_rows(int handle, int count)
+ *
+ * Returns the next count rows of the last result set on the handle as an
+ * array of rows, each an array of columns as db_fetch() returns it. With no
+ * count (or one below 1) every remaining row is returned. Fetching carries
+ * on after the last row db_fetch() or db_fetch_rows() returned, so a large
+ * result can be walked in batches; an empty array means it is exhausted.
+ *
+ * Returns an error string on failure.
+ */
+#ifdef F_DB_FETCH_ROWS
+void f_db_fetch_rows() {
+  int count = 0;
+  db_t* db;
+  array_t* ret;
+
+  if (st_num_arg == 2) {
+    count = sp->u.number;
+    pop_stack();
+  }
+
+  valid_database("fetch", &the_null_array);
+
+  db = find_db_conn(sp->u.number);
+  if (!db) {
+    error("Attempt to fetch from an invalid database handle\n");
+  }
+
+  DB_ASYNC_LOCK(db);  // serialize against the async DB worker thread
+
+  if (db->type->fetch_rows) {
+    ret = db->type->fetch_rows(&(db->c), count);
+  } else {
+    ret = &the_null_array;
+  }
+
+  if (!ret) {
+    if (db->type->error) {
+      put_malloced_string(db->type->error(&(db->c)));
+    } else {
+      put_constant_string("Unknown error");
+    }
+  } else {
+    put_array(ret);
+  }
+}
+#endif
+
+/* int db_finalize(int handle, int statement)
+ *
+ * Releases a statement made by db_prepare(). db_close() releases all of a
+ * connection's statements.
+ *
+ * Returns 1 on success, 0 if there is no such statement
+ */
+#ifdef F_DB_FINALIZE
+void f_db_finalize() {
+  int ret = 0;
+  db_t* db;
+  void* stmt;
+
+  valid_database("finalize", &the_null_array);
+
+  db = find_db_conn((sp - 1)->u.number);
+  if (!db) {
+    error("Attempt to finalize on an invalid database handle\n");
+  }
+
+  DB_ASYNC_LOCK(db);  // serialize against the async DB worker thread
+
+  stmt = find_db_stmt(db, sp->u.number);
+  if (stmt) {
+    if (db->type->finalize) {
+      db->type->finalize(&(db->c), stmt);
+    }
+    db->stmts[sp->u.number - 1] = nullptr;
+    ret = 1;
+  }
+
+  pop_stack();
+  sp->u.number = ret;
+}
+#endif
+
+/* mixed db_prepare(int handle, string sql)
+ *
+ * Parses and plans the SQL statement once, for any number of runs through
+ * db_execute_prepared(). Placeholders use the backend's own syntax: "?"
+ * for MySQL and SQLite, "$1", "$2", ... for PostgreSQL.
+ *
+ * Returns a statement handle on success, an error string on failure
+ */
+#ifdef F_DB_PREPARE
+void f_db_prepare() {
+  db_t* db;
+  void* stmt = nullptr;
+  array_t* info;
+
+  info = allocate_empty_array(1);
+  info->item[0].type = T_STRING;
+  info->item[0].subtype = STRING_MALLOC;
+  info->item[0].u.string = string_copy(sp->u.string, "f_db_prepare");
+  valid_database("prepare", info);
+
+  db = find_db_conn((sp - 1)->u.number);
+  if (!db) {
+    error("Attempt to prepare on an invalid database handle\n");
+  }
+
+  DB_ASYNC_LOCK(db);  // serialize against the async DB worker thread
+
+  if (db->type->prepare) {
+    stmt = db->type->prepare(&(db->c), sp->u.string);
+  }
+
+  pop_stack();
+  if (stmt) {
+    sp->u.number = add_db_stmt(db, stmt);
+  } else if (!db->type->prepare) {
+    put_constant_string("Prepared statements are not supported by this database");
+  } else if (db->type->error) {
+    put_malloced_string(db->type->error(&(db->c)));
+  } else {
+    put_constant_string("Unknown error");
+  }
+}
+#endif
+
 /* int db_rollback(int handle)
  *
  * Rollsback all db_exec() calls back to the last db_commit() call for the
@@ -524,7 +733,7 @@ void f_db_rollback() {
     error("Attempt to rollback an invalid database handle\n");
   }
 
-  DB_ASYNC_LOCK();  // serialize against the async DB worker thread
+  DB_ASYNC_LOCK(db);  // serialize against the async DB worker thread
 
   if (db->type->rollback) {
     ret = db->type->rollback(&(db->c));
@@ -551,19 +760,22 @@ void f_db_status() {
 
   outbuf_zero(&out);
 
-  // Reads every live connection's db->c (via type->status) while the async
-  // worker may be mid-execute on one of them; serialize the whole walk.
-  DB_ASYNC_LOCK();
-
   for (i = 0; i < db_conn_alloc; i++) {
-    if (db_conn_list[i].flags & DB_FLAG_EMPTY) {
+    db_t* db = db_conn_list[i];
+    if (db->flags & DB_FLAG_EMPTY) {
       continue;
     }
 
-    outbuf_addv(&out, "Handle: %d (%s)\n", i + 1, db_conn_list[i].type->name);
-    if (db_conn_list[i].type->status != nullptr) {
-      db_conn_list[i].type->status(&(db_conn_list[i].c), &out);
+    // type->status reads db->c, which the handle's async worker may be
+    // mid-execute on.
+    DB_ASYNC_LOCK(db);
+    outbuf_addv(&out, "Handle: %d (%s)\n", i + 1, db->type->name);
+    if (db->type->status != nullptr) {
+      db->type->status(&(db->c), &out);
     }
+#ifdef F_ASYNC_DB_EXEC
+    async_db_status(db, &out);
+#endif
   }
 
   outbuf_push(&out);
@@ -574,16 +786,22 @@ void db_cleanup() {
   int i;
 
   for (i = 0; i < db_conn_alloc; i++) {
-    if (!(db_conn_list[i].flags & DB_FLAG_EMPTY)) {
-      if (db_conn_list[i].type->cleanup) {
-        db_conn_list[i].type->cleanup(&(db_conn_list[i].c));
+    db_t* db = db_conn_list[i];
+    if (!(db->flags & DB_FLAG_EMPTY)) {
+      DB_ASYNC_LOCK(db);
+#ifdef F_ASYNC_DB_EXEC
+      async_db_close(db);
+#endif
+      if (db->type->cleanup) {
+        db->type->cleanup(&(db->c));
       }
+      finalize_db_stmts(db);
 
-      if (db_conn_list[i].type->close) {
-        db_conn_list[i].type->close(&(db_conn_list[i].c));
+      if (db->type->close) {
+        db->type->close(&(db->c));
       }
 
-      db_conn_list[i].flags = DB_FLAG_EMPTY;
+      db->flags = DB_FLAG_EMPTY;
       db_conn_used--;
     }
   }
@@ -592,33 +810,28 @@ void db_cleanup() {
 int create_db_conn() {
   int i;
 
-#ifdef PACKAGE_ASYNC
-  if (!db_mut) {
-    db_mut = (pthread_mutex_t*)malloc(sizeof(pthread_mutex_t));
-    pthread_mutex_init(db_mut, nullptr);
-  }
-  pthread_mutex_lock(db_mut);
-  DEFER { pthread_mutex_unlock(db_mut); };
-#endif
-
   /* allocate more slots if we need them */
   if (db_conn_alloc == db_conn_used) {
     i = db_conn_alloc;
     db_conn_alloc += 10;
     if (!db_conn_list) {
-      db_conn_list = (db_t*)DCALLOC(db_conn_alloc, sizeof(db_t), TAG_DB, "create_db_conn");
+      db_conn_list = (db_t**)DCALLOC(db_conn_alloc, sizeof(db_t*), TAG_DB, "create_db_conn");
     } else {
-      db_conn_list = RESIZE(db_conn_list, db_conn_alloc, db_t, TAG_DB, "create_db_conn");
+      db_conn_list = RESIZE(db_conn_list, db_conn_alloc, db_t*, TAG_DB, "create_db_conn");
     }
     while (i < db_conn_alloc) {
-      db_conn_list[i++].flags = DB_FLAG_EMPTY;
+      db_conn_list[i] = new db_t();
+      db_conn_list[i++]->flags = DB_FLAG_EMPTY;
     }
   }
 
   for (i = 0; i < db_conn_alloc; i++) {
-    if (db_conn_list[i].flags & DB_FLAG_EMPTY) {
-      db_conn_list[i].flags = 0;
-      db_conn_list[i].type = &no_db;
+    db_t* db = db_conn_list[i];
+    if (db->flags & DB_FLAG_EMPTY) {
+      db->flags = 0;
+      db->type = &no_db;
+      db->stmts = nullptr;
+      db->num_stmts = 0;
       db_conn_used++;
       return i + 1;
     }
@@ -628,10 +841,10 @@ int create_db_conn() {
 }
 
 db_t* find_db_conn(int handle) {
-  if (handle < 1 || handle > db_conn_alloc || db_conn_list[handle - 1].flags & DB_FLAG_EMPTY) {
+  if (handle < 1 || handle > db_conn_alloc || db_conn_list[handle - 1]->flags & DB_FLAG_EMPTY) {
     return nullptr;
   }
-  return &(db_conn_list[handle - 1]);
+  return db_conn_list[handle - 1];
 }
 
 void free_db_conn(db_t* db) {
@@ -641,11 +854,66 @@ void free_db_conn(db_t* db) {
   db->flags |= DB_FLAG_EMPTY;
 }
 
+/* Statement handles are per connection, numbered from 1; a finalized one
+ * leaves a hole that the next db_prepare() reuses.
+ */
+static int add_db_stmt(db_t* db, void* stmt) {
+  int i;
+
+  for (i = 0; i < db->num_stmts; i++) {
+    if (!db->stmts[i]) {
+      db->stmts[i] = stmt;
+      return i + 1;
+    }
+  }
+
+  i = db->num_stmts;
+  db->num_stmts += 8;
+  if (!db->stmts) {
+    db->stmts = (void**)DCALLOC(db->num_stmts, sizeof(void*), TAG_DB, "add_db_stmt");
+  } else {
+    db->stmts = RESIZE(db->stmts, db->num_stmts, void*, TAG_DB, "add_db_stmt");
+    memset(db->stmts + i, 0, 8 * sizeof(void*));
+  }
+  db->stmts[i] = stmt;
+  return i + 1;
+}
+
+static void* find_db_stmt(db_t* db, int handle) {
+  if (handle < 1 || handle > db->num_stmts) {
+    return nullptr;
+  }
+  return db->stmts[handle - 1];
+}
+
+/* Must run before type->close(); SQLite refuses to close a connection that
+ * still has statements.
+ */
+void finalize_db_stmts(db_t* db) {
+  int i;
+
+  for (i = 0; i < db->num_stmts; i++) {
+    if (db->stmts[i] && db->type->finalize) {
+      db->type->finalize(&(db->c), db->stmts[i]);
+    }
+  }
+  if (db->stmts) {
+    FREE(db->stmts);
+    db->stmts = nullptr;
+  }
+  db->num_stmts = 0;
+}
+
 #ifdef DEBUGMALLOC_EXTENSIONS
 void mark_db_conn() {
   auto* node = db_conn_list;
   if (node) {
     DO_MARK(node, TAG_DB);
+    for (int i = 0; i < db_conn_alloc; i++) {
+      if (!(node[i]->flags & DB_FLAG_EMPTY) && node[i]->stmts) {
+        DO_MARK(node[i]->stmts, TAG_DB);
+      }
+    }
   }
 }
 #endif
@@ -660,6 +928,11 @@ static void MySQL_cleanup(dbconn_t* c) {
     mysql_free_result(c->mysql.results);
     c->mysql.results = nullptr;
   }
+  if (c->mysql.stmt) {
+    // Discards whatever rows of the stream were not fetched.
+    mysql_stmt_free_result(c->mysql.stmt);
+    c->mysql.stmt = nullptr;
+  }
 }
 
 static char* MySQL_errormsg(dbconn_t* c) {
@@ -694,6 +967,73 @@ static int MySQL_execute(dbconn_t* c, const char* s) {
   return -1;
 }
 
+/* Converts one column value, as the text protocol delivers it (a
+ * NUL-terminated string, or raw bytes for binary columns), to an svalue;
+ * a null data pointer is SQL NULL.
+ */
+static void MySQL_value(svalue_t* sv, MYSQL_FIELD* field, const char* data, unsigned long length) {
+  if (!data) {
+    *sv = const0u;
+    return;
+  }
+
+  switch (field->type) {
+    case FIELD_TYPE_TINY:
+    case FIELD_TYPE_SHORT:
+    case FIELD_TYPE_DECIMAL:
+    case FIELD_TYPE_NEWDECIMAL:
+    case FIELD_TYPE_LONG:
+    case FIELD_TYPE_INT24:
+    case FIELD_TYPE_LONGLONG:
+      sv->type = T_NUMBER;
+      sv->subtype = 0;
+      sv->u.number = strtoull(data, nullptr, 10);
+      break;
+
+    case FIELD_TYPE_FLOAT:
+    case FIELD_TYPE_DOUBLE:
+      sv->type = T_REAL;
+      sv->u.real = strtod(data, nullptr);
+      break;
+
+    case FIELD_TYPE_TINY_BLOB:
+    case FIELD_TYPE_MEDIUM_BLOB:
+    case FIELD_TYPE_LONG_BLOB:
+    case FIELD_TYPE_BLOB:
+    case FIELD_TYPE_STRING:
+    case FIELD_TYPE_VAR_STRING:
+      if (field->flags & BINARY_FLAG) {
+        // Use this row's actual field length, not the column-wide max.
+        sv->type = T_BUFFER;
+        sv->u.buf = allocate_buffer(length);
+        write_buffer(sv->u.buf, 0, data, length);
+      } else {
+        sv->type = T_STRING;
+        sv->subtype = STRING_MALLOC;
+        sv->u.string = string_copy(data, "MySQL_fetch");
+      }
+      break;
+
+    case FIELD_TYPE_TIMESTAMP:
+    case FIELD_TYPE_DATE:
+    case FIELD_TYPE_NEWDATE:
+    case FIELD_TYPE_DATETIME:
+    case FIELD_TYPE_TIME:
+    case FIELD_TYPE_YEAR:
+      /* Date/time columns come back in their string representation;
+       * they used to fall through to default and fetch as 0
+       * (issue #808). */
+      sv->type = T_STRING;
+      sv->subtype = STRING_MALLOC;
+      sv->u.string = string_copy(data, "MySQL_fetch");
+      break;
+
+    default:
+      *sv = const0u;
+      break;
+  }
+}
+
 static array_t* MySQL_fetch(dbconn_t* c, int row) {
   array_t* v;
   MYSQL_ROW target_row;
@@ -741,70 +1081,10 @@ static array_t* MySQL_fetch(dbconn_t* c, int row) {
       continue;
     }
 
-    if (!field || !target_row[i]) {
+    if (!field) {
       v->item[i] = const0u;
     } else {
-      switch (field->type) {
-        case FIELD_TYPE_TINY:
-        case FIELD_TYPE_SHORT:
-        case FIELD_TYPE_DECIMAL:
-        case FIELD_TYPE_NEWDECIMAL:
-        case FIELD_TYPE_LONG:
-        case FIELD_TYPE_INT24:
-        case FIELD_TYPE_LONGLONG:
-          v->item[i].type = T_NUMBER;
-          v->item[i].subtype = 0;
-          v->item[i].u.number = strtoull(target_row[i], nullptr, 10);
-          break;
-
-        case FIELD_TYPE_FLOAT:
-        case FIELD_TYPE_DOUBLE:
-          v->item[i].type = T_REAL;
-          v->item[i].u.real = strtod(target_row[i], nullptr);
-          break;
-
-        case FIELD_TYPE_TINY_BLOB:
-        case FIELD_TYPE_MEDIUM_BLOB:
-        case FIELD_TYPE_LONG_BLOB:
-        case FIELD_TYPE_BLOB:
-        case FIELD_TYPE_STRING:
-        case FIELD_TYPE_VAR_STRING:
-          if (field->flags & BINARY_FLAG) {
-            // Use this row's actual field length, not the column-wide max.
-            unsigned long const blen = target_lengths ? target_lengths[i] : 0;
-            v->item[i].type = T_BUFFER;
-            v->item[i].u.buf = allocate_buffer(blen);
-            write_buffer(v->item[i].u.buf, 0, target_row[i], blen);
-          } else {
-            v->item[i].type = T_STRING;
-            if (target_row[i]) {
-              v->item[i].subtype = STRING_MALLOC;
-              v->item[i].u.string = string_copy(target_row[i], "MySQL_fetch");
-            } else {
-              v->item[i].subtype = STRING_CONSTANT;
-              v->item[i].u.string = "";
-            }
-          }
-          break;
-
-        case FIELD_TYPE_TIMESTAMP:
-        case FIELD_TYPE_DATE:
-        case FIELD_TYPE_NEWDATE:
-        case FIELD_TYPE_DATETIME:
-        case FIELD_TYPE_TIME:
-        case FIELD_TYPE_YEAR:
-          /* Date/time columns come back in their string representation;
-           * they used to fall through to default and fetch as 0
-           * (issue #808). */
-          v->item[i].type = T_STRING;
-          v->item[i].subtype = STRING_MALLOC;
-          v->item[i].u.string = string_copy(target_row[i], "MySQL_fetch");
-          break;
-
-        default:
-          v->item[i] = const0u;
-          break;
-      }
+      MySQL_value(&v->item[i], field, target_row[i], target_lengths ? target_lengths[i] : 0);
     }
   }
 
@@ -845,8 +1125,223 @@ static int MySQL_connect(dbconn_t* c, const char* host, const char* database, co
   }
 
   c->mysql.results = nullptr;
+  c->mysql.stmt = nullptr;
   return 1;
 }
+
+static void MySQL_stmt_error(dbconn_t* c, MYSQL_STMT* stmt) {
+  strncpy(c->mysql.errormsg, mysql_stmt_error(stmt), sizeof(c->mysql.errormsg));
+  c->mysql.errormsg[sizeof(c->mysql.errormsg) - 1] = 0;
+}
+
+static void* MySQL_prepare(dbconn_t* c, const char* s) {
+  MYSQL_STMT* stmt = mysql_stmt_init(c->mysql.handle);
+
+  if (!stmt) {
+    strncpy(c->mysql.errormsg, mysql_error(c->mysql.handle), sizeof(c->mysql.errormsg));
+    c->mysql.errormsg[sizeof(c->mysql.errormsg) - 1] = 0;
+    return nullptr;
+  }
+  if (mysql_stmt_prepare(stmt, s, strlen(s))) {
+    MySQL_stmt_error(c, stmt);
+    mysql_stmt_close(stmt);
+    return nullptr;
+  }
+
+  return stmt;
+}
+
+static int MySQL_execute_prepared(dbconn_t* c, void* handle, svalue_t* args, int num_args) {
+  auto* stmt = static_cast<MYSQL_STMT*>(handle);
+  std::vector<MYSQL_BIND> bind(num_args);
+  std::vector<unsigned long> lengths(num_args);
+  MYSQL_RES* meta;
+  int i;
+
+  if (static_cast<unsigned long>(num_args) != mysql_stmt_param_count(stmt)) {
+    snprintf(c->mysql.errormsg, sizeof(c->mysql.errormsg),
+             "Statement takes %lu parameters, got %d", mysql_stmt_param_count(stmt), num_args);
+    return -1;
+  }
+
+  // Parameters go to the server with mysql_stmt_execute(), so the bindings
+  // can point straight into the efun arguments.
+  for (i = 0; i < num_args; i++) {
+    svalue_t* arg = &args[i];
+    switch (arg->type) {
+      case T_NUMBER:
+        if (arg->subtype == T_UNDEFINED) {
+          bind[i].buffer_type = MYSQL_TYPE_NULL;
+        } else {
+          bind[i].buffer_type = MYSQL_TYPE_LONGLONG;
+          bind[i].buffer = &arg->u.number;
+        }
+        break;
+      case T_REAL:
+        bind[i].buffer_type = MYSQL_TYPE_DOUBLE;
+        bind[i].buffer = &arg->u.real;
+        break;
+      case T_STRING:
+        lengths[i] = SVALUE_STRLEN(arg);
+        bind[i].buffer_type = MYSQL_TYPE_STRING;
+        bind[i].buffer = const_cast<char*>(arg->u.string);
+        bind[i].buffer_length = lengths[i];
+        bind[i].length = &lengths[i];
+        break;
+      case T_BUFFER:
+        lengths[i] = arg->u.buf->size;
+        bind[i].buffer_type = MYSQL_TYPE_BLOB;
+        bind[i].buffer = arg->u.buf->item;
+        bind[i].buffer_length = lengths[i];
+        bind[i].length = &lengths[i];
+        break;
+    }
+  }
+
+  if ((num_args && mysql_stmt_bind_param(stmt, bind.data())) || mysql_stmt_execute(stmt)) {
+    MySQL_stmt_error(c, stmt);
+    return -1;
+  }
+
+  meta = mysql_stmt_result_metadata(stmt);
+  if (!meta) {
+    return mysql_stmt_affected_rows(stmt);
+  }
+  mysql_free_result(meta);
+
+  /* No mysql_stmt_store_result(): the rows stay on the server side of the
+   * connection and db_fetch_rows() reads them off as it is asked for them.
+   */
+  c->mysql.stmt = stmt;
+  return 0;
+}
+
+/* Next row of a streamed prepared statement: nullptr at the end, with
+ * *failed set if that end is an error.
+ */
+static array_t* MySQL_stmt_row(dbconn_t* c, MYSQL_FIELD* fields, unsigned int num_fields,
+                               bool* failed) {
+  MYSQL_STMT* stmt = c->mysql.stmt;
+  std::vector<MYSQL_BIND> bind(num_fields);
+  std::vector<unsigned long> lengths(num_fields);
+  std::unique_ptr<std::remove_pointer_t<decltype(MYSQL_BIND::is_null)>[]> nulls(
+      new std::remove_pointer_t<decltype(MYSQL_BIND::is_null)>[num_fields]());
+  unsigned int i;
+  int rc;
+
+  // Bind empty buffers to learn each value's length, then pull the values
+  // column by column at their real size.
+  for (i = 0; i < num_fields; i++) {
+    bind[i].buffer_type = MYSQL_TYPE_STRING;
+    bind[i].length = &lengths[i];
+    bind[i].is_null = &nulls[i];
+  }
+  if (mysql_stmt_bind_result(stmt, bind.data())) {
+    *failed = true;
+    return nullptr;
+  }
+
+  rc = mysql_stmt_fetch(stmt);
+  if (rc == MYSQL_NO_DATA) {
+    return nullptr;
+  }
+  if (rc != 0 && rc != MYSQL_DATA_TRUNCATED) {
+    *failed = true;
+    return nullptr;
+  }
+
+  array_t* v = allocate_empty_array(num_fields);
+  for (i = 0; i < num_fields; i++) {
+    if (nulls[i]) {
+      v->item[i] = const0u;
+      continue;
+    }
+    std::string data(lengths[i], '\0');
+    MYSQL_BIND column{};
+    column.buffer_type = MYSQL_TYPE_STRING;
+    column.buffer = data.data();
+    column.buffer_length = lengths[i];
+    if (lengths[i] && mysql_stmt_fetch_column(stmt, &column, i, 0)) {
+      free_array(v);
+      *failed = true;
+      return nullptr;
+    }
+    MySQL_value(&v->item[i], &fields[i], data.c_str(), lengths[i]);
+  }
+  return v;
+}
+
+static array_t* MySQL_fetch_rows(dbconn_t* c, int count) {
+  std::vector<array_t*> rows;
+  MYSQL_RES* meta = nullptr;
+  MYSQL_FIELD* fields;
+  unsigned int num_fields;
+  bool failed = false;
+  array_t* v;
+
+  if (c->mysql.stmt) {
+    meta = mysql_stmt_result_metadata(c->mysql.stmt);
+    if (!meta) {
+      return &the_null_array;
+    }
+    fields = mysql_fetch_fields(meta);
+    num_fields = mysql_num_fields(meta);
+  } else if (c->mysql.results) {
+    fields = mysql_fetch_fields(c->mysql.results);
+    num_fields = mysql_num_fields(c->mysql.results);
+  } else {
+    return &the_null_array;
+  }
+
+  while (count < 1 || static_cast<int>(rows.size()) < count) {
+    if (c->mysql.stmt) {
+      v = MySQL_stmt_row(c, fields, num_fields, &failed);
+    } else {
+      // Carries on from wherever MySQL_fetch() last left the row cursor.
+      MYSQL_ROW row = mysql_fetch_row(c->mysql.results);
+      v = nullptr;
+      if (row) {
+        unsigned long* lengths = mysql_fetch_lengths(c->mysql.results);
+        v = allocate_empty_array(num_fields);
+        for (unsigned int i = 0; i < num_fields; i++) {
+          MySQL_value(&v->item[i], &fields[i], row[i], lengths[i]);
+        }
+      }
+    }
+    if (!v) {
+      break;
+    }
+    rows.push_back(v);
+  }
+
+  if (meta) {
+    mysql_free_result(meta);
+  }
+  if (failed) {
+    MySQL_stmt_error(c, c->mysql.stmt);
+    for (auto* row : rows) {
+      free_array(row);
+    }
+    return nullptr;
+  }
+
+  v = allocate_empty_array(rows.size());
+  for (size_t i = 0; i < rows.size(); i++) {
+    v->item[i].type = T_ARRAY;
+    v->item[i].u.arr = rows[i];
+  }
+  return v;
+}
+
+static void MySQL_finalize(dbconn_t* c, void* handle) {
+  auto* stmt = static_cast<MYSQL_STMT*>(handle);
+
+  if (c->mysql.stmt == stmt) {
+    mysql_stmt_free_result(stmt);
+    c->mysql.stmt = nullptr;
+  }
+  mysql_stmt_close(stmt);
+}
 #endif
 
 /*
@@ -979,6 +1474,7 @@ static int SQLite3_connect(dbconn_t* c, const char* host, const char* database,
   }
 
   c->SQLite3.results = 0;
+  c->SQLite3.prepared = 0;
   c->SQLite3.nrows = 0;
   c->SQLite3.last_row = 0;
   c->SQLite3.step_res = 0;
@@ -986,7 +1482,7 @@ static int SQLite3_connect(dbconn_t* c, const char* host, const char* database,
 }
 
 static int SQLite3_close(dbconn_t* c) {
-  if (c->SQLite3.results) {
+  if (c->SQLite3.results && !c->SQLite3.prepared) {
     sqlite3_finalize(c->SQLite3.results);
     c->SQLite3.results = 0;
   }
@@ -1000,9 +1496,15 @@ static int SQLite3_close(dbconn_t* c) {
 }
 
 static void SQLite3_cleanup(dbconn_t* c) {
+  *(c->SQLite3.errormsg) = 0;
   if (c->SQLite3.results) {
-    sqlite3_finalize(c->SQLite3.results);
+    if (c->SQLite3.prepared) {
+      sqlite3_reset(c->SQLite3.results);
+    } else {
+      sqlite3_finalize(c->SQLite3.results);
+    }
     c->SQLite3.results = 0;
+    c->SQLite3.prepared = 0;
     c->SQLite3.last_row = 0;
     c->SQLite3.step_res = 0;
   }
@@ -1050,8 +1552,48 @@ static int SQLite3_execute(dbconn_t* c, const char* s) {
   return -1;
 }
 
+/* The columns of the row the statement is on. */
+static array_t* SQLite3_row(sqlite3_stmt* stmt) {
+  int const cols = sqlite3_column_count(stmt);
+  array_t* v = allocate_empty_array(cols);
+  int length, i;
+
+  for (i = 0; i < cols; i++) {
+    switch (sqlite3_column_type(stmt, i)) {
+      case SQLITE_INTEGER:
+        v->item[i].type = T_NUMBER;
+        v->item[i].u.number = sqlite3_column_int64(stmt, i);
+        break;
+
+      case SQLITE_FLOAT:
+        v->item[i].type = T_REAL;
+        v->item[i].u.real = (double)sqlite3_column_double(stmt, i);
+        break;
+
+      case SQLITE3_TEXT:
+        v->item[i].type = T_STRING;
+        v->item[i].subtype = STRING_MALLOC;
+        v->item[i].u.string = string_copy((char*)sqlite3_column_text(stmt, i), "SQLite3_fetch");
+        break;
+
+      case SQLITE_BLOB:
+        length = sqlite3_column_bytes(stmt, i);
+        v->item[i].type = T_BUFFER;
+        v->item[i].u.buf = allocate_buffer(length);
+        write_buffer(v->item[i].u.buf, 0, (char*)sqlite3_column_blob(stmt, i), length);
+        break;
+
+      default:
+        v->item[i] = const0u;
+        break;
+    }
+  }
+
+  return v;
+}
+
 static array_t* SQLite3_fetch(dbconn_t* c, int row) {
-  int cols, last_row, length, i;
+  int cols, last_row, i;
   array_t* v;
 
   if (!c->SQLite3.results) {
@@ -1133,44 +1675,141 @@ static array_t* SQLite3_fetch(dbconn_t* c, int row) {
     }
   }
 
-  v = allocate_empty_array(cols);
-  for (i = 0; i < cols; i++) {
-    switch (sqlite3_column_type(c->SQLite3.results, i)) {
-      case SQLITE_INTEGER:
-        v->item[i].type = T_NUMBER;
-        v->item[i].u.number = sqlite3_column_int64(c->SQLite3.results, i);
-        break;
+  c->SQLite3.last_row = row;
+  return SQLite3_row(c->SQLite3.results);
+}
 
-      case SQLITE_FLOAT:
-        v->item[i].type = T_REAL;
-        v->item[i].u.real = (double)sqlite3_column_double(c->SQLite3.results, i);
-        break;
+static void SQLite3_set_error(dbconn_t* c) {
+  strncpy(c->SQLite3.errormsg, sqlite3_errmsg(c->SQLite3.handle), sizeof(c->SQLite3.errormsg));
+  c->SQLite3.errormsg[sizeof(c->SQLite3.errormsg) - 1] = 0;
+}
 
-      case SQLITE3_TEXT:
-        v->item[i].type = T_STRING;
-        v->item[i].subtype = STRING_MALLOC;
-        v->item[i].u.string =
-            string_copy((char*)sqlite3_column_text(c->SQLite3.results, i), "SQLite3_fetch");
-        break;
+static void* SQLite3_prepare(dbconn_t* c, const char* s) {
+  sqlite3_stmt* stmt = nullptr;
 
-      case SQLITE_BLOB:
-        length = sqlite3_column_bytes(c->SQLite3.results, i);
-        v->item[i].type = T_BUFFER;
-        v->item[i].u.buf = allocate_buffer(length);
-        write_buffer(v->item[i].u.buf, 0, (char*)sqlite3_column_blob(c->SQLite3.results, i),
-                     length);
-        break;
+  if (sqlite3_prepare_v2(c->SQLite3.handle, s, -1, &stmt, nullptr) != SQLITE_OK || !stmt) {
+    SQLite3_set_error(c);
+    if (!stmt) {
+      // Empty or all-comment SQL prepares "successfully" to no statement.
+      strcpy(c->SQLite3.errormsg, "No SQL statement to prepare");
+    }
+    sqlite3_finalize(stmt);
+    return nullptr;
+  }
 
-      default:
-        v->item[i] = const0u;
+  return stmt;
+}
+
+static int SQLite3_execute_prepared(dbconn_t* c, void* handle, svalue_t* args, int num_args) {
+  auto* stmt = static_cast<sqlite3_stmt*>(handle);
+  int i, rc = SQLITE_OK;
+
+  if (num_args != sqlite3_bind_parameter_count(stmt)) {
+    snprintf(c->SQLite3.errormsg, sizeof(c->SQLite3.errormsg),
+             "Statement takes %d parameters, got %d", sqlite3_bind_parameter_count(stmt),
+             num_args);
+    return -1;
+  }
+
+  // The query may outlive the arguments (its rows are stepped through by
+  // later efuns), so SQLite takes its own copies of strings and buffers.
+  sqlite3_clear_bindings(stmt);
+  for (i = 0; i < num_args && rc == SQLITE_OK; i++) {
+    svalue_t* arg = &args[i];
+    switch (arg->type) {
+      case T_NUMBER:
+        if (arg->subtype == T_UNDEFINED) {
+          rc = sqlite3_bind_null(stmt, i + 1);
+        } else {
+          rc = sqlite3_bind_int64(stmt, i + 1, arg->u.number);
+        }
+        break;
+      case T_REAL:
+        rc = sqlite3_bind_double(stmt, i + 1, arg->u.real);
+        break;
+      case T_STRING:
+        rc = sqlite3_bind_text(stmt, i + 1, arg->u.string, SVALUE_STRLEN(arg), SQLITE_TRANSIENT);
+        break;
+      case T_BUFFER:
+        rc = sqlite3_bind_blob(stmt, i + 1, arg->u.buf->item, arg->u.buf->size, SQLITE_TRANSIENT);
         break;
     }
   }
+  if (rc != SQLITE_OK) {
+    SQLite3_set_error(c);
+    return -1;
+  }
 
-  c->SQLite3.last_row = row;
+  /* A query is left unstepped: db_fetch_rows() pulls its rows as they are
+   * wanted instead of counting them up front the way SQLite3_execute() has
+   * to. Anything else runs to completion here.
+   */
+  if (sqlite3_column_count(stmt) > 0) {
+    c->SQLite3.results = stmt;
+    c->SQLite3.prepared = 1;
+    c->SQLite3.nrows = INT_MAX;  // unknown; db_fetch() steps until the end
+    c->SQLite3.last_row = 0;
+    c->SQLite3.step_res = 0;
+    return 0;
+  }
+
+  rc = sqlite3_step(stmt);
+  if (rc != SQLITE_DONE && rc != SQLITE_ROW) {
+    SQLite3_set_error(c);
+    sqlite3_reset(stmt);
+    return -1;
+  }
+  sqlite3_reset(stmt);
+  return sqlite3_changes(c->SQLite3.handle);
+}
+
+static array_t* SQLite3_fetch_rows(dbconn_t* c, int count) {
+  std::vector<array_t*> rows;
+  array_t* v;
+  int rc = SQLITE_ROW;
+
+  if (!c->SQLite3.results || sqlite3_column_count(c->SQLite3.results) < 1) {
+    return &the_null_array;
+  }
+
+  while (count < 1 || static_cast<int>(rows.size()) < count) {
+    if (c->SQLite3.step_res && c->SQLite3.step_res != SQLITE_ROW) {
+      break;  // already at the end
+    }
+    rc = c->SQLite3.step_res = sqlite3_step(c->SQLite3.results);
+    if (rc != SQLITE_ROW) {
+      break;
+    }
+    c->SQLite3.last_row++;
+    rows.push_back(SQLite3_row(c->SQLite3.results));
+  }
+
+  if (rc != SQLITE_ROW && rc != SQLITE_DONE) {
+    SQLite3_set_error(c);
+    for (auto* row : rows) {
+      free_array(row);
+    }
+    return nullptr;
+  }
+
+  v = allocate_empty_array(rows.size());
+  for (size_t i = 0; i < rows.size(); i++) {
+    v->item[i].type = T_ARRAY;
+    v->item[i].u.arr = rows[i];
+  }
   return v;
 }
 
+static void SQLite3_finalize(dbconn_t* c, void* handle) {
+  if (c->SQLite3.results == handle) {
+    c->SQLite3.results = 0;
+    c->SQLite3.prepared = 0;
+    c->SQLite3.last_row = 0;
+    c->SQLite3.step_res = 0;
+  }
+  sqlite3_finalize(static_cast<sqlite3_stmt*>(handle));
+}
+
 static char* SQLite3_errormsg(dbconn_t* c) {
   if (*(c->SQLite3.errormsg)) {
     return string_copy((char*)c->SQLite3.errormsg, "SQLite3_errormsg:1");
@@ -1183,7 +1822,29 @@ static char* SQLite3_errormsg(dbconn_t* c) {
  * Postgres support
  */
 #ifdef USE_POSTGRES
-static void Postgres_cleanup(dbconn_t* c) { c->postgres.res = 0; }
+/* Drops the rest of a streamed result; the connection takes no other
+ * command until every result of the current one has been read.
+ */
+static void Postgres_end_stream(dbconn_t* c) {
+  PGresult* res;
+
+  if (!c->postgres.streaming) {
+    return;
+  }
+  PQclear(c->postgres.row);
+  c->postgres.row = nullptr;
+  while ((res = PQgetResult(c->postgres.conn))) {
+    PQclear(res);
+  }
+  c->postgres.streaming = 0;
+}
+
+static void Postgres_cleanup(dbconn_t* c) {
+  Postgres_end_stream(c);
+  PQclear(c->postgres.res);
+  c->postgres.res = 0;
+  c->postgres.next_row = 0;
+}
 
 static char* Postgres_errormsg(dbconn_t* c) {
   return string_copy(PQerrorMessage(c->postgres.conn), "postgresql_errormsg");
@@ -1229,9 +1890,32 @@ static int Postgres_connect(dbconn_t* c, const char* host, const char* database,
   if ((PQstatus(c->postgres.conn) != CONNECTION_OK)) {
     return 0;
   }
+  c->postgres.res = nullptr;
+  c->postgres.next_row = 0;
+  c->postgres.streaming = 0;
+  c->postgres.row = nullptr;
+  c->postgres.statements = 0;
   return 1;
 }
 
+/* Every column comes back as its text representation. */
+static array_t* Postgres_row(PGresult* res, int row) {
+  int const num_fields = PQnfields(res);
+  array_t* v = allocate_empty_array(num_fields);
+  int i;
+
+  for (i = 0; i < num_fields; i++) {
+    if (PQgetisnull(res, row, i)) {
+      v->item[i] = const0u;
+    } else {
+      v->item[i].type = T_STRING;
+      v->item[i].subtype = STRING_MALLOC;
+      v->item[i].u.string = string_copy(PQgetvalue(res, row, i), "postgres_fetch");
+    }
+  }
+  return v;
+}
+
 static array_t* Postgres_fetch(dbconn_t* c, int row) {
   array_t* v;
   unsigned int i, num_fields;
@@ -1260,17 +1944,143 @@ static array_t* Postgres_fetch(dbconn_t* c, int row) {
   }
 
   if (row >= 0) {
-    v = allocate_empty_array(num_fields);
-    for (i = 0; i < num_fields; i++) {
-      if (PQgetisnull(c->postgres.res, row, i)) {
-        v->item[i] = const0u;
-      } else {
-        v->item[i].type = T_STRING;
-        v->item[i].subtype = STRING_MALLOC;
-        v->item[i].u.string = string_copy(PQgetvalue(c->postgres.res, row, i), "postgres_fetch");
+    v = Postgres_row(c->postgres.res, row);
+    c->postgres.next_row = row + 1;
+  }
+  return v;
+}
+
+static void* Postgres_prepare(dbconn_t* c, const char* s) {
+  char name[32];
+  PGresult* res;
+  bool ok;
+
+  Postgres_end_stream(c);
+  snprintf(name, sizeof(name), "fluffos_stmt_%u", ++c->postgres.statements);
+  res = PQprepare(c->postgres.conn, name, s, 0, nullptr);
+  ok = PQresultStatus(res) == PGRES_COMMAND_OK;
+  PQclear(res);
+  if (!ok) {
+    return nullptr;
+  }
+
+  return strdup(name);
+}
+
+static int Postgres_execute_prepared(dbconn_t* c, void* handle, svalue_t* args, int num_args) {
+  std::vector<std::string> text(num_args);
+  std::vector<const char*> values(num_args);
+  std::vector<int> lengths(num_args), formats(num_args);
+  PGresult* res;
+  int i, ret = -1;
+
+  // Numbers go over as text; buffers as binary so they need no escaping.
+  for (i = 0; i < num_args; i++) {
+    svalue_t* arg = &args[i];
+    switch (arg->type) {
+      case T_NUMBER:
+        if (arg->subtype != T_UNDEFINED) {
+          text[i] = std::to_string(arg->u.number);
+          values[i] = text[i].c_str();
+        }
+        break;
+      case T_REAL: {
+        char buf[32];
+        snprintf(buf, sizeof(buf), "%.17g", arg->u.real);
+        text[i] = buf;
+        values[i] = text[i].c_str();
+        break;
+      }
+      case T_STRING:
+        values[i] = arg->u.string;
+        break;
+      case T_BUFFER:
+        values[i] = reinterpret_cast<const char*>(arg->u.buf->item);
+        lengths[i] = arg->u.buf->size;
+        formats[i] = 1;
+        break;
+    }
+  }
+
+  if (!PQsendQueryPrepared(c->postgres.conn, static_cast<const char*>(handle), num_args,
+                           values.data(), lengths.data(), formats.data(), 0)) {
+    return -1;
+  }
+  /* Single-row mode hands the rows over one PGresult at a time as they
+   * come in, rather than collecting the whole result first; the first one
+   * tells a query from a command.
+   */
+  PQsetSingleRowMode(c->postgres.conn);
+  c->postgres.streaming = 1;
+  res = PQgetResult(c->postgres.conn);
+  switch (PQresultStatus(res)) {
+    case PGRES_SINGLE_TUPLE:
+      c->postgres.row = res;
+      return 0;
+    case PGRES_TUPLES_OK:  // a query without rows
+      c->postgres.res = res;
+      res = nullptr;
+      ret = 0;
+      break;
+    case PGRES_COMMAND_OK:
+      ret = atoi(PQcmdTuples(res));
+      break;
+    default:
+      break;
+  }
+  PQclear(res);
+  Postgres_end_stream(c);
+  return ret;
+}
+
+static array_t* Postgres_fetch_rows(dbconn_t* c, int count) {
+  std::vector<array_t*> rows;
+  bool failed = false;
+  array_t* v;
+
+  while (count < 1 || static_cast<int>(rows.size()) < count) {
+    if (c->postgres.streaming) {
+      PGresult* res = c->postgres.row ? c->postgres.row : PQgetResult(c->postgres.conn);
+      c->postgres.row = nullptr;
+      if (PQresultStatus(res) == PGRES_SINGLE_TUPLE) {
+        rows.push_back(Postgres_row(res, 0));
+        PQclear(res);
+        continue;
       }
+      // The zero-row PGRES_TUPLES_OK that ends the stream, or an error.
+      failed = res && PQresultStatus(res) != PGRES_TUPLES_OK;
+      PQclear(res);
+      Postgres_end_stream(c);
+      break;
+    }
+    if (!c->postgres.res || c->postgres.next_row >= PQntuples(c->postgres.res)) {
+      break;
     }
+    rows.push_back(Postgres_row(c->postgres.res, c->postgres.next_row++));
+  }
+
+  if (failed) {
+    for (auto* row : rows) {
+      free_array(row);
+    }
+    return nullptr;
+  }
+
+  v = allocate_empty_array(rows.size());
+  for (size_t i = 0; i < rows.size(); i++) {
+    v->item[i].type = T_ARRAY;
+    v->item[i].u.arr = rows[i];
   }
   return v;
 }
+
+static void Postgres_finalize(dbconn_t* c, void* handle) {
+  auto* name = static_cast<char*>(handle);
+  std::string sql = "DEALLOCATE ";
+
+  Postgres_end_stream(c);
+  sql += name;
+  PQclear(PQexec(c->postgres.conn, sql.c_str()));
+  free(name);
+}
 #endif
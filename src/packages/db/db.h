@@ -15,11 +15,21 @@
 #include <sqlite3.h>
 #endif
 
+#ifdef PACKAGE_ASYNC
+#include <mutex>
+
+struct DbWorker;
+#endif
+
 union dbconn_t {
 #ifdef USE_POSTGRES
   struct tmp_postgres {
     PGconn* conn;
     PGresult* res;
+    int next_row;     // db_fetch_rows() cursor into res
+    int streaming;    // a prepared query is delivering rows one at a time
+    PGresult* row;    // first row of that stream, not yet fetched
+    unsigned int statements;  // names prepared statements
   } postgres;
 #endif
 #ifdef USE_MYSQL
@@ -27,6 +37,7 @@ union dbconn_t {
     char errormsg[256];
     MYSQL* handle;
     MYSQL_RES* results;
+    MYSQL_STMT* stmt;  // prepared statement whose rows are being streamed
   } mysql;
 #endif
 #ifdef USE_SQLITE3
@@ -37,6 +48,7 @@ union dbconn_t {
     int ncolumns;
     int last_row;
     int step_res;
+    int prepared;  // results belongs to the statement table, reset it
     char errormsg[256];
   } SQLite3;
 #endif
@@ -56,6 +68,11 @@ struct db_defn_t {
   void (*cleanup)(dbconn_t*);
   void (*status)(dbconn_t*, outbuffer_t*);
   char* (*error)(dbconn_t*);
+  /* Prepared statements; the void* is the backend's statement handle. */
+  void* (*prepare)(dbconn_t*, const char*);
+  int (*execute_prepared)(dbconn_t*, void*, svalue_t*, int);
+  array_t* (*fetch_rows)(dbconn_t*, int);
+  void (*finalize)(dbconn_t*, void*);
 };
 
 #define DB_FLAG_EMPTY 0x1
@@ -64,6 +81,16 @@ struct db_t {
   int flags;
   db_defn_t* type;
   union dbconn_t c;
+  void** stmts; /* statement handle N is stmts[N - 1] */
+  int num_stmts;
+#ifdef PACKAGE_ASYNC
+  /* Held by whoever is using c: an efun on the main thread, or the
+   * handle's async_db_exec() worker (see async.cc). One per handle, so
+   * different handles run their queries concurrently.
+   */
+  std::mutex lock;
+  DbWorker* worker;
+#endif
 };
 
 void db_cleanup(void);
@@ -2,6 +2,10 @@ int db_close(int);
 int db_commit(int);
 int db_connect(string, string, string | void, int | void);
 mixed db_exec(int, string);
+mixed db_execute_prepared(int, int, ...);
 mixed *db_fetch(int, int);
+mixed db_fetch_rows(int, int | void);
+int db_finalize(int, int);
+mixed db_prepare(int, string);
 int db_rollback(int);
 string db_status(void);
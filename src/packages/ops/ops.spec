@@ -80,3 +80,11 @@ operator parse_command;
 operator new_class, new_empty_class;
 operator expand_varargs;
 operator type_check;
+
+/* Superinstructions: icode.cc emits each in place of the sequence in its
+ * name when the operands are plain locals, globals or numbers. */
+operator local_local_add, local_index, global_index, local_number_branch;
+
+/* call_other() with a constant function name, carrying the index of its
+ * inline cache; see apply_site_lookup(). */
+operator call_other_site;
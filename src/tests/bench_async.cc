@@ -0,0 +1,132 @@
+#include "base/std.h"
+
+#include <event2/event.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "mainlib.h"
+#include "backend.h"
+#include "vm/vm.h"
+
+// ---------------------------------------------------------------------------
+// bench_async -- async_read() throughput and tail latency, worker threads vs
+// io_uring (the 'async io_uring' setting).
+//
+// Each round issues a burst of reads of distinct small files from a single
+// LPC call, then runs the event loop until every callback is in. The LPC
+// side stamps perf_counter_ns() when it issues a read and again in its
+// callback, so latency covers the whole trip: queueing, the I/O, the
+// wakeup and the callback dispatch.
+//
+// Bursts larger than the io_uring ring (256 requests in flight) spill onto
+// the worker threads, so keep `files` at or below that to compare the
+// engines alone.
+//
+// Boots the driver against the LPC testsuite config, like the unit tests.
+// Not part of ctest (timing-based); run manually, ideally RelWithDebInfo:
+//   ./src/tests/bench_async [files] [rounds] [file-bytes]
+// ---------------------------------------------------------------------------
+
+namespace {
+
+const char* kSource = R"(
+int pending;
+int *latencies;
+
+void done(int issued, mixed res) {
+    latencies += ({ perf_counter_ns() - issued });
+    pending--;
+}
+
+void burst(int files) {
+    latencies = ({});
+    for (int i = 0; i < files; i++) {
+        pending++;
+        async_read(sprintf("/bench_async/%d.txt", i), (: done, perf_counter_ns() :));
+    }
+}
+
+int query_pending() { return pending; }
+int *query_latencies() { return latencies; }
+)";
+
+using Clock = std::chrono::steady_clock;
+
+// Runs one burst to completion; appends its latencies (ns) to `out`.
+void run_burst(object_t* ob, int files, std::vector<double>* out) {
+  push_number(files);
+  apply("burst", ob, 1, ORIGIN_DRIVER);
+  while (apply("query_pending", ob, 0, ORIGIN_DRIVER)->u.number > 0) {
+    event_base_loop(g_event_base, EVLOOP_ONCE);
+  }
+  svalue_t* ret = apply("query_latencies", ob, 0, ORIGIN_DRIVER);
+  for (int i = 0; i < ret->u.arr->size; i++) {
+    out->push_back(static_cast<double>(ret->u.arr->item[i].u.number));
+  }
+}
+
+double percentile(const std::vector<double>& sorted, double p) {
+  return sorted[std::min(sorted.size() - 1, static_cast<size_t>(sorted.size() * p))];
+}
+
+}  // namespace
+
+int main(int argc, char** argv) try {
+  int files = (argc > 1) ? atoi(argv[1]) : 200;
+  int rounds = (argc > 2) ? atoi(argv[2]) : 50;
+  int file_bytes = (argc > 3) ? atoi(argv[3]) : 16 * 1024;
+
+  chdir(TESTSUITE_DIR);
+  init_main("etc/config.test");
+  vm_start();
+  current_object = master_ob;
+
+  mkdir("bench_async", 0755);
+  std::string const contents(file_bytes, 'x');
+  for (int i = 0; i < files; i++) {
+    auto path = "bench_async/" + std::to_string(i) + ".txt";
+    FILE* f = fopen(path.c_str(), "w");
+    fwrite(contents.data(), 1, contents.size(), f);
+    fclose(f);
+  }
+
+  object_t* ob = load_object_from_source(kSource, "bench_async_reader", 0);
+
+  printf("\nasync_read, %d rounds of %d reads of %d-byte files\n", rounds, files, file_bytes);
+  printf("  %-16s %12s %10s %10s %10s %10s\n", "engine", "reads/sec", "p50 us", "p99 us",
+         "p99.9 us", "max us");
+  for (int io_uring : {0, 1}) {
+    CONFIG_INT(__RC_ASYNC_IO_URING__) = io_uring;
+    std::vector<double> warmup;
+    run_burst(ob, files, &warmup);  // starts the workers / sets up the ring
+
+    std::vector<double> ns;
+    ns.reserve(static_cast<size_t>(files) * rounds);
+    auto t0 = Clock::now();
+    for (int r = 0; r < rounds; r++) {
+      run_burst(ob, files, &ns);
+    }
+    double secs = std::chrono::duration<double>(Clock::now() - t0).count();
+
+    std::sort(ns.begin(), ns.end());
+    printf("  %-16s %12.0f %10.1f %10.1f %10.1f %10.1f\n",
+           io_uring ? "io_uring" : "worker threads", ns.size() / secs,
+           percentile(ns, 0.5) / 1e3, percentile(ns, 0.99) / 1e3, percentile(ns, 0.999) / 1e3,
+           ns.back() / 1e3);
+  }
+
+  for (int i = 0; i < files; i++) {
+    unlink(("bench_async/" + std::to_string(i) + ".txt").c_str());
+  }
+  rmdir("bench_async");
+  return 0;
+} catch (const std::exception& e) {
+  fprintf(stderr, "bench_async: fatal: %s\n", e.what());
+  return 1;
+}
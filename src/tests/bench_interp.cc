@@ -0,0 +1,153 @@
+#include "base/std.h"
+
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+#include "mainlib.h"
+#include "vm/vm.h"
+
+// ---------------------------------------------------------------------------
+// bench_interp -- interpreter-bound LPC workloads, for measuring changes to
+// eval_instruction()'s dispatch (ENABLE_THREADED_DISPATCH) and to the
+// opcodes themselves.
+//
+// Each workload is one LPC function that spends its time in the opcode
+// loop rather than in efuns: counting loops, arithmetic, function calls,
+// indexing. Every workload runs `rounds` times; the best round is reported,
+// which is the least disturbed by the rest of the machine.
+//
+// Boots the driver against the LPC testsuite config, like the unit tests.
+// Not part of ctest (timing-based); run manually, ideally RelWithDebInfo,
+// once per build configuration to compare:
+//   ./src/tests/bench_interp [rounds] [scale]
+// ---------------------------------------------------------------------------
+
+namespace {
+
+const char* kSource = R"(
+int loop(int n) {
+    int sum;
+    for (int i = 0; i < n; i++) sum += i;
+    return sum;
+}
+
+int while_loop(int n) {
+    int a, b = 1;
+    while (n--) {
+        a = a ^ b;
+        b = (b << 1) | (a & 1);
+        if (b > 1000000) b = 1;
+    }
+    return a;
+}
+
+float arith(int n) {
+    float x = 1.0;
+    for (int i = 1; i < n; i++) {
+        x = x * 1.000001 + i % 7 - (i & 3) / 2.0;
+    }
+    return x;
+}
+
+int fib(int n) { return n < 2 ? n : fib(n - 1) + fib(n - 2); }
+
+int calls(int n) { return fib(n); }
+
+int arrays(int n) {
+    int *a = allocate(1000);
+    int sum;
+    for (int i = 0; i < n; i++) {
+        a[i % 1000] = i;
+        sum += a[(i * 7) % 1000];
+    }
+    return sum;
+}
+
+int mappings(int n) {
+    mapping m = ([ ]);
+    int sum;
+    for (int i = 0; i < 1000; i++) m[i] = i;
+    for (int i = 0; i < n; i++) sum += m[i % 1000];
+    return sum;
+}
+
+int strings(int n) {
+    string *words = ({ "alpha", "beta", "gamma", "delta", "epsilon" });
+    int hits;
+    for (int i = 0; i < n; i++) {
+        string w = words[i % 5];
+        if (w == "gamma" || w[0] == 'd') hits++;
+    }
+    return hits;
+}
+
+int foreach_sum(int n) {
+    int *a = allocate(1000);
+    int sum;
+    for (int i = 0; i < 1000; i++) a[i] = i;
+    for (int r = 0; r < n / 1000; r++) {
+        foreach (int v in a) sum += v;
+    }
+    return sum;
+}
+)";
+
+struct Workload {
+  const char* fun;
+  int arg;  // at scale 1
+};
+
+const Workload kWorkloads[] = {
+    {"loop", 5000000},   {"while_loop", 3000000}, {"arith", 2000000},
+    {"calls", 25},       {"arrays", 2000000},     {"mappings", 1000000},
+    {"strings", 2000000}, {"foreach_sum", 5000000},
+};
+
+using Clock = std::chrono::steady_clock;
+
+}  // namespace
+
+int main(int argc, char** argv) try {
+  int rounds = (argc > 1) ? atoi(argv[1]) : 5;
+  int scale = (argc > 2) ? atoi(argv[2]) : 1;
+
+  chdir(TESTSUITE_DIR);
+  init_main("etc/config.test");
+  vm_start();
+  current_object = master_ob;
+
+  object_t* ob = load_object_from_source(kSource, "bench_interp", 0);
+  // No eval cost limit: the workloads are meant to run long.
+  set_eval(0);
+
+#ifdef ENABLE_THREADED_DISPATCH
+  const char* dispatch = "threaded";
+#else
+  const char* dispatch = "switch";
+#endif
+  printf("\neval_instruction (%s dispatch), best of %d rounds\n", dispatch, rounds);
+  printf("  %-14s %12s\n", "workload", "ms");
+  double total = 0;
+  for (const auto& w : kWorkloads) {
+    int const arg = strcmp(w.fun, "calls") == 0 ? w.arg + scale - 1 : w.arg * scale;
+    double best = 1e300;
+    for (int r = 0; r < rounds; r++) {
+      auto t0 = Clock::now();
+      push_number(arg);
+      apply(w.fun, ob, 1, ORIGIN_DRIVER);
+      best = std::min(best, std::chrono::duration<double, std::milli>(Clock::now() - t0).count());
+    }
+    total += best;
+    printf("  %-14s %12.1f\n", w.fun, best);
+  }
+  printf("  %-14s %12.1f\n", "total", total);
+  return 0;
+} catch (const std::exception& e) {
+  fprintf(stderr, "bench_interp: fatal: %s\n", e.what());
+  return 1;
+}
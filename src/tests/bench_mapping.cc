@@ -0,0 +1,188 @@
+#include "base/std.h"
+
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+
+#include "mainlib.h"
+#include "vm/vm.h"
+
+// ---------------------------------------------------------------------------
+// bench_mapping -- memory and throughput of LPC mappings.
+//
+// Memory: builds many mappings of k string keys each and reports what they
+// cost per mapping and per entry, from the driver's own accounting
+// (total_mapping_size: mapping structs, tables and nodes).
+//
+// Throughput: LPC workloads that spend their time in mapping lookups,
+// inserts, deletes, iteration and save/restore. Every workload runs
+// `rounds` times; the best round is reported.
+//
+// Boots the driver against the LPC testsuite config, like the unit tests.
+// Not part of ctest (timing-based); run manually, ideally RelWithDebInfo:
+//   ./src/tests/bench_mapping [rounds] [scale]
+// ---------------------------------------------------------------------------
+
+namespace {
+
+const char* kSource = R"(
+string *names;
+mixed *keep;
+
+void build(int n, int k) {
+    if (!names) {
+        names = ({ });
+        for (int i = 0; i < 64; i++) names += ({ "key" + i });
+    }
+    keep = allocate(n);
+    for (int i = 0; i < n; i++) {
+        mapping m = ([ ]);
+        for (int j = 0; j < k; j++) m[names[j]] = i;
+        keep[i] = m;
+    }
+}
+
+void drop() { keep = 0; }
+
+int small_build(int n) {
+    int sum;
+    for (int i = 0; i < n; i++) {
+        mapping m = ([ "name": i, "short": 1, "long": 2, "id": 3 ]);
+        m["weight"] = i;
+        sum += sizeof(m);
+    }
+    return sum;
+}
+
+int small_lookup(int n) {
+    mapping m = ([ "name": 1, "short": 2, "long": 3, "id": 4, "weight": 5 ]);
+    string *keys = ({ "name", "short", "long", "id", "weight", "value" });
+    int sum;
+    for (int i = 0; i < n; i++) sum += m[keys[i % 6]];
+    return sum;
+}
+
+int int_lookup(int n) {
+    mapping m = ([ ]);
+    int sum;
+    for (int i = 0; i < 10000; i++) m[i * 16] = i;
+    for (int i = 0; i < n; i++) sum += m[(i % 10000) * 16];
+    return sum;
+}
+
+int string_lookup(int n) {
+    mapping m = ([ ]);
+    string *keys = allocate(5000);
+    int sum;
+    for (int i = 0; i < 5000; i++) m[keys[i] = "room/" + i] = i;
+    for (int i = 0; i < n; i++) sum += m[keys[(i * 7) % 5000]];
+    return sum;
+}
+
+int array_keys(int n) {
+    mapping m = ([ ]);
+    mixed *keys = allocate(5000);
+    int sum;
+    for (int i = 0; i < 5000; i++) m[keys[i] = ({ i })] = i;
+    for (int i = 0; i < n; i++) sum += m[keys[(i * 7) % 5000]];
+    return sum;
+}
+
+int churn(int n) {
+    mapping m = ([ ]);
+    for (int i = 0; i < n; i++) {
+        m[i % 512] = i;
+        map_delete(m, (i * 7) % 512);
+    }
+    return sizeof(m);
+}
+
+int iterate(int n) {
+    mapping m = ([ ]);
+    int sum;
+    for (int i = 0; i < 1000; i++) m["key" + i] = i;
+    for (int r = 0; r < n / 1000; r++) {
+        foreach (string k, int v in m) sum += v;
+    }
+    return sum;
+}
+
+int save_restore(int n) {
+    mapping m = ([ ]);
+    int sum;
+    for (int i = 0; i < 50; i++) m["key" + i] = ([ "x": i, "y": i * 2, "name": "n" + i ]);
+    for (int i = 0; i < n; i++) sum += sizeof(restore_variable(save_variable(m)));
+    return sum;
+}
+)";
+
+struct Workload {
+  const char* fun;
+  int arg;  // at scale 1
+};
+
+const Workload kWorkloads[] = {
+    {"small_build", 500000}, {"small_lookup", 3000000}, {"int_lookup", 3000000},
+    {"string_lookup", 3000000}, {"array_keys", 3000000}, {"churn", 2000000},
+    {"iterate", 5000000},     {"save_restore", 2000},
+};
+
+const int kSizes[] = {1, 2, 4, 8, 9, 16, 64};
+
+using Clock = std::chrono::steady_clock;
+
+}  // namespace
+
+int main(int argc, char** argv) try {
+  int rounds = (argc > 1) ? atoi(argv[1]) : 5;
+  int scale = (argc > 2) ? atoi(argv[2]) : 1;
+
+  chdir(TESTSUITE_DIR);
+  init_main("etc/config.test");
+  vm_start();
+  current_object = master_ob;
+
+  object_t* ob = load_object_from_source(kSource, "bench_mapping", 0);
+  // No eval cost limit: the workloads are meant to run long.
+  set_eval(0);
+
+  const int n = 20000 * scale;
+  printf("\nmapping memory, %d mappings of k string keys (driver accounting)\n", n);
+  printf("  %4s %14s %14s %12s\n", "k", "bytes/mapping", "bytes/entry", "build ms");
+  for (int k : kSizes) {
+    uint64_t const before = total_mapping_size;
+    auto t0 = Clock::now();
+    push_number(n);
+    push_number(k);
+    apply("build", ob, 2, ORIGIN_DRIVER);
+    double const ms = std::chrono::duration<double, std::milli>(Clock::now() - t0).count();
+    // the `keep` array itself is not mapping memory
+    double const per_map = static_cast<double>(total_mapping_size - before) / n;
+    printf("  %4d %14.1f %14.1f %12.1f\n", k, per_map, per_map / k, ms);
+    apply("drop", ob, 0, ORIGIN_DRIVER);
+  }
+
+  printf("\nmapping workloads, best of %d rounds\n", rounds);
+  printf("  %-14s %12s\n", "workload", "ms");
+  double total = 0;
+  for (const auto& w : kWorkloads) {
+    int const arg = w.arg * scale;
+    double best = 1e300;
+    for (int r = 0; r < rounds; r++) {
+      auto t0 = Clock::now();
+      push_number(arg);
+      apply(w.fun, ob, 1, ORIGIN_DRIVER);
+      best = std::min(best, std::chrono::duration<double, std::milli>(Clock::now() - t0).count());
+    }
+    total += best;
+    printf("  %-14s %12.1f\n", w.fun, best);
+  }
+  printf("  %-14s %12.1f\n", "total", total);
+  return 0;
+} catch (const std::exception& e) {
+  fprintf(stderr, "bench_mapping: fatal: %s\n", e.what());
+  return 1;
+}
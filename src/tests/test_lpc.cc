@@ -5,7 +5,13 @@
 
 #include "comm.h"
 #include "user.h"
+#include "packages/core/heartbeat.h"
 #include "compiler/internal/compiler.h"
+#include "vm/internal/program_cache.h"
+
+#include <dirent.h>
+#include <event2/event.h>
+#include <unistd.h>
 
 namespace {
 // Runs `fn` (arbitrary LPC-triggering driver code -- load_object_from_source,
@@ -354,6 +360,398 @@ TEST_F(DriverTest, SweepDoesNotRevisitSurvivorsOfPreviousSweep) {
   RunGuarded([&] { free_object(&a, "SweepDoesNotRevisitSurvivorsOfPreviousSweep"); });
 }
 
+// Objects are filed for the reset/clean_up sweep under their next deadline,
+// refiled when it moves, and dropped on destruct.
+TEST_F(DriverTest, SweepIndexFollowsResetAndCleanUpDeadlines) {
+  object_t* ob = nullptr;
+  RunGuarded([&] {
+    ob = load_object_from_source("void reset() {}\nint clean_up(int inherited) { return 1; }\n",
+                                 "sweep_index_ob", 0);
+  });
+  ASSERT_NE(ob, nullptr);
+  ASSERT_TRUE(ob->flags & O_WILL_RESET);
+  ASSERT_TRUE(ob->flags & O_WILL_CLEAN_UP);
+  uint64_t const clean_up_due =
+      ob->time_of_ref +
+      time_to_next_gametick(std::chrono::seconds(CONFIG_INT(__TIME_TO_CLEAN_UP__)));
+  // A deadline already in the past is filed as 1, i.e. "due now".
+  EXPECT_EQ(ob->sweep_due, std::max<uint64_t>(std::min<uint64_t>(ob->next_reset, clean_up_due), 1));
+
+  ob->next_reset = g_current_gametick + 5;
+  sweep_schedule_object(ob);
+  EXPECT_EQ(ob->sweep_due, g_current_gametick + 5);
+
+  RunGuarded([&] {
+    destruct_object(ob);
+    EXPECT_EQ(ob->sweep_due, 0);
+    free_object(&ob, "SweepIndexFollowsResetAndCleanUpDeadlines");
+  });
+}
+
+// The shared-string table grows while strings are being added, finding
+// every string throughout, and forgets the ones whose last ref is freed.
+TEST_F(DriverTest, SharedStringTableGrowsIncrementally) {
+  auto name = [](int i) { return "stralloc_grow_" + std::to_string(i); };
+  int const count = 4 * CONFIG_INT(__SHARED_STRING_HASH_TABLE_SIZE__);
+  std::vector<const char*> strs;
+  for (int i = 0; i < count; i++) {
+    strs.push_back(make_shared_string(name(i).c_str()));
+    if (i % 997 == 0) {
+      for (int j = 0; j <= i; j += 101) {
+        ASSERT_EQ(findstring(name(j).c_str()), strs[j]) << "after " << i;
+      }
+    }
+  }
+  for (int i = 0; i < count; i += 2) {
+    free_string(strs[i]);
+  }
+  for (int i = 0; i < count; i++) {
+    if (i % 2) {
+      EXPECT_EQ(findstring(name(i).c_str()), strs[i]);
+      EXPECT_EQ(make_shared_string(name(i).c_str()), strs[i]);
+      free_string(strs[i]);
+    } else {
+      EXPECT_EQ(findstring(name(i).c_str()), nullptr);
+    }
+  }
+
+  outbuffer_t out;
+  outbuf_zero(&out);
+  add_string_status(&out, 1);
+  outbuf_fix(&out);
+  EXPECT_NE(std::string(out.buffer).find("Groups probed:"), std::string::npos) << out.buffer;
+  FREE_MSTR(out.buffer);
+
+  for (int i = 1; i < count; i += 2) {
+    free_string(strs[i]);
+  }
+}
+
+// Apply tables are built as programs load. A program that only inherits
+// another reuses its table; otherwise inherited entries are rebased onto
+// the inheriting program's function and variable offsets.
+TEST_F(DriverTest, ApplyTablesAreBuiltAtLoadAndShared) {
+  object_t* base = nullptr;
+  object_t* other = nullptr;
+  object_t* same = nullptr;
+  object_t* derived = nullptr;
+  RunGuarded([&] {
+    base = load_object_from_source("int x;\nint f() { return 1; }\nint g() { return 2; }\n",
+                                   "apply_table_base", 0);
+    other = load_object_from_source("int y, z;\nint h() { return 4; }\n", "apply_table_other", 0);
+    same = load_object_from_source("inherit \"/apply_table_base\";\n", "apply_table_same", 0);
+    derived = load_object_from_source(
+        "inherit \"/apply_table_other\";\ninherit \"/apply_table_base\";\n"
+        "int g() { return 3; }\n",
+        "apply_table_derived", 0);
+  });
+  ASSERT_NE(base, nullptr);
+  ASSERT_NE(other, nullptr);
+  ASSERT_NE(same, nullptr);
+  ASSERT_NE(derived, nullptr);
+
+  ASSERT_NE(base->prog->apply_table, nullptr);
+  EXPECT_EQ(same->prog->apply_table, base->prog->apply_table);
+  ASSERT_NE(derived->prog->apply_table, nullptr);
+  EXPECT_NE(derived->prog->apply_table, base->prog->apply_table);
+
+  auto g = apply_cache_lookup("g", derived->prog);
+  EXPECT_EQ(g.progp, derived->prog);
+  auto f = apply_cache_lookup("f", derived->prog);
+  ASSERT_EQ(f.progp, base->prog);
+  EXPECT_EQ(f.function_index_offset, derived->prog->inherit[1].function_index_offset);
+  EXPECT_EQ(f.variable_index_offset, derived->prog->inherit[1].variable_index_offset);
+  EXPECT_NE(f.variable_index_offset, 0);
+  EXPECT_EQ(apply_cache_lookup("nope", derived->prog).progp, nullptr);
+
+  RunGuarded([&] {
+    auto call = [&](const char* fun, object_t* ob) {
+      auto* ret = apply(fun, ob, 0, ORIGIN_DRIVER);
+      return ret ? ret->u.number : -1;
+    };
+    EXPECT_EQ(call("f", derived), 1);
+    EXPECT_EQ(call("g", derived), 3);
+    EXPECT_EQ(call("h", derived), 4);
+    EXPECT_EQ(call("g", same), 2);
+  });
+
+  RunGuarded([&] {
+    for (auto* ob : {derived, same, other, base}) {
+      destruct_object(ob);
+    }
+  });
+}
+
+// A connection's input buffer starts small, grows with an incomplete
+// command up to 'maximum input buffer size', and shrinks back once drained.
+TEST_F(DriverTest, InputBufferGrowsWithPendingInput) {
+  interactive_t* ip = user_add();
+  ASSERT_EQ(ip->text_size, INITIAL_TEXT);
+
+  std::string const line(10000, 'a');
+  comm_reserve_input_space(ip, line.size());
+  on_user_input(ip, line.data(), line.size());
+  EXPECT_EQ(ip->text_end, 10000);
+  EXPECT_GT(ip->text_size, 10000);
+  EXPECT_FALSE(cmd_in_buf(ip));
+
+  on_user_input(ip, "\n", 1);
+  EXPECT_TRUE(cmd_in_buf(ip));
+
+  // Command consumed: the next read shrinks the buffer again.
+  ip->text_start = ip->text_end;
+  EXPECT_GE(comm_reserve_input_space(ip, 16), 16);
+  EXPECT_EQ(ip->text_size, INITIAL_TEXT);
+
+  // A command longer than the cap is dropped, not buffered.
+  auto saved_cap = CONFIG_INT(__RC_MAX_INPUT_BUFFER_SIZE__);
+  CONFIG_INT(__RC_MAX_INPUT_BUFFER_SIZE__) = 4096;
+  on_user_input(ip, line.data(), 3000);
+  comm_reserve_input_space(ip, 3000);
+  EXPECT_TRUE(ip->iflags & SKIP_COMMAND);
+  EXPECT_EQ(ip->text_end, 0);
+  EXPECT_EQ(ip->text_size, 4096);
+  on_user_input(ip, line.data(), line.size());
+  EXPECT_EQ(ip->text_end, 4095);
+  CONFIG_INT(__RC_MAX_INPUT_BUFFER_SIZE__) = saved_cap;
+
+  user_del(ip);
+  FREE(ip);
+}
+
+// Gametick events run on their due tick, same-tick events in the order they
+// were added (however far ahead they were scheduled), and cancelled events
+// are skipped.
+TEST_F(DriverTest, GametickEventsRunInDueOrder) {
+  std::vector<std::pair<uint64_t, int>> ran;
+  auto record = [&](int id) {
+    return TickEvent::callback_type([&ran, id] { ran.emplace_back(g_current_gametick, id); });
+  };
+  auto const start = g_current_gametick;
+
+  add_gametick_event(5000, record(1));
+  add_gametick_event(64, record(2));
+  add_gametick_event(1, record(3));
+  add_gametick_event(0, record(4));
+  add_gametick_event(5000, record(5));
+  add_gametick_event(70, record(6))->valid = false;
+  // Scheduled later, for the same ticks as 1 and 2.
+  add_gametick_event(1, TickEvent::callback_type([&] {
+    add_gametick_event(5000 - 1, record(7));
+    add_gametick_event(0, record(8));
+  }));
+  for (int i = 0; i < 4000; i++) {
+    backend_run_one_gametick();
+  }
+  add_gametick_event(static_cast<int>(start + 5000 - g_current_gametick), record(9));
+  for (int i = 0; i <= 1000; i++) {
+    backend_run_one_gametick();
+  }
+
+  std::vector<std::pair<uint64_t, int>> const expected{
+      {start, 4},        {start + 1, 3},    {start + 1, 8},    {start + 64, 2},
+      {start + 5000, 1}, {start + 5000, 5}, {start + 5000, 7}, {start + 5000, 9},
+  };
+  EXPECT_EQ(ran, expected);
+}
+
+// Heartbeats on different intervals only run on their due rounds, in the
+// order they were registered.
+TEST_F(DriverTest, HeartBeatsRunOnTheirIntervalInOrder) {
+  object_t* log = nullptr;
+  object_t* obs[3] = {};
+  RunGuarded([&] {
+    log = load_object_from_source(
+        "string beats;\n"
+        "void beat(string who) { beats = (beats ? beats + \",\" : \"\") + who; }\n"
+        "string query_beats() { return beats; }\n",
+        "hb_order_log", 0);
+  });
+  ASSERT_NE(log, nullptr);
+  const char* const names[] = {"hb_order_a", "hb_order_b", "hb_order_c"};
+  const int intervals[] = {1, 3, 2};
+  for (int i = 0; i < 3; i++) {
+    auto source = std::string("void heart_beat() { \"/hb_order_log\"->beat(\"") + names[i] +
+                  "\"); }\n";
+    RunGuarded([&] { obs[i] = load_object_from_source(source.c_str(), names[i], 0); });
+    ASSERT_NE(obs[i], nullptr);
+    set_heart_beat(obs[i], intervals[i]);
+  }
+  EXPECT_EQ(query_heart_beat(obs[1]), 3);
+
+  for (int round = 0; round < 6; round++) {
+    call_heart_beat();
+  }
+  std::string beats;
+  RunGuarded([&] {
+    svalue_t* ret = apply("query_beats", log, 0, ORIGIN_DRIVER);
+    ASSERT_NE(ret, nullptr);
+    ASSERT_EQ(ret->type, T_STRING);
+    beats = ret->u.string;
+  });
+  EXPECT_EQ(beats,
+            "hb_order_a,"
+            "hb_order_a,hb_order_c,"
+            "hb_order_a,hb_order_b,"
+            "hb_order_a,hb_order_c,"
+            "hb_order_a,"
+            "hb_order_a,hb_order_b,hb_order_c");
+
+  RunGuarded([&] {
+    for (auto*& ob : obs) {
+      destruct_object(ob);
+      free_object(&ob, "HeartBeatsRunOnTheirIntervalInOrder");
+    }
+    destruct_object(log);
+    free_object(&log, "HeartBeatsRunOnTheirIntervalInOrder");
+  });
+}
+
+#ifdef PACKAGE_ASYNC
+// async_write()/async_read() deliver the same results from the worker
+// threads and from io_uring (which itself falls back to the workers where
+// the kernel doesn't offer it).
+TEST_F(DriverTest, AsyncFileEfunsAgreeAcrossEngines) {
+  object_t* ob = nullptr;
+  RunGuarded([&] {
+    ob = load_object_from_source(
+        "mixed last;\n"
+        "int calls;\n"
+        "void done(mixed res) { last = res; calls++; }\n"
+        "void write_it(string s) { async_write(\"/async_engines.txt\", s, 1, (: done :)); }\n"
+        "void read_it(string f) { async_read(f, (: done :)); }\n"
+        "int query_calls() { return calls; }\n"
+        "mixed query_last() { return last; }\n",
+        "async_engines", 0);
+  });
+  ASSERT_NE(ob, nullptr);
+
+  // Calls `fun` with `arg`, then runs the event loop until the async
+  // callback has been delivered, and returns what it was given.
+  auto call = [&](const char* fun, const std::string& arg) {
+    int calls = 0;
+    RunGuarded([&] {
+      calls = apply("query_calls", ob, 0, ORIGIN_DRIVER)->u.number;
+      copy_and_push_string(arg.c_str());
+      apply(fun, ob, 1, ORIGIN_DRIVER);
+    });
+    std::string got = "<no callback>";
+    for (int i = 0; i < 10000; i++) {
+      event_base_loop(g_event_base, EVLOOP_NONBLOCK);
+      RunGuarded([&] {
+        if (apply("query_calls", ob, 0, ORIGIN_DRIVER)->u.number == calls) return;
+        svalue_t* ret = apply("query_last", ob, 0, ORIGIN_DRIVER);
+        got = ret->type == T_STRING ? std::string(ret->u.string, SVALUE_STRLEN(ret))
+                                    : std::to_string(ret->u.number);
+      });
+      if (got != "<no callback>") break;
+      usleep(1000);
+    }
+    return got;
+  };
+
+  std::string payload;
+  for (int i = 0; i < 150000; i++) {
+    payload += static_cast<char>('a' + i % 26);
+  }
+  auto const saved_io_uring = CONFIG_INT(__RC_ASYNC_IO_URING__);
+  for (int io_uring : {0, 1}) {
+    SCOPED_TRACE(io_uring ? "io_uring" : "worker threads");
+    CONFIG_INT(__RC_ASYNC_IO_URING__) = io_uring;
+    EXPECT_EQ(call("write_it", payload), "0");
+    auto const contents = call("read_it", "/async_engines.txt");
+    EXPECT_EQ(contents.size(), payload.size());
+    EXPECT_TRUE(contents == payload);
+    EXPECT_EQ(call("read_it", "/async_engines_missing.txt"), "-1");
+  }
+  CONFIG_INT(__RC_ASYNC_IO_URING__) = saved_io_uring;
+  std::remove("async_engines.txt");
+
+  RunGuarded([&] {
+    destruct_object(ob);
+    free_object(&ob, "AsyncFileEfunsAgreeAcrossEngines");
+  });
+}
+#endif
+
+#if defined(F_ASYNC_DB_EXEC) && defined(USE_SQLITE3)
+// Each handle runs its async_db_exec() queries on a worker of its own: the
+// callbacks of one handle come back in the order the queries were issued,
+// whatever the other handle is doing, and db_status() reports each queue.
+TEST_F(DriverTest, AsyncDbExecKeepsPerHandleOrder) {
+  object_t* ob = nullptr;
+  RunGuarded([&] {
+    ob = load_object_from_source(
+        "int *handles;\n"
+        "string *log;\n"
+        "int pending;\n"
+        "void done(int n, string step, mixed res) {\n"
+        "  log += ({ sprintf(\"%d:%s:%O\", n, step, res) }); pending--;\n"
+        "}\n"
+        "void start() {\n"
+        "  handles = ({});\n"
+        "  log = ({});\n"
+        "  for (int n = 0; n < 2; n++) {\n"
+        "    int h = db_connect(\"\", \"/async_db_\" + n + \".sqlite\", \"\", __USE_SQLITE3__);\n"
+        "    handles += ({ h });\n"
+        "    db_exec(h, \"drop table if exists t\");\n"
+        "    pending += 5;\n"
+        "    async_db_exec(h, \"create table t (v int)\", (: done, n, \"create\" :));\n"
+        "    for (int i = 0; i < 3; i++)\n"
+        "      async_db_exec(h, \"insert into t values (\" + i + \")\", (: done, n, \"insert\" :));\n"
+        "    async_db_exec(h, \"select v from t\", (: done, n, \"select\" :));\n"
+        "  }\n"
+        "}\n"
+        "int query_pending() { return pending; }\n"
+        "string *query_log(int n) {\n"
+        "  return filter(log, (: $1[0] == $(n) + '0' :));\n"
+        "}\n"
+        "string status() { return db_status(); }\n"
+        "void finish() { foreach (int h in handles) db_close(h); }\n",
+        "async_db_order", 0);
+    apply("start", ob, 0, ORIGIN_DRIVER);
+  });
+  ASSERT_NE(ob, nullptr);
+
+  int pending = 1;
+  for (int i = 0; i < 10000 && pending > 0; i++) {
+    event_base_loop(g_event_base, EVLOOP_NONBLOCK);
+    RunGuarded([&] { pending = apply("query_pending", ob, 0, ORIGIN_DRIVER)->u.number; });
+    usleep(1000);
+  }
+  ASSERT_EQ(pending, 0);
+
+  for (int n = 0; n < 2; n++) {
+    std::vector<std::string> log;
+    RunGuarded([&] {
+      push_number(n);
+      svalue_t* ret = apply("query_log", ob, 1, ORIGIN_DRIVER);
+      for (int i = 0; i < ret->u.arr->size; i++) {
+        log.emplace_back(ret->u.arr->item[i].u.string);
+      }
+    });
+    auto const prefix = std::to_string(n) + ":";
+    std::vector<std::string> const expected = {
+        prefix + "create:0", prefix + "insert:0", prefix + "insert:0", prefix + "insert:0",
+        prefix + "select:3"};
+    EXPECT_EQ(log, expected);
+  }
+
+  std::string status;
+  RunGuarded([&] {
+    svalue_t* ret = apply("status", ob, 0, ORIGIN_DRIVER);
+    status = ret->u.string;
+    apply("finish", ob, 0, ORIGIN_DRIVER);
+    destruct_object(ob);
+    free_object(&ob, "AsyncDbExecKeepsPerHandleOrder");
+  });
+  EXPECT_NE(status.find("Async queue:   0 queued, 0 running, "), std::string::npos) << status;
+  EXPECT_NE(status.find("Async queries: 5, "), std::string::npos) << status;
+  std::remove("async_db_0.sqlite");
+  std::remove("async_db_1.sqlite");
+}
+#endif
+
 // ---------------------------------------------------------------------------
 // net_dead teardown stress tests (issue #1327).
 //
@@ -574,3 +972,60 @@ TEST_F(DriverTest, RemoveInteractiveDestructedStress) {
   }
   RunGuarded([&] { remove_destructed_objects(); });
 }
+
+// A program restored from the program cache must behave exactly like the
+// freshly compiled one: same tables, inherits re-linked, string switch
+// re-keyed for the live string pool.
+TEST_F(DriverTest, ProgramCacheRoundTrip) {
+  char dir[] = "/tmp/fluffos_pcache_XXXXXX";
+  ASSERT_NE(mkdtemp(dir), nullptr);
+  char* saved_dir = CONFIG_STR(__RC_PROGRAM_CACHE_DIR__);
+  CONFIG_STR(__RC_PROGRAM_CACHE_DIR__) = dir;
+
+  const char* file = "/single/tests/compiler/program_cache";
+  auto const before = program_cache_stats();
+  object_t* ob = nullptr;
+  RunGuarded([&] { ob = find_object(file); });
+  ASSERT_NE(ob, nullptr);
+  EXPECT_GT(program_cache_stats().saves, before.saves);
+  EXPECT_EQ(program_cache_stats().hits, before.hits);
+  int const num_functions = ob->prog->num_functions_defined;
+  int const num_strings = ob->prog->num_strings;
+  int const total_size = ob->prog->total_size;
+
+  RunGuarded([&] {
+    destruct_object(ob);
+    remove_destructed_objects();
+  });
+  ob = nullptr;
+  RunGuarded([&] { ob = find_object(file); });
+  ASSERT_NE(ob, nullptr);
+  EXPECT_EQ(program_cache_stats().hits, before.hits + 1);
+  EXPECT_EQ(ob->prog->num_functions_defined, num_functions);
+  EXPECT_EQ(ob->prog->num_strings, num_strings);
+  EXPECT_EQ(ob->prog->total_size, total_size);
+  ASSERT_EQ(ob->prog->num_inherited, 1);
+  EXPECT_STREQ(ob->prog->inherit[0].prog->filename, "single/tests/compiler/function.lpc");
+
+  RunGuarded([&] { apply("do_tests", ob, 0, ORIGIN_DRIVER); });
+  RunGuarded([&] {
+    copy_and_push_string("granite");
+    svalue_t* ret = apply("kind", ob, 1, ORIGIN_DRIVER);
+    ASSERT_NE(ret, nullptr);
+    ASSERT_EQ(ret->type, T_STRING);
+    EXPECT_STREQ(ret->u.string, "rock");
+  });
+
+  RunGuarded([&] {
+    destruct_object(ob);
+    remove_destructed_objects();
+  });
+  CONFIG_STR(__RC_PROGRAM_CACHE_DIR__) = saved_dir;
+  if (DIR* d = opendir(dir)) {
+    while (dirent* e = readdir(d)) {
+      if (e->d_name[0] != '.') unlink((std::string(dir) + "/" + e->d_name).c_str());
+    }
+    closedir(d);
+  }
+  rmdir(dir);
+}
@@ -0,0 +1,132 @@
+#include <gtest/gtest.h>
+#include "base/std.h"
+
+#include <sstream>
+
+#include "base/internal/tracing.h"
+
+namespace {
+
+TraceData trace(const std::function<void()>& body) {
+  Tracer::start("unused.trace");
+  body();
+  auto data = Tracer::snapshot();
+  Tracer::filename.clear();  // nothing to write out
+  return data;
+}
+
+std::string name_of(const TraceData& data, const TraceRecord& r) { return data.names[r.name]; }
+
+}  // namespace
+
+TEST(TracingTest, RecordsEventsWithInternedNames) {
+  auto data = trace([] {
+    Tracer::setThreadName("test main");
+    Tracer::begin("outer", EventCategory::LPC_FUNCTION, json{{"object", "/obj"}});
+    for (int i = 0; i < 3; i++) {
+      ScopedTracerInner scope("inner", EventCategory::LPC_EFUN, [] { return json{{"n", 1}}; }, 0);
+    }
+    {
+      // Below the time limit: neither recorded nor its args evaluated.
+      bool evaluated = false;
+      ScopedTracerInner scope("fast", EventCategory::DEFAULT, [&] {
+        evaluated = true;
+        return json{};
+      });
+      ASSERT_FALSE(evaluated);
+    }
+    Tracer::end("outer", EventCategory::LPC_FUNCTION);
+  });
+
+  ASSERT_EQ(5u, data.records.size());
+  EXPECT_EQ(0u, data.dropped);
+  EXPECT_EQ(2u, data.names.size());  // "outer" and "inner", once each
+  EXPECT_EQ('B', data.records[0].phase);
+  EXPECT_EQ("outer", name_of(data, data.records[0]));
+  for (int i = 1; i <= 3; i++) {
+    EXPECT_EQ('X', data.records[i].phase);
+    EXPECT_EQ("inner", name_of(data, data.records[i]));
+    EXPECT_EQ(EventCategory::LPC_EFUN, data.records[i].category);
+  }
+  EXPECT_EQ('E', data.records[4].phase);
+  EXPECT_EQ(data.records[0].name, data.records[4].name);
+
+  ASSERT_EQ(4u, data.args.size());
+  EXPECT_EQ(0u, data.args[0].first);
+  EXPECT_EQ("/obj", data.args[0].second["object"]);
+
+  bool named = false;
+  for (const auto& [tid, name] : data.thread_names) {
+    if (tid == data.records[0].thread_id && name == "test main") named = true;
+  }
+  EXPECT_TRUE(named);
+}
+
+TEST(TracingTest, BinaryFileRoundTripsAndConverts) {
+  auto data = trace([] {
+    Tracer::setThreadName("test main");
+    Tracer::begin("outer", EventCategory::LPC_FUNCTION, json{{"object", "/obj"}});
+    Tracer::counter("objects", 42);
+    Tracer::end("outer", EventCategory::LPC_FUNCTION);
+  });
+
+  std::stringstream file;
+  ASSERT_TRUE(write_trace_binary(data, file));
+
+  TraceData read;
+  std::string error;
+  ASSERT_TRUE(read_trace_binary(file, &read, &error)) << error;
+  EXPECT_EQ(data.process_id, read.process_id);
+  EXPECT_EQ(data.names, read.names);
+  EXPECT_EQ(data.thread_names, read.thread_names);
+  ASSERT_EQ(data.records.size(), read.records.size());
+  EXPECT_EQ(0, memcmp(data.records.data(), read.records.data(),
+                      data.records.size() * sizeof(TraceRecord)));
+  EXPECT_EQ(data.args, read.args);
+
+  std::stringstream out;
+  write_trace_json(read, out);
+  auto events = json::parse(out.str());
+  ASSERT_TRUE(events.is_array());
+  ASSERT_EQ(read.thread_names.size() + 3, events.size());
+
+  auto begin = events[read.thread_names.size()];
+  EXPECT_EQ("B", begin["ph"]);
+  EXPECT_EQ("outer", begin["name"]);
+  EXPECT_EQ("LPC Function", begin["cat"]);
+  EXPECT_EQ("/obj", begin["args"]["object"]);
+  auto counter = events[read.thread_names.size() + 1];
+  EXPECT_EQ("C", counter["ph"]);
+  EXPECT_EQ(42, counter["args"]["objects"]);
+  EXPECT_EQ("M", events[0]["ph"]);
+
+  std::stringstream garbage("not a trace");
+  EXPECT_FALSE(read_trace_binary(garbage, &read, &error));
+}
+
+TEST(TracingTest, WrappedRingKeepsNewestEvents) {
+  auto data = trace([] {
+    Tracer::begin("outer", EventCategory::DEFAULT);
+    for (size_t i = 0; i < Tracer::kRingCapacity; i++) {
+      Tracer::logSimpleEvent("tick", EventCategory::DEFAULT);
+    }
+    Tracer::end("outer", EventCategory::DEFAULT);
+  });
+
+  // The begin and the two oldest ticks were overwritten (one slot is always
+  // left out of a wrapped ring), and the end that lost its begin is dropped.
+  EXPECT_EQ(4u, data.dropped);
+  ASSERT_EQ(Tracer::kRingCapacity - 2, data.records.size());
+  for (const auto& r : data.records) {
+    ASSERT_EQ('i', r.phase);
+  }
+  EXPECT_LT(data.records.front().timestamp, data.records.back().timestamp);
+}
+
+TEST(TracingTest, RestartDiscardsThePreviousTrace) {
+  trace([] { Tracer::logSimpleEvent("first", EventCategory::DEFAULT); });
+  auto data = trace([] { Tracer::logSimpleEvent("second", EventCategory::DEFAULT); });
+
+  ASSERT_EQ(1u, data.records.size());
+  EXPECT_EQ("second", name_of(data, data.records[0]));
+}
@@ -544,6 +544,14 @@ void make_efun_tables() {
     total_code++;
   }
 
+  // X-macro over every operator, for tables indexed by opcode
+  // (eval_instruction()'s threaded dispatch).
+  fprintf(f, "\n#define FOR_EACH_OPERATOR(X)");
+  for (int i = 0; i < op_code; i++) {
+    fprintf(f, " \\\n  X(%s)", oper_codes[i]);
+  }
+  fprintf(f, "\n");
+
   fprintf(f, "\n/* efuns */\n");
 
   int efun_base = op_code + 1;
@@ -24,6 +24,9 @@ interactive_t* user_add() {
   auto* user = reinterpret_cast<interactive_t*>(
       DMALLOC(sizeof(interactive_t), TAG_INTERACTIVE, "new_conn_handler"));
   memset(user, 0, sizeof(*user));
+  user->text = reinterpret_cast<char*>(DMALLOC(INITIAL_TEXT, TAG_INPUT_BUF, "user_add: text"));
+  user->text[0] = '\0';
+  user->text_size = INITIAL_TEXT;
   all_users.push_back(user);
   return user;
 }
@@ -31,6 +34,9 @@ interactive_t* user_add() {
 void user_del(interactive_t* user) {
   // remove it from global table.
   all_users.erase(std::remove(all_users.begin(), all_users.end(), user), all_users.end());
+  FREE(user->text);
+  user->text = nullptr;
+  user->text_size = 0;
 }
 
 // Get a copy of all users
@@ -166,7 +166,7 @@ void check_co_args(int num_arg, const program_t* prog, function_t* fun, int find
  * manually !  (Look towards end of this function.)
  */
 
-int apply_low(const char* fun, object_t* ob, int num_arg) {
+int apply_low(const char* fun, object_t* ob, int num_arg, apply_site_cache_t* site) {
   ScopedTracer _tracer(__PRETTY_FUNCTION__);
 
   int local_call_origin = call_origin;
@@ -205,7 +205,9 @@ retry_for_shadow:
 #endif
   DEBUG_CHECK(ob->flags & O_DESTRUCTED, "apply() on destructed object\n");
 
-  auto entry = apply_cache_lookup(fun, ob->prog);
+  // The site cache is keyed by the program actually searched, so the
+  // shadow retry below simply becomes a second way of it.
+  auto entry = site ? apply_site_lookup(site, fun, ob->prog) : apply_cache_lookup(fun, ob->prog);
 
 #ifndef NO_SHADOWS
   if (!entry.progp && ob->shadowing) {
@@ -369,7 +371,7 @@ retry_for_shadow:
  * are deallocated.
  */
 
-svalue_t* apply(const char* fun, object_t* ob, int num_arg, int where) {
+svalue_t* apply(const char* fun, object_t* ob, int num_arg, int where, apply_site_cache_t* site) {
 #ifdef DEBUG
   svalue_t* expected_sp;
 #endif
@@ -379,7 +381,7 @@ svalue_t* apply(const char* fun, object_t* ob, int num_arg, int where) {
 #ifdef DEBUG
   expected_sp = sp - num_arg;
 #endif
-  if (apply_low(fun, ob, num_arg) == 0) {
+  if (apply_low(fun, ob, num_arg, site) == 0) {
     return nullptr;
   }
   free_svalue(&apply_ret_value, "sapply");
@@ -46,10 +46,11 @@ extern struct svalue_t apply_ret_value;
 svalue_t* safe_apply(const char*, struct object_t*, int, int);
 
 // Unsafe version, should only be used in efuns.
-svalue_t* apply(const char*, struct object_t*, int, int);
+// `site` is the inline cache of the calling call_other() site, if any.
+svalue_t* apply(const char*, struct object_t*, int, int, struct apply_site_cache_t* site = nullptr);
 
 // TODO: Some place still use this function.
 // because apply() would reset the value on next call
-int apply_low(const char*, struct object_t*, int);
+int apply_low(const char*, struct object_t*, int, struct apply_site_cache_t* site = nullptr);
 
 #endif /* LPC_APPLY_H_ */
@@ -4,71 +4,184 @@
 
 #include <algorithm>
 #include <memory>
+#include <utility>
 
 #include "base/internal/tracing.h"
 #include "vm/internal/base/program.h"
 
-static inline void fill_lookup_table(program_t* prog);
+uint32_t apply_site_generation = 0;
+
+// Fibonacci hashing of the name pointer; the top bits are the best mixed.
+static inline unsigned int apply_slot(const apply_table_t* table, const char* name) {
+  return (reinterpret_cast<uintptr_t>(name) * 0x9E3779B97F4A7C15ULL) >> table->shift;
+}
+
+static inline apply_table_t::slot_t* apply_table_find(apply_table_t* table, const char* name) {
+  for (auto i = apply_slot(table, name);; i = (i + 1) & table->mask) {
+    auto* slot = &table->slots[i];
+    if (slot->name == name || slot->name == nullptr) {
+      return slot;
+    }
+  }
+}
+
+static inline void apply_table_add(apply_table_t* table, const char* name,
+                                   const lookup_entry_s& entry) {
+  auto* slot = apply_table_find(table, name);
+  // Earlier definitions win: own functions, then the last inherit first.
+  if (slot->name == nullptr) {
+    slot->name = name;
+    slot->entry = entry;
+    table->size++;
+  }
+}
 
 lookup_entry_s apply_cache_lookup(const char* funcname, program_t* prog) {
   ScopedTracer _tracer("Apply Cache Lookup", EventCategory::APPLY_CACHE,
                        [=] { return json{"name", funcname}; });
 
   // All function names are shared string.
-  auto key = (intptr_t)(findstring(funcname));
-  if (key == 0) {
+  const char* name = findstring(funcname);
+  if (name == nullptr) {
     return lookup_entry_s{nullptr};
   }
 
-  if (prog->apply_lookup_table == nullptr) {
-    fill_lookup_table(prog);
+  if (prog->apply_table == nullptr) {
+    build_apply_table(prog);
   }
 
   apply_cache_lookups++;
 
-  auto pos = prog->apply_lookup_table->find(key);
-  if (pos != prog->apply_lookup_table->end()) {
+  auto* slot = apply_table_find(prog->apply_table, name);
+  if (slot->name != nullptr) {
     apply_cache_hits++;
-    return pos->second;
-  } else {
-    return lookup_entry_s{nullptr};
+    return slot->entry;
   }
+  return lookup_entry_s{nullptr};
 }
 
-static inline void fill_lookup_table_recurse(
-    std::unique_ptr<program_t::apply_lookup_table_type>& table, program_t* prog, uint16_t fio,
-    uint16_t vio) {
-  // add all defined functions
+lookup_entry_s apply_site_lookup(apply_site_cache_t* site, const char* funcname,
+                                 program_t* prog) {
+  auto* way = site->way;
+
+  if (way[0].prog == prog && way[0].generation == apply_site_generation) {
+    apply_site_hits++;
+    return way[0].entry;
+  }
+  if (way[1].prog == prog && way[1].generation == apply_site_generation) {
+    apply_site_hits++;
+    std::swap(way[0], way[1]);
+    return way[0].entry;
+  }
+
+  auto entry = apply_cache_lookup(funcname, prog);
+  if (entry.progp) {
+    way[1] = way[0];
+    way[0].prog = prog;
+    way[0].generation = apply_site_generation;
+    way[0].entry = entry;
+  }
+  return entry;
+}
+
+// A program that defines no functions and inherits one program at offset
+// zero can be applied to exactly like that program.
+static inline bool shares_inherited_table(program_t* prog) {
+  if (prog->num_inherited != 1 || prog->inherit[0].function_index_offset != 0 ||
+      prog->inherit[0].variable_index_offset != 0) {
+    return false;
+  }
+  for (int i = 0; i < prog->num_functions_defined; i++) {
+    if (!(prog->function_flags[i + prog->last_inherited] & (FUNC_UNDEFINED | FUNC_PROTOTYPE))) {
+      return false;
+    }
+  }
+  return true;
+}
+
+void build_apply_table(program_t* prog) {
+  if (prog->apply_table != nullptr) {
+    return;
+  }
+  for (int i = 0; i < prog->num_inherited; i++) {
+    build_apply_table(prog->inherit[i].prog);
+  }
+
+  if (shares_inherited_table(prog)) {
+    prog->apply_table = prog->inherit[0].prog->apply_table;
+    prog->apply_table->ref++;
+    apply_tables_shared++;
+    return;
+  }
+
+  // Every inherited program already has its table, so this is one pass
+  // over our own functions and one over each inherited table.
+  unsigned int upper = prog->num_functions_defined;
+  for (int i = 0; i < prog->num_inherited; i++) {
+    upper += prog->inherit[i].prog->apply_table->size;
+  }
+  int bits = 1;
+  while ((1U << bits) < upper + upper / 3 + 1) {
+    bits++;
+  }
+
+  auto* table = new apply_table_t;
+  table->ref = 1;
+  table->size = 0;
+  table->mask = (1U << bits) - 1;
+  table->shift = 64 - bits;
+  table->slots = std::make_unique<apply_table_t::slot_t[]>(table->mask + 1);
+
   for (int i = 0; i < prog->num_functions_defined; i++) {
     auto idx = i + prog->last_inherited;
     if (prog->function_flags[idx] & (FUNC_UNDEFINED | FUNC_PROTOTYPE)) {
       continue;
     }
-
-    auto key = (intptr_t)(prog->function_table[i].funcname);
-    if (table->find(key) == table->end()) {
-      lookup_entry_s entry = {nullptr};
-      entry.progp = prog;
-      entry.funp = &(prog->function_table[i]);
-      entry.runtime_index = fio + idx;
-      entry.function_index_offset = fio;
-      entry.variable_index_offset = vio;
-      table->insert({key, entry});
-    }
+    lookup_entry_s entry = {nullptr};
+    entry.progp = prog;
+    entry.funp = &(prog->function_table[i]);
+    entry.runtime_index = idx;
+    entry.function_index_offset = 0;
+    entry.variable_index_offset = 0;
+    apply_table_add(table, prog->function_table[i].funcname, entry);
   }
 
   // add inherited functions (must go backwards)
   int i = prog->num_inherited;
   while (i--) {
     auto inherit = prog->inherit[i];
-    fill_lookup_table_recurse(table, inherit.prog, fio + inherit.function_index_offset,
-                              vio + inherit.variable_index_offset);
+    auto* inherited = inherit.prog->apply_table;
+    for (unsigned int j = 0; j <= inherited->mask; j++) {
+      auto& slot = inherited->slots[j];
+      if (slot.name == nullptr) {
+        continue;
+      }
+      auto entry = slot.entry;
+      entry.runtime_index += inherit.function_index_offset;
+      entry.function_index_offset += inherit.function_index_offset;
+      entry.variable_index_offset += inherit.variable_index_offset;
+      apply_table_add(table, slot.name, entry);
+    }
   }
-}
 
-static inline void fill_lookup_table(program_t* prog) {
-  prog->apply_lookup_table = std::make_unique<program_t::apply_lookup_table_type>();
-  fill_lookup_table_recurse(prog->apply_lookup_table, prog, 0, 0);
+  prog->apply_table = table;
+  apply_tables++;
+  apply_cache_items += table->size;
+  apply_cache_slots += table->mask + 1;
+}
 
-  apply_cache_items += prog->apply_lookup_table->size();
+void free_apply_table(program_t* prog) {
+  auto* table = prog->apply_table;
+  if (table == nullptr) {
+    return;
+  }
+  prog->apply_table = nullptr;
+  if (--table->ref > 0) {
+    apply_tables_shared--;
+    return;
+  }
+  apply_tables--;
+  apply_cache_items -= table->size;
+  apply_cache_slots -= table->mask + 1;
+  delete table;
 }
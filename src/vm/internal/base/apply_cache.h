@@ -5,4 +5,25 @@
 
 lookup_entry_s apply_cache_lookup(const char* funcname, struct program_t* prog);
 
+// Build prog->apply_table, once all its inherits are linked in; done as
+// the program is loaded. free_apply_table() drops the program's reference.
+void build_apply_table(struct program_t* prog);
+void free_apply_table(struct program_t* prog);
+
+// apply_cache_lookup() through the inline cache of one call site, which
+// must always look up the same funcname. Only found entries are cached.
+lookup_entry_s apply_site_lookup(apply_site_cache_t* site, const char* funcname,
+                                 struct program_t* prog);
+
+// Bumped whenever a program is freed, so a site cache never matches a
+// new program that reuses the address of a freed one.
+extern uint32_t apply_site_generation;
+
+inline apply_site_cache_t* apply_site_cache(program_t* prog, int index) {
+  if (prog->call_site_caches == nullptr) {
+    prog->call_site_caches = std::make_unique<apply_site_cache_t[]>(prog->num_call_sites);
+  }
+  return &prog->call_site_caches[index];
+}
+
 #endif /* LPC_APPLY_CACHE_H_ */
@@ -280,16 +280,18 @@ svalue_t* call_function_pointer(funptr_t* funp, int num_arg) {
         }
 
         {
-          ScopedTracer _efun_tracer(instrs[i].name, EventCategory::LPC_EFUN, [&] {
-            json trace_context = {};
-
+          // The efun consumes its arguments, so summarize them before the call.
+          json trace_context = {};
+          if (Tracer::enabled()) {
             json args = json::array();
             for (int i = st_num_arg; i > 0; i--) {
               args.push_back(svalue_to_json_summary(sp - i + 1));
             }
             trace_context["args"] = args;
-            return trace_context;
-          });
+          }
+
+          ScopedTracer _efun_tracer(instrs[i].name, EventCategory::LPC_EFUN,
+                                    [&] { return trace_context; });
 
           (*efun_table[i - EFUN_BASE])();
         }
@@ -16,6 +16,7 @@
 #include "vm/internal/base/apply_cache.h"
 #include "vm/internal/base/machine.h"
 #include "vm/internal/eval_limit.h"
+#include "vm/internal/profiler.h"
 #include "vm/internal/master.h"
 #include "vm/internal/simulate.h"
 #include "vm/internal/simul_efun.h"
@@ -67,6 +68,31 @@ static inline void replace_lvalue_with_value_on_stack(svalue_t* slot, const char
   free_svalue(&tmp, where);
 }
 
+/* What F_LOCAL and F_GLOBAL push for the variable at 's'. */
+static inline void push_variable(svalue_t* s) {
+  /*
+   * If variable points to a destructed object, replace it
+   * with 0, otherwise, fetch value of variable.
+   */
+  if ((s->type == T_OBJECT) && (s->u.ob->flags & O_DESTRUCTED)) {
+    assign_svalue(s, &const0u);
+  }
+  push_svalue(s);
+}
+
+/* Replace the index on top of the stack with arr[index], if it is in range. */
+static inline bool index_array_in_place(array_t* arr) {
+  if (sp->type != T_NUMBER || sp->u.number < 0 || sp->u.number >= arr->size) {
+    return false;
+  }
+  svalue_t* item = &arr->item[sp->u.number];
+  if (item->type == T_OBJECT && (item->u.ob->flags & O_DESTRUCTED)) {
+    assign_svalue(item, &const0u);
+  }
+  assign_svalue_no_free(sp, item);
+  return true;
+}
+
 static inline void assign_value_to_lvalue(svalue_t* lval, svalue_t* value, const char* where) {
   switch (lval->type) {
     case T_LVALUE_BYTE: {
@@ -139,6 +165,7 @@ svalue_t* sp;
 int function_index_offset; /* Needed for inheritance */
 int variable_index_offset; /* Needed for inheritance */
 int st_num_arg;
+apply_site_cache_t* call_other_site;
 
 // For safety, we leave some buffer in before and after the space.
 static svalue_t _stack[10 + CFG_EVALUATOR_STACK_SIZE + 10];
@@ -2244,8 +2271,47 @@ json get_trace_context(control_stack_t* csp, svalue_t* sp) {
   return context;
 }
 
+void eval_interrupted() {
+  debug_message("Eval interrupted: object %s cost limit reached, limit: %ld usec.\n",
+                current_object->obname, max_eval_cost);
+  set_eval(max_eval_cost);
+  max_eval_error = 1;
+  error("Too long evaluation. Execution aborted.\n");
+}
+
 }  // namespace
 
+/*
+ * With ENABLE_THREADED_DISPATCH, eval_instruction() jumps straight from one
+ * opcode to the next through a table of label addresses (GCC/Clang
+ * labels-as-values), so each opcode ends in its own indirect jump rather
+ * than all of them sharing the switch's. The per-instruction debug, trace
+ * and eval-limit checks are then skipped unless something needs them: the
+ * eval limit (and a due profiler sample) is checked at backward branches and
+ * calls instead, which is enough to stop any runaway loop or recursion, and
+ * the table is switched to one that routes every opcode through the full
+ * checks while DBG_LPC, 'trace code' or 'trace instr' is on.
+ */
+#ifdef ENABLE_THREADED_DISPATCH
+#define CASE(op) \
+  case op:       \
+  op_##op
+#define DEFAULT_CASE \
+  default:           \
+  op_default
+#define EVAL_CHECKPOINT()                        \
+  if (__builtin_expect(outoftime, 0)) {          \
+    eval_interrupted();                          \
+  }                                              \
+  if (__builtin_expect(profile_sample_due, 0)) { \
+    profile_sample();                            \
+  }
+#else
+#define CASE(op) case op
+#define DEFAULT_CASE default
+#define EVAL_CHECKPOINT()
+#endif
+
 /*
  * Evaluate instructions at address 'p'. All program offsets are
  * to current_prog->program. 'current_prog' must be setup before
@@ -2306,7 +2372,36 @@ void eval_instruction(char* p) {
   const bool trace_code = CONFIG_INT(__RC_TRACE_CODE__) != 0;
   const bool trace_instr = CONFIG_INT(__RC_TRACE_INSTR__) != 0;
 
+#ifdef ENABLE_THREADED_DISPATCH
+  /* Indexed by opcode: fast_dispatch jumps straight to the opcode's case,
+   * checked_dispatch sends every opcode through the checks at the top of
+   * the loop first. */
+  static const void* fast_dispatch[256];
+  static const void* checked_dispatch[256];
+  if (!fast_dispatch[0]) {
+    for (int op = 0; op < 256; op++) {
+      fast_dispatch[op] = &&op_default;
+      checked_dispatch[op] = &&checked_instruction;
+    }
+#define SET_DISPATCH(op) fast_dispatch[op] = &&op_##op;
+    FOR_EACH_OPERATOR(SET_DISPATCH)
+#undef SET_DISPATCH
+  }
+  const void* const* dispatch;
+#define SELECT_DISPATCH()                                                             \
+  dispatch = (trace_code || trace_instr || (debug_level & DBG_LPC)) ? checked_dispatch \
+                                                                    : fast_dispatch
+  SELECT_DISPATCH();
+  EVAL_CHECKPOINT();
+#endif
+
   while (true) {
+#ifdef ENABLE_THREADED_DISPATCH
+    instruction = EXTRACT_UCHAR(pc++);
+    goto* dispatch[instruction];
+  checked_instruction:
+    pc--;
+#endif
     if (debug_level & DBG_LPC) {
       char* f;
       int l;
@@ -2331,11 +2426,10 @@ void eval_instruction(char* p) {
     }
 
     if (outoftime) {
-      debug_message("Eval interrupted: object %s cost limit reached, limit: %ld usec.\n",
-                    current_object->obname, max_eval_cost);
-      set_eval(max_eval_cost);
-      max_eval_error = 1;
-      error("Too long evaluation. Execution aborted.\n");
+      eval_interrupted();
+    }
+    if (profile_sample_due) {
+      profile_sample();
     }
     /*
      * Execute current instruction. Note that all functions callable from
@@ -2345,9 +2439,12 @@ void eval_instruction(char* p) {
     if (trace_instr) {
       ScopedTracer _tracer_ins(instrs[instruction].name ? instrs[instruction].name : "unknown");
     }
+#ifdef ENABLE_THREADED_DISPATCH
+    goto* fast_dispatch[instruction];
+#endif
 
     switch (instruction) {
-      case F_PUSH: /* Push a number of things onto the stack */
+      CASE(F_PUSH): /* Push a number of things onto the stack */
         n = EXTRACT_UCHAR(pc++);
         while (n--) {
           i = EXTRACT_UCHAR(pc++);
@@ -2381,7 +2478,7 @@ void eval_instruction(char* p) {
           }
         }
         break;
-      case F_INC:
+      CASE(F_INC):
         if (sp->type != T_LVALUE) {
           error("Invalid Program: non-lvalue argument to ++\n");
         }
@@ -2420,9 +2517,10 @@ void eval_instruction(char* p) {
             error("++ of non-numeric argument\n");
         }
         break;
-      case F_WHILE_DEC: {
+      CASE(F_WHILE_DEC): {
         svalue_t* s;
 
+        EVAL_CHECKPOINT();
         s = fp + EXTRACT_UCHAR(pc++);
         if (s->type == T_NUMBER) {
           i = s->u.number--;
@@ -2438,13 +2536,13 @@ void eval_instruction(char* p) {
           pc += 2;
         }
       } break;
-      case F_LOCAL_LVALUE:
+      CASE(F_LOCAL_LVALUE):
         STACK_INC;
         sp->type = T_LVALUE;
         sp->u.lvalue = fp + EXTRACT_UCHAR(pc++);
         break;
 #ifdef REF_RESERVED_WORD
-      case F_MAKE_REF: {
+      CASE(F_MAKE_REF): {
         ref_t* ref;
         int op = EXTRACT_UCHAR(pc++);
         /* global and local refs need no protection since they are
@@ -2486,7 +2584,7 @@ void eval_instruction(char* p) {
         sp->u.ref = ref;
         break;
       }
-      case F_KILL_REFS: {
+      CASE(F_KILL_REFS): {
         int num = EXTRACT_UCHAR(pc++);
         while (num--) {
           /* An error unwind inside this call's argument list (e.g. a catch()
@@ -2501,7 +2599,7 @@ void eval_instruction(char* p) {
         }
         break;
       }
-      case F_REF: {
+      CASE(F_REF): {
         svalue_t* s = fp + EXTRACT_UCHAR(pc++);
         svalue_t* reflval = nullptr;
 
@@ -2536,7 +2634,7 @@ void eval_instruction(char* p) {
 
         break;
       }
-      case F_REF_LVALUE: {
+      CASE(F_REF_LVALUE): {
         svalue_t* s = fp + EXTRACT_UCHAR(pc++);
 
         if (s->type == T_REF) {
@@ -2561,29 +2659,29 @@ void eval_instruction(char* p) {
         break;
       }
 #endif
-      case F_SHORT_INT: {
+      CASE(F_SHORT_INT): {
         short s;
 
         LOAD_SHORT(s, pc);
         push_number(s);
         break;
       }
-      case F_NUMBER:
+      CASE(F_NUMBER):
         LOAD_INT(i, pc);
         push_number(i);
         break;
-      case F_REAL:
+      CASE(F_REAL):
         LOAD_FLOAT(real, pc);
         push_real(real);
         break;
-      case F_BYTE:
+      CASE(F_BYTE):
         push_number(EXTRACT_UCHAR(pc++));
         break;
-      case F_NBYTE:
+      CASE(F_NBYTE):
         push_number(-(EXTRACT_UCHAR(pc++)));
         break;
 #ifdef F_JUMP_WHEN_NON_ZERO
-      case F_JUMP_WHEN_NON_ZERO:
+      CASE(F_JUMP_WHEN_NON_ZERO):
         if ((i = (sp->type == T_NUMBER)) && (sp->u.number == 0)) {
           pc += 2;
         } else {
@@ -2598,15 +2696,16 @@ void eval_instruction(char* p) {
         }
         break;
 #endif
-      case F_BRANCH: /* relative offset */
+      CASE(F_BRANCH): /* relative offset */
         COPY_SHORT(&offset, pc);
         pc += offset;
         break;
-      case F_BBRANCH: /* relative offset */
+      CASE(F_BBRANCH): /* relative offset */
+        EVAL_CHECKPOINT();
         COPY_SHORT(&offset, pc);
         pc -= offset;
         break;
-      case F_BRANCH_NE:
+      CASE(F_BRANCH_NE):
         f_ne();
         if ((sp--)->u.number) {
           COPY_SHORT(&offset, pc);
@@ -2615,7 +2714,7 @@ void eval_instruction(char* p) {
           pc += 2;
         }
         break;
-      case F_BRANCH_GE:
+      CASE(F_BRANCH_GE):
         f_ge();
         if ((sp--)->u.number) {
           COPY_SHORT(&offset, pc);
@@ -2624,7 +2723,7 @@ void eval_instruction(char* p) {
           pc += 2;
         }
         break;
-      case F_BRANCH_LE:
+      CASE(F_BRANCH_LE):
         f_le();
         if ((sp--)->u.number) {
           COPY_SHORT(&offset, pc);
@@ -2633,7 +2732,7 @@ void eval_instruction(char* p) {
           pc += 2;
         }
         break;
-      case F_BRANCH_EQ:
+      CASE(F_BRANCH_EQ):
         f_eq();
         if ((sp--)->u.number) {
           COPY_SHORT(&offset, pc);
@@ -2642,7 +2741,55 @@ void eval_instruction(char* p) {
           pc += 2;
         }
         break;
-      case F_BBRANCH_LT:
+      CASE(F_LOCAL_NUMBER_BRANCH): {
+        svalue_t* s = fp + EXTRACT_UCHAR(pc++);
+        int const branch = EXTRACT_UCHAR(pc++);
+
+        LOAD_INT(i, pc);
+        if (s->type == T_NUMBER) {
+          switch (branch) {
+            case F_BRANCH_NE:
+              n = s->u.number != i;
+              break;
+            case F_BRANCH_GE:
+              n = s->u.number >= i;
+              break;
+            case F_BRANCH_LE:
+              n = s->u.number <= i;
+              break;
+            default:
+              n = s->u.number == i;
+              break;
+          }
+        } else {
+          push_variable(s);
+          push_number(i);
+          switch (branch) {
+            case F_BRANCH_NE:
+              f_ne();
+              break;
+            case F_BRANCH_GE:
+              f_ge();
+              break;
+            case F_BRANCH_LE:
+              f_le();
+              break;
+            default:
+              f_eq();
+              break;
+          }
+          n = (sp--)->u.number;
+        }
+        if (n) {
+          COPY_SHORT(&offset, pc);
+          pc += offset;
+        } else {
+          pc += 2;
+        }
+        break;
+      }
+      CASE(F_BBRANCH_LT):
+        EVAL_CHECKPOINT();
         f_lt();
         if ((sp--)->u.number) {
           COPY_SHORT(&offset, pc);
@@ -2651,7 +2798,7 @@ void eval_instruction(char* p) {
           pc += 2;
         }
         break;
-      case F_BRANCH_WHEN_ZERO: /* relative offset */
+      CASE(F_BRANCH_WHEN_ZERO): /* relative offset */
         if ((sp->type == T_NUMBER && !sp->u.number) || (sp->type == T_REAL && !sp->u.real)) {
           sp--;
           COPY_SHORT(&offset, pc);
@@ -2662,7 +2809,7 @@ void eval_instruction(char* p) {
         }
         pc += 2; /* skip over the offset */
         break;
-      case F_BRANCH_WHEN_NON_ZERO: /* relative offset */
+      CASE(F_BRANCH_WHEN_NON_ZERO): /* relative offset */
         if ((sp->type == T_NUMBER && !sp->u.number) || (sp->type == T_REAL && !sp->u.real)) {
           sp--;
           pc += 2;
@@ -2673,7 +2820,8 @@ void eval_instruction(char* p) {
         COPY_SHORT(&offset, pc);
         pc += offset;
         break;
-      case F_BBRANCH_WHEN_ZERO: /* relative backwards offset */
+      CASE(F_BBRANCH_WHEN_ZERO): /* relative backwards offset */
+        EVAL_CHECKPOINT();
         if ((sp->type == T_NUMBER && !sp->u.number) || (sp->type == T_REAL && !sp->u.real)) {
           sp--;
           COPY_SHORT(&offset, pc);
@@ -2684,7 +2832,8 @@ void eval_instruction(char* p) {
         }
         pc += 2;
         break;
-      case F_BBRANCH_WHEN_NON_ZERO: /* relative backwards offset */
+      CASE(F_BBRANCH_WHEN_NON_ZERO): /* relative backwards offset */
+        EVAL_CHECKPOINT();
         if ((sp->type == T_NUMBER && !sp->u.number) || (sp->type == T_REAL && !sp->u.real)) {
           sp--;
           pc += 2;
@@ -2695,7 +2844,7 @@ void eval_instruction(char* p) {
         COPY_SHORT(&offset, pc);
         pc -= offset;
         break;
-      case F_LOR:
+      CASE(F_LOR):
         /* replaces F_DUP; F_BRANCH_WHEN_NON_ZERO; F_POP */
         if ((sp->type == T_NUMBER && !sp->u.number) || (sp->type == T_REAL && !sp->u.real)) {
           pc += 2;
@@ -2705,7 +2854,7 @@ void eval_instruction(char* p) {
         COPY_SHORT(&offset, pc);
         pc += offset;
         break;
-      case F_LAND:
+      CASE(F_LAND):
         /* replaces F_DUP; F_BRANCH_WHEN_ZERO; F_POP */
         if (sp->type == T_NUMBER || sp->type == T_REAL) {
           if ((sp->type == T_NUMBER && !sp->u.number) || (sp->type == T_REAL && !sp->u.real)) {
@@ -2719,7 +2868,7 @@ void eval_instruction(char* p) {
         }
         pc += 2;
         break;
-      case F_NULLISH:
+      CASE(F_NULLISH):
         /* Nullish coalescing: like F_LOR but checks undefined instead of falsy
          * Undefined is T_NUMBER with value 0 and subtype T_UNDEFINED
          * If value is undefined, pop it and evaluate right side
@@ -2734,7 +2883,7 @@ void eval_instruction(char* p) {
         COPY_SHORT(&offset, pc);
         pc += offset;
         break;
-      case F_LOR_EQ: {
+      CASE(F_LOR_EQ): {
         if (sp->type != T_LVALUE) {
           error("Invalid Program: non-lvalue argument to ||=.");
         }
@@ -2758,7 +2907,7 @@ void eval_instruction(char* p) {
         }
         break;
       }
-      case F_LAND_EQ: {
+      CASE(F_LAND_EQ): {
         if (sp->type != T_LVALUE) {
           error("Invalid Program: non-lvalue argument to &&=.");
         }
@@ -2780,7 +2929,7 @@ void eval_instruction(char* p) {
         }
         break;
       }
-      case F_NULLISH_EQ: {
+      CASE(F_NULLISH_EQ): {
         if (sp->type != T_LVALUE) {
           error("Invalid Program: non-lvalue argument to ??=.");
         }
@@ -2801,9 +2950,10 @@ void eval_instruction(char* p) {
         }
         break;
       }
-      case F_LOOP_INCR: /* this case must be just prior to
+      CASE(F_LOOP_INCR): /* this case must be just prior to
                          * F_LOOP_COND */
       {
+        EVAL_CHECKPOINT();
         svalue_t* s;
 
         s = fp + EXTRACT_UCHAR(pc++);
@@ -2823,13 +2973,15 @@ void eval_instruction(char* p) {
           do_loop_cond_number();
         }
         break;
-      case F_LOOP_COND_LOCAL:
+      CASE(F_LOOP_COND_LOCAL):
+        EVAL_CHECKPOINT();
         do_loop_cond_local();
         break;
-      case F_LOOP_COND_NUMBER:
+      CASE(F_LOOP_COND_NUMBER):
+        EVAL_CHECKPOINT();
         do_loop_cond_number();
         break;
-      case F_TRANSFER_LOCAL: {
+      CASE(F_TRANSFER_LOCAL): {
         svalue_t* s;
 
         s = fp + EXTRACT_UCHAR(pc++);
@@ -2844,7 +2996,7 @@ void eval_instruction(char* p) {
         assign_svalue_no_free(sp, s);
         break;
       }
-      case F_LOCAL: {
+      CASE(F_LOCAL): {
         svalue_t* s;
 
         s = fp + EXTRACT_UCHAR(pc++);
@@ -2861,10 +3013,23 @@ void eval_instruction(char* p) {
         push_svalue(s);
         break;
       }
-      case F_LT:
+      CASE(F_LT):
         f_lt();
         break;
-      case F_ADD: {
+      CASE(F_LOCAL_LOCAL_ADD): {
+        svalue_t* s1 = fp + EXTRACT_UCHAR(pc++);
+        svalue_t* s2 = fp + EXTRACT_UCHAR(pc++);
+
+        if (s1->type == T_NUMBER && s2->type == T_NUMBER) {
+          push_number(s1->u.number + s2->u.number);
+          break;
+        }
+        push_variable(s1);
+        push_variable(s2);
+        goto add_top_two;
+      }
+      CASE(F_ADD):
+      add_top_two: {
         switch (sp->type) {
           case T_BUFFER: {
             if (!((sp - 1)->type == T_BUFFER)) {
@@ -3030,8 +3195,8 @@ void eval_instruction(char* p) {
         }
         break;
       }
-      case F_VOID_ADD_EQ:
-      case F_ADD_EQ: {
+      CASE(F_VOID_ADD_EQ):
+      CASE(F_ADD_EQ): {
         if (sp->type != T_LVALUE) error("Invalid Program: non-lvalue argument to +=.");
         lval = sp->u.lvalue;
         mapping_t *watched_map = nullptr;
@@ -3186,17 +3351,17 @@ void eval_instruction(char* p) {
         }
         break;
       }
-      case F_AND:
+      CASE(F_AND):
         f_and();
         break;
-      case F_AND_EQ:
+      CASE(F_AND_EQ):
         f_and_eq();
         break;
-      case F_FUNCTION_CONSTRUCTOR:
+      CASE(F_FUNCTION_CONSTRUCTOR):
         f_function_constructor();
         break;
 
-      case F_FOREACH: {
+      CASE(F_FOREACH): {
         int flags = EXTRACT_UCHAR(pc++);
 
 #ifdef DEBUG
@@ -3309,7 +3474,8 @@ void eval_instruction(char* p) {
         }
         break;
       }
-      case F_NEXT_FOREACH:
+      CASE(F_NEXT_FOREACH):
+        EVAL_CHECKPOINT();
         if ((sp - 1)->type == T_LVALUE) {
           /* mapping */
           if ((sp - 2)->u.lvalue < (sp - 3)->u.arr->item + (sp - 3)->u.arr->size) {
@@ -3407,8 +3573,8 @@ void eval_instruction(char* p) {
           }
         }
         pc += 2;
-        /* fallthrough */
-      case F_EXIT_FOREACH:
+        [[fallthrough]];
+      CASE(F_EXIT_FOREACH):
 #ifdef DEBUG
         stack_in_use_as_temporary--;
 #endif
@@ -3452,7 +3618,7 @@ void eval_instruction(char* p) {
         }
         break;
 
-      case F_EXPAND_VARARGS: {
+      CASE(F_EXPAND_VARARGS): {
         svalue_t *s, *t;
         array_t* arr;
 
@@ -3499,19 +3665,19 @@ void eval_instruction(char* p) {
         break;
       }
 
-      case F_NEW_CLASS: {
+      CASE(F_NEW_CLASS): {
         array_t* cl;
 
         cl = allocate_class(&current_prog->classes[EXTRACT_UCHAR(pc++)], 1);
         push_refed_class(cl);
       } break;
-      case F_NEW_EMPTY_CLASS: {
+      CASE(F_NEW_EMPTY_CLASS): {
         array_t* cl;
 
         cl = allocate_class(&current_prog->classes[EXTRACT_UCHAR(pc++)], 0);
         push_refed_class(cl);
       } break;
-      case F_AGGREGATE: {
+      CASE(F_AGGREGATE): {
         array_t* v;
 
         LOAD_SHORT(offset, pc);
@@ -3526,7 +3692,7 @@ void eval_instruction(char* p) {
         }
         push_refed_array(v);
       } break;
-      case F_AGGREGATE_ASSOC: {
+      CASE(F_AGGREGATE_ASSOC): {
         mapping_t* m;
 
         LOAD_SHORT(offset, pc);
@@ -3537,7 +3703,7 @@ void eval_instruction(char* p) {
         push_refed_mapping(m);
         break;
       }
-      case F_ASSIGN:
+      CASE(F_ASSIGN):
 #ifdef DEBUG
         if (sp->type != T_LVALUE) {
           fatal("Bad argument to F_ASSIGN\n");
@@ -3576,7 +3742,7 @@ void eval_instruction(char* p) {
         sp--; /* ignore lvalue */
         /* rvalue is already in the correct place */
         break;
-      case F_ASSIGN_VALUE: {
+      CASE(F_ASSIGN_VALUE): {
         if (sp->type == T_LVALUE || (sp - 1)->type != T_LVALUE) {
           error("Invalid Program: bad stack for F_ASSIGN_VALUE.");
         }
@@ -3596,7 +3762,7 @@ void eval_instruction(char* p) {
         free_svalue(sp--, "F_ASSIGN_VALUE");
         break;
       }
-      case F_VOID_ASSIGN_LOCAL:
+      CASE(F_VOID_ASSIGN_LOCAL):
         if (sp->type != T_INVALID) {
           lval = fp + EXTRACT_UCHAR(pc++);
           free_svalue(lval, "F_VOID_ASSIGN_LOCAL");
@@ -3606,7 +3772,7 @@ void eval_instruction(char* p) {
           pc++;
         }
         break;
-      case F_VOID_ASSIGN:
+      CASE(F_VOID_ASSIGN):
 #ifdef DEBUG
         if (sp->type != T_LVALUE) {
           fatal("Bad argument to F_VOID_ASSIGN\n");
@@ -3660,11 +3826,12 @@ void eval_instruction(char* p) {
         }
         break;
 #ifdef DEBUG
-      case F_BREAK_POINT:
+      CASE(F_BREAK_POINT):
         break_point();
         break;
 #endif
-      case F_CALL_FUNCTION_BY_ADDRESS: {
+      CASE(F_CALL_FUNCTION_BY_ADDRESS): {
+        EVAL_CHECKPOINT();
         LOAD_SHORT(offset, pc);
 
         offset += function_index_offset;
@@ -3715,7 +3882,8 @@ void eval_instruction(char* p) {
           Tracer::begin(*csp->trace_id, EventCategory::LPC_FUNCTION, std::move(trace_context));
         }
       } break;
-      case F_CALL_INHERITED: {
+      CASE(F_CALL_INHERITED): {
+        EVAL_CHECKPOINT();
         inherit_t* ip = current_prog->inherit + EXTRACT_UCHAR(pc++);
         program_t* temp_prog = ip->prog;
         function_t* funp;
@@ -3763,20 +3931,20 @@ void eval_instruction(char* p) {
           Tracer::begin(*csp->trace_id, EventCategory::LPC_FUNCTION, std::move(trace_context));
         }
       } break;
-      case F_COMPL:
+      CASE(F_COMPL):
         if (sp->type != T_NUMBER) {
           error("Bad argument to ~\n");
         }
         sp->u.number = ~sp->u.number;
         sp->subtype = 0;
         break;
-      case F_CONST0:
+      CASE(F_CONST0):
         push_number(0);
         break;
-      case F_CONST1:
+      CASE(F_CONST1):
         push_number(1);
         break;
-      case F_PRE_DEC:
+      CASE(F_PRE_DEC):
         if (sp->type != T_LVALUE) error("Invalid Program: non-lvalue argument to --.");
         lval = sp->u.lvalue;
         switch (lval->type) {
@@ -3828,7 +3996,7 @@ void eval_instruction(char* p) {
             error("-- of non-numeric argument\n");
         }
         break;
-      case F_DEC:
+      CASE(F_DEC):
         if (sp->type != T_LVALUE) error("Invalid Program: non-lvalue argument to --.");
         lval = (sp--)->u.lvalue;
         switch (lval->type) {
@@ -3864,7 +4032,7 @@ void eval_instruction(char* p) {
             error("-- of non-numeric argument\n");
         }
         break;
-      case F_DIVIDE: {
+      CASE(F_DIVIDE): {
         switch ((sp - 1)->type | sp->type) {
           case T_NUMBER: {
             if (!(sp--)->u.number) {
@@ -3913,19 +4081,19 @@ void eval_instruction(char* p) {
           }
         }
       } break;
-      case F_DIV_EQ:
+      CASE(F_DIV_EQ):
         f_div_eq();
         break;
-      case F_EQ:
+      CASE(F_EQ):
         f_eq();
         break;
-      case F_GE:
+      CASE(F_GE):
         f_ge();
         break;
-      case F_GT:
+      CASE(F_GT):
         f_gt();
         break;
-      case F_GLOBAL: {
+      CASE(F_GLOBAL): {
         svalue_t* s;
 
         unsigned short idx = 0;
@@ -3942,7 +4110,7 @@ void eval_instruction(char* p) {
         push_svalue(s);
         break;
       }
-      case F_PRE_INC:
+      CASE(F_PRE_INC):
         if (sp->type != T_LVALUE) error("Invalid Program: non-lvalue argument to ++.");
         lval = sp->u.lvalue;
         switch (lval->type) {
@@ -3991,7 +4159,7 @@ void eval_instruction(char* p) {
             error("++ of non-numeric argument\n");
         }
         break;
-      case F_MEMBER: {
+      CASE(F_MEMBER): {
         array_t* arr;
 
         if (sp->type != T_CLASS) {
@@ -4010,7 +4178,7 @@ void eval_instruction(char* p) {
 
         break;
       }
-      case F_MEMBER_LVALUE: {
+      CASE(F_MEMBER_LVALUE): {
         array_t* arr;
 
         if (sp->type != T_CLASS) {
@@ -4030,7 +4198,7 @@ void eval_instruction(char* p) {
         free_class(arr);
         break;
       }
-      case F_MAP_MEMBER: {
+      CASE(F_MAP_MEMBER): {
         uint16_t offset;
         LOAD_SHORT(offset, pc);
         if (offset >= current_prog->num_strings) {
@@ -4048,7 +4216,7 @@ void eval_instruction(char* p) {
         free_mapping(m);
         break;
       }
-      case F_MAP_MEMBER_OPTIONAL: {
+      CASE(F_MAP_MEMBER_OPTIONAL): {
         uint16_t offset;
         LOAD_SHORT(offset, pc);
         if (offset >= current_prog->num_strings) {
@@ -4068,7 +4236,7 @@ void eval_instruction(char* p) {
         free_mapping(m);
         break;
       }
-      case F_MAP_MEMBER_LVALUE: {
+      CASE(F_MAP_MEMBER_LVALUE): {
         uint16_t offset;
         LOAD_SHORT(offset, pc);
         if (offset >= current_prog->num_strings) {
@@ -4099,7 +4267,29 @@ void eval_instruction(char* p) {
         m->ref--;
         break;
       }
-      case F_INDEX:
+      CASE(F_LOCAL_INDEX): {
+        svalue_t* s = fp + EXTRACT_UCHAR(pc++);
+
+        if (s->type == T_ARRAY && index_array_in_place(s->u.arr)) {
+          break;
+        }
+        push_variable(s);
+        goto index_top_two;
+      }
+      CASE(F_GLOBAL_INDEX): {
+        svalue_t* s;
+        unsigned short idx = 0;
+
+        LOAD2(idx, pc);
+        s = find_value(idx + variable_index_offset);
+        if (s->type == T_ARRAY && index_array_in_place(s->u.arr)) {
+          break;
+        }
+        push_variable(s);
+        goto index_top_two;
+      }
+      CASE(F_INDEX):
+      index_top_two:
         switch (sp->type) {
           case T_MAPPING: {
             ScopedTracer _tracer_index("F_INDEX: mapping");
@@ -4183,7 +4373,7 @@ void eval_instruction(char* p) {
             error("Cannot index value of type '%s'.\n", type_name(sp->type));
         }
         break;
-      case F_RINDEX:
+      CASE(F_RINDEX):
         switch (sp->type) {
           case T_BUFFER: {
             if ((sp - 1)->type != T_NUMBER) {
@@ -4248,7 +4438,7 @@ void eval_instruction(char* p) {
         }
         break;
 #ifdef F_JUMP_WHEN_ZERO
-      case F_JUMP_WHEN_ZERO:
+      CASE(F_JUMP_WHEN_ZERO):
         if ((i = (sp->type == T_NUMBER)) && sp->u.number == 0) {
           COPY_SHORT(&offset, pc);
           pc = current_prog->program + offset;
@@ -4264,21 +4454,21 @@ void eval_instruction(char* p) {
         break;
 #endif
 #ifdef F_JUMP
-      case F_JUMP:
+      CASE(F_JUMP):
         COPY_SHORT(&offset, pc);
         pc = current_prog->program + offset;
         break;
 #endif
-      case F_LE:
+      CASE(F_LE):
         f_le();
         break;
-      case F_LSH:
+      CASE(F_LSH):
         f_lsh();
         break;
-      case F_LSH_EQ:
+      CASE(F_LSH_EQ):
         f_lsh_eq();
         break;
-      case F_MOD: {
+      CASE(F_MOD): {
         CHECK_TYPES(sp - 1, T_NUMBER, 1, instruction);
         CHECK_TYPES(sp, T_NUMBER, 2, instruction);
         if ((sp--)->u.number == 0) {
@@ -4290,10 +4480,10 @@ void eval_instruction(char* p) {
           sp->u.number %= (sp + 1)->u.number;
         }
       } break;
-      case F_MOD_EQ:
+      CASE(F_MOD_EQ):
         f_mod_eq();
         break;
-      case F_MULTIPLY: {
+      CASE(F_MULTIPLY): {
         switch ((sp - 1)->type | sp->type) {
           case T_NUMBER: {
             sp--;
@@ -4336,13 +4526,13 @@ void eval_instruction(char* p) {
           }
         }
       } break;
-      case F_MULT_EQ:
+      CASE(F_MULT_EQ):
         f_mult_eq();
         break;
-      case F_NE:
+      CASE(F_NE):
         f_ne();
         break;
-      case F_NEGATE:
+      CASE(F_NEGATE):
         if (sp->type == T_NUMBER) {
           sp->u.number = -sp->u.number;
           sp->subtype = 0;
@@ -4352,7 +4542,7 @@ void eval_instruction(char* p) {
           error("Bad argument to unary minus\n");
         }
         break;
-      case F_NOT:
+      CASE(F_NOT):
         if (sp->type == T_NUMBER) {
           sp->u.number = !sp->u.number;
           sp->subtype = 0;
@@ -4361,7 +4551,7 @@ void eval_instruction(char* p) {
           *sp = const0;
         }
         break;
-      case F_TEMPLATE_COERCE: {
+      CASE(F_TEMPLATE_COERCE): {
         /* Coerce top-of-stack value to string for template literal
          * interpolation. Strings pass through as-is; ints print in decimal;
          * floats use %g (strips trailing zeros); anything else falls back
@@ -4402,19 +4592,19 @@ void eval_instruction(char* p) {
         }
         break;
       }
-      case F_OR:
+      CASE(F_OR):
         f_or();
         break;
-      case F_OR_EQ:
+      CASE(F_OR_EQ):
         f_or_eq();
         break;
-      case F_PARSE_COMMAND:
+      CASE(F_PARSE_COMMAND):
         f_parse_command();
         break;
-      case F_POP_VALUE:
+      CASE(F_POP_VALUE):
         pop_stack();
         break;
-      case F_POST_DEC:
+      CASE(F_POST_DEC):
         if (sp->type != T_LVALUE) error("Invalid Program: non-lvalue argument to --.");
         lval = sp->u.lvalue;
         switch (lval->type) {
@@ -4466,7 +4656,7 @@ void eval_instruction(char* p) {
             error("-- of non-numeric argument\n");
         }
         break;
-      case F_POST_INC:
+      CASE(F_POST_INC):
         if (sp->type != T_LVALUE) error("Invalid Program: non-lvalue argument to ++.");
         lval = sp->u.lvalue;
         switch (lval->type) {
@@ -4518,7 +4708,7 @@ void eval_instruction(char* p) {
             error("++ of non-numeric argument\n");
         }
         break;
-      case F_GLOBAL_LVALUE: {
+      CASE(F_GLOBAL_LVALUE): {
         unsigned short idx = 0;
         LOAD2(idx, pc);
         STACK_INC;
@@ -4526,25 +4716,25 @@ void eval_instruction(char* p) {
         sp->u.lvalue = find_value(idx + variable_index_offset);
         break;
       }
-      case F_INDEX_LVALUE:
+      CASE(F_INDEX_LVALUE):
         push_indexed_lvalue(0);
         break;
-      case F_RINDEX_LVALUE:
+      CASE(F_RINDEX_LVALUE):
         push_indexed_lvalue(1);
         break;
-      case F_NN_RANGE_LVALUE:
+      CASE(F_NN_RANGE_LVALUE):
         push_lvalue_range(0x00);
         break;
-      case F_RN_RANGE_LVALUE:
+      CASE(F_RN_RANGE_LVALUE):
         push_lvalue_range(0x10);
         break;
-      case F_RR_RANGE_LVALUE:
+      CASE(F_RR_RANGE_LVALUE):
         push_lvalue_range(0x11);
         break;
-      case F_NR_RANGE_LVALUE:
+      CASE(F_NR_RANGE_LVALUE):
         push_lvalue_range(0x01);
         break;
-      case F_MAP_INDEX_OPTIONAL: {
+      CASE(F_MAP_INDEX_OPTIONAL): {
         if (sp->type != T_MAPPING) {
           free_svalue(sp, "F_MAP_INDEX_OPTIONAL");
           free_svalue(sp - 1, "F_MAP_INDEX_OPTIONAL");
@@ -4561,25 +4751,25 @@ void eval_instruction(char* p) {
         free_mapping(m);
         break;
       }
-      case F_NN_RANGE:
+      CASE(F_NN_RANGE):
         f_range(0x00);
         break;
-      case F_RN_RANGE:
+      CASE(F_RN_RANGE):
         f_range(0x10);
         break;
-      case F_NR_RANGE:
+      CASE(F_NR_RANGE):
         f_range(0x01);
         break;
-      case F_RR_RANGE:
+      CASE(F_RR_RANGE):
         f_range(0x11);
         break;
-      case F_NE_RANGE:
+      CASE(F_NE_RANGE):
         f_extract_range(0);
         break;
-      case F_RE_RANGE:
+      CASE(F_RE_RANGE):
         f_extract_range(1);
         break;
-      case F_RETURN_ZERO: {
+      CASE(F_RETURN_ZERO): {
         if (csp->framekind & FRAME_CATCH) {
           free_svalue(&catch_value, "F_RETURN_ZERO");
           catch_value = const0;
@@ -4603,7 +4793,7 @@ void eval_instruction(char* p) {
           return;
         }
       } break;
-      case F_RETURN: {
+      CASE(F_RETURN): {
         svalue_t sv;
 
         if (csp->framekind & FRAME_CATCH) {
@@ -4633,27 +4823,27 @@ void eval_instruction(char* p) {
         }
         break;
       }
-      case F_RSH:
+      CASE(F_RSH):
         f_rsh();
         break;
-      case F_RSH_EQ:
+      CASE(F_RSH_EQ):
         f_rsh_eq();
         break;
-      case F_SSCANF:
+      CASE(F_SSCANF):
         f_sscanf();
         break;
-      case F_STRING:
+      CASE(F_STRING):
         LOAD_SHORT(offset, pc);
         if (offset >= current_prog->num_strings)
           error("Invalid Program: string %d out of range in F_STRING!", offset);
         push_shared_string(current_prog->strings[offset]);
         break;
-      case F_SHORT_STRING:
+      CASE(F_SHORT_STRING):
         if (EXTRACT_UCHAR(pc) >= current_prog->num_strings)
           error("Invalid Program: string %d out of range in F_STRING!", EXTRACT_UCHAR(pc));
         push_shared_string(current_prog->strings[EXTRACT_UCHAR(pc++)]);
         break;
-      case F_SUBTRACT: {
+      CASE(F_SUBTRACT): {
         i = (sp--)->type;
         switch (i | sp->type) {
           case T_NUMBER:
@@ -4693,28 +4883,29 @@ void eval_instruction(char* p) {
         }
         break;
       }
-      case F_SUB_EQ:
+      CASE(F_SUB_EQ):
         f_sub_eq();
         break;
-      case F_SIMUL_EFUN: {
+      CASE(F_SIMUL_EFUN): {
         unsigned short sindex;
         int num_args;
 
+        EVAL_CHECKPOINT();
         LOAD_SHORT(sindex, pc);
         num_args = EXTRACT_UCHAR(pc++) + num_varargs;
         num_varargs = 0;
         call_simul_efun(sindex, num_args);
       } break;
-      case F_SWITCH:
+      CASE(F_SWITCH):
         f_switch();
         break;
-      case F_XOR:
+      CASE(F_XOR):
         f_xor();
         break;
-      case F_XOR_EQ:
+      CASE(F_XOR_EQ):
         f_xor_eq();
         break;
-      case F_CATCH: {
+      CASE(F_CATCH): {
         /*
          * Compute address of next instruction after the CATCH
          * statement.
@@ -4730,7 +4921,7 @@ void eval_instruction(char* p) {
 
         break;
       }
-      case F_END_CATCH: {
+      CASE(F_END_CATCH): {
         free_svalue(&catch_value, "F_END_CATCH");
         catch_value = const0;
         /* We come here when no longjmp() was executed */
@@ -4738,7 +4929,7 @@ void eval_instruction(char* p) {
         push_number(0);
         return; /* return to do_catch */
       }
-      case F_TIME_EXPRESSION: {
+      CASE(F_TIME_EXPRESSION): {
         long sec, usec;
 #ifdef DEBUG
         stack_in_use_as_temporary++;
@@ -4748,7 +4939,7 @@ void eval_instruction(char* p) {
         push_number(usec);
         break;
       }
-      case F_END_TIME_EXPRESSION: {
+      CASE(F_END_TIME_EXPRESSION): {
         long sec, usec;
 
         get_usec_clock(&sec, &usec);
@@ -4760,7 +4951,7 @@ void eval_instruction(char* p) {
         push_number(usec);
         break;
       }
-      case F_TYPE_CHECK: {
+      CASE(F_TYPE_CHECK): {
         int type = sp->u.number;
         pop_stack();
         if (sp->type != type && !(sp->type == T_NUMBER && sp->u.number == 0) &&
@@ -4770,25 +4961,25 @@ void eval_instruction(char* p) {
         break;
       }
 #define CALL_THE_EFUN goto call_the_efun
-      case F_EFUN0:
+      CASE(F_EFUN0):
         st_num_arg = 0;
         LOAD_SHORT(instruction, pc);
         CALL_THE_EFUN;
         break;
-      case F_EFUN1:
+      CASE(F_EFUN1):
         st_num_arg = 1;
         LOAD_SHORT(instruction, pc);
         CHECK_TYPES(sp, instrs[instruction].type[0], 1, instruction);
         CALL_THE_EFUN;
         break;
-      case F_EFUN2:
+      CASE(F_EFUN2):
         st_num_arg = 2;
         LOAD_SHORT(instruction, pc);
         CHECK_TYPES(sp - 1, instrs[instruction].type[0], 1, instruction);
         CHECK_TYPES(sp, instrs[instruction].type[1], 2, instruction);
         CALL_THE_EFUN;
         break;
-      case F_EFUN3:
+      CASE(F_EFUN3):
         st_num_arg = 3;
         LOAD_SHORT(instruction, pc);
         CHECK_TYPES(sp - 2, instrs[instruction].type[0], 1, instruction);
@@ -4796,10 +4987,26 @@ void eval_instruction(char* p) {
         CHECK_TYPES(sp, instrs[instruction].type[2], 3, instruction);
         CALL_THE_EFUN;
         break;
-      case F_EFUNV: {
+      CASE(F_CALL_OTHER_SITE): {
+        unsigned short site;
+        LOAD_SHORT(site, pc);
+        st_num_arg = EXTRACT_UCHAR(pc++) + num_varargs;
+        num_varargs = 0;
+        instruction = F__CALL_OTHER;
+        /* The function name is a constant string; an object (or object
+         * name) target needs no further checking, so the cache can be
+         * handed straight to f__call_other(). */
+        if ((sp - st_num_arg + 1)->type & (T_OBJECT | T_STRING)) {
+          call_other_site = apply_site_cache(current_prog, site);
+          CALL_THE_EFUN;
+        }
+        goto check_efun_args;
+      }
+      CASE(F_EFUNV): {
         LOAD_SHORT(instruction, pc);
         st_num_arg = EXTRACT_UCHAR(pc++) + num_varargs;
         num_varargs = 0;
+      check_efun_args:
 
         if (st_num_arg < instrs[instruction].min_arg) {
           error("Too few arguments to EFUN %s()\n", instrs[instruction].name);
@@ -4830,7 +5037,7 @@ void eval_instruction(char* p) {
         CALL_THE_EFUN;
         break;
       }
-      default:
+      DEFAULT_CASE:
         /* un-recognized instruction */
         if (instruction < EFUN_BASE) {
           fatal("No case for eoperator %s (%d)\n", query_instr_name(instruction), instruction);
@@ -4860,6 +5067,12 @@ void eval_instruction(char* p) {
                                     [&] { return trace_context; });
           (*efun_table[instruction - EFUN_BASE])();
         }
+#ifdef ENABLE_THREADED_DISPATCH
+        /* set_debug_level() may have just turned DBG_LPC on or off; and an
+         * efun that ran LPC has taken its share of the eval limit. */
+        SELECT_DISPATCH();
+        EVAL_CHECKPOINT();
+#endif
 
 #ifdef DEBUG
         if (expected_stack != sp) {
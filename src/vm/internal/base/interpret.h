@@ -129,6 +129,8 @@ extern program_t fake_prog;
 extern svalue_t global_lvalue_byte;
 extern int num_varargs;
 extern int st_num_arg;
+/* Inline cache of the F_CALL_OTHER_SITE being run, for f__call_other() */
+extern apply_site_cache_t* call_other_site;
 
 extern ref_t* global_ref_list;
 extern int lv_owner_type;
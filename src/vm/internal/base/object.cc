@@ -21,6 +21,7 @@ typedef void* gzFile;  // dead parameter slot; compressed-save paths compile out
 
 #include "applies_table.autogen.h"
 #include "base/internal/strutils.h"  // for startsWith, endsWith
+#include "backend.h"                 // for sweep_schedule_object
 #include "comm.h"                    // add_message FIXME: reverse API
 #include "vm/internal/apply.h"
 #include "vm/internal/base/machine.h"
@@ -2142,6 +2143,7 @@ void set_nextreset(object_t* ob) {
   }
   ob->next_reset =
       g_current_gametick + time_to_next_gametick(std::chrono::seconds(time_to_reset_secs));
+  sweep_schedule_object(ob);
 }
 }  // namespace
 
@@ -83,6 +83,8 @@ struct object_t {
   int64_t next_cleanup; /* Explicit clean_up deadline set by set_clean_up();
                            0 = use the idle-time rule (time_of_ref +
                            time_to_clean_up) */
+  uint64_t sweep_due;   /* gametick the reset/clean_up sweep next looks at
+                           this object; 0 = not queued (see backend.cc) */
   program_t* prog;
   uint32_t prog_generation; /* bumped by recompile_object() when prog is swapped
                                on the live object; funptrs snapshot it so
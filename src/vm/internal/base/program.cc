@@ -1,6 +1,7 @@
 #include "base/std.h"
 
 #include "vm/internal/base/machine.h"
+#include "vm/internal/base/apply_cache.h"
 
 void reference_prog(program_t* progp, const char* from) {
   progp->ref++;
@@ -44,10 +45,9 @@ void deallocate_program(program_t* progp) {
     FREE(progp->file_info);
   }
 
-  if (progp->apply_lookup_table != nullptr) {
-    apply_cache_items -= progp->apply_lookup_table->size();
-    progp->apply_lookup_table.reset(nullptr);
-  }
+  free_apply_table(progp);
+  progp->call_site_caches.reset(nullptr);
+  apply_site_generation++;
 
   FREE((char*)progp);
 }
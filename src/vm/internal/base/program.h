@@ -200,6 +200,31 @@ struct lookup_entry_s {
   unsigned short runtime_index;
 };
 
+// Flat open-addressing table behind apply_cache_lookup(). A slot with a
+// null name is empty; there is always at least one.
+struct apply_table_t {
+  struct slot_t {
+    const char* name;
+    lookup_entry_s entry;
+  };
+  unsigned int ref;
+  unsigned int size;  // occupied slots
+  unsigned int mask;  // number of slots - 1, a power of two
+  int shift;          // 64 - log2(number of slots)
+  std::unique_ptr<slot_t[]> slots;
+};
+
+// Inline cache for one call_other() call site with a constant function
+// name, see apply_site_lookup(). Two ways, most recent first; a way is
+// valid while its prog is still the one it was resolved against.
+struct apply_site_cache_t {
+  struct {
+    struct program_t* prog;
+    uint32_t generation;
+    lookup_entry_s entry;
+  } way[2];
+};
+
 struct program_t {
   const char* filename; /* Name of file that defined prog */
   unsigned short flags;
@@ -249,15 +274,15 @@ struct program_t {
   unsigned short num_variables_defined; /* total number of variables defined by this program */
   unsigned short num_inherited;
 
-  // A lookup table to make lookup function by name faster.
-  //
-  // This table is filled on first use, and used by apply_low().
-  //
-  // Key: pointer of function name (must be shared-string)
-  // Value: lookup_entry_s.
-  //
-  typedef std::unordered_map<intptr_t, lookup_entry_s> apply_lookup_table_type;
-  std::unique_ptr<apply_lookup_table_type> apply_lookup_table;
+  // Every function apply_low() can find in this program, keyed by the
+  // shared-string name. Built when the program is loaded, and shared with
+  // an inheriting program that adds no functions; see apply_cache.cc.
+  struct apply_table_t* apply_table;
+
+  // One inline cache per F_CALL_OTHER_SITE instruction in this program,
+  // indexed by its operand. Allocated on first use.
+  unsigned short num_call_sites;
+  std::unique_ptr<apply_site_cache_t[]> call_site_caches;
 };
 
 void reference_prog(program_t*, const char*);
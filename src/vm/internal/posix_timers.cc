@@ -7,10 +7,20 @@
 
 #include <cstdio>   // for perror()
 #include <cstdlib>  // for exit()
+#include <pthread.h>
 #include <sys/signal.h>
+#include <sys/syscall.h>
 #include <time.h>
+#include <unistd.h>
 
 #include "vm/internal/eval_limit.h"
+#include "vm/internal/profiler.h"
+#include "vm/internal/base/interpret.h"
+
+// Older glibc doesn't name the SIGEV_THREAD_ID target field.
+#ifndef sigev_notify_thread_id
+#define sigev_notify_thread_id _sigev_un._tid
+#endif
 
 static timer_t eval_timer_id;
 /*
@@ -84,4 +94,67 @@ uint64_t posix_eval_timer_get(void) {
   return it.it_value.tv_sec * static_cast<uint64_t>(1000000) + it.it_value.tv_nsec / 1000;
 }
 
+static timer_t profile_timer_id;
+static bool profile_timer_created = false;
+/*
+ * SIGPROF handler: ask the interpreter for a sample, if LPC is running.
+ */
+void sigprof_handler(int sig, siginfo_t* si, void* uc) {
+  if (csp >= &control_stack[0]) {
+    profile_sample_due = 1;
+  }
+}
+
+/*
+ * Start (or restart) the profiling timer: every 'micros' of CPU time used by
+ * the calling thread, SIGPROF is sent to that same thread.
+ */
+bool posix_profile_timer_start(uint64_t micros) {
+  if (!profile_timer_created) {
+    struct sigevent sev;
+    struct sigaction sa;
+    clockid_t clock;
+
+    if (pthread_getcpuclockid(pthread_self(), &clock) != 0) {
+      return false;
+    }
+    memset(&sev, 0, sizeof(sev));
+    sev.sigev_signo = SIGPROF;
+    sev.sigev_notify = SIGEV_THREAD_ID;
+    sev.sigev_notify_thread_id = syscall(SYS_gettid);
+    sev.sigev_value.sival_ptr = NULL;
+
+    sa.sa_sigaction = sigprof_handler;
+    sigemptyset(&sa.sa_mask);
+    sa.sa_flags = SA_SIGINFO | SA_RESTART;
+    if (sigaction(SIGPROF, &sa, NULL) < 0) {
+      perror("posix_profile_timer_start: sigaction");
+      return false;
+    }
+    if (timer_create(clock, &sev, &profile_timer_id) < 0) {
+      perror("posix_profile_timer_start: timer_create");
+      return false;
+    }
+    profile_timer_created = true;
+  }
+
+  struct itimerspec it;
+
+  it.it_interval.tv_sec = micros / 1000000;
+  it.it_interval.tv_nsec = micros % 1000000 * 1000;
+  it.it_value = it.it_interval;
+
+  return timer_settime(profile_timer_id, 0, &it, NULL) == 0;
+}
+
+void posix_profile_timer_stop(void) {
+  struct itimerspec it;
+
+  if (!profile_timer_created) {
+    return;
+  }
+  memset(&it, 0, sizeof(it));
+  timer_settime(profile_timer_id, 0, &it, NULL);
+}
+
 #endif  // __linux__
@@ -6,5 +6,7 @@
 void init_posix_timers(void);
 void posix_eval_timer_set(uint64_t micros);
 uint64_t posix_eval_timer_get(void);
+bool posix_profile_timer_start(uint64_t micros);
+void posix_profile_timer_stop(void);
 
 #endif
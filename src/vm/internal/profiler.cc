@@ -0,0 +1,91 @@
+#include "base/std.h"
+
+#include "vm/internal/profiler.h"
+
+#include "vm/internal/base/interpret.h"
+#include "vm/internal/posix_timers.h"
+
+volatile sig_atomic_t profile_sample_due = 0;
+
+namespace {
+
+bool running = false;
+std::unordered_map<std::string, uint64_t> samples;
+
+void append_frame(std::string* stack, const program_t* prog, const char* name) {
+  if (!stack->empty()) {
+    stack->push_back(';');
+  }
+  stack->push_back('/');
+  stack->append(prog->filename);
+  stack->push_back(':');
+  stack->append(name);
+}
+
+}  // namespace
+
+bool profile_start(uint64_t interval_usec) {
+  profile_stop();
+  samples.clear();
+#ifdef __linux__
+  running = posix_profile_timer_start(interval_usec);
+#endif
+  return running;
+}
+
+void profile_stop() {
+#ifdef __linux__
+  if (running) {
+    posix_profile_timer_stop();
+  }
+#endif
+  running = false;
+  profile_sample_due = 0;
+}
+
+bool profile_running() { return running; }
+
+void profile_sample() {
+  profile_sample_due = 0;
+  if (!running || csp < &control_stack[0] || !current_prog) {
+    return;
+  }
+
+  // Same frame walk as dump_trace(): a frame's function runs in the program
+  // saved by the frame above it, or in current_prog for the top one.
+  std::string stack;
+  for (auto* p = &control_stack[0]; p <= csp; p++) {
+    const program_t* prog = p == csp ? current_prog : p[1].prog;
+    switch (p->framekind & FRAME_MASK) {
+      case FRAME_FUNCTION:
+        append_frame(&stack, prog, prog->function_table[p->fr.table_index].funcname);
+        break;
+      case FRAME_FUNP:
+        append_frame(&stack, prog, "<function>");
+        break;
+      case FRAME_CATCH:
+        append_frame(&stack, prog, "<catch>");
+        break;
+      default:
+        break;
+    }
+  }
+  if (stack.empty()) {
+    return;
+  }
+
+  const char* file;
+  int line;
+  get_explicit_line_number_info(pc, current_prog, &file, &line);
+  stack.push_back(':');
+  if (strcmp(file, current_prog->filename) != 0) {
+    stack.push_back('/');
+    stack.append(file);
+    stack.push_back(':');
+  }
+  stack.append(std::to_string(line));
+
+  samples[stack]++;
+}
+
+const std::unordered_map<std::string, uint64_t>& profile_samples() { return samples; }
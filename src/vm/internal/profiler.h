@@ -0,0 +1,33 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <csignal>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+
+/*
+ * Sampling LPC profiler. While it runs, a timer on the driver thread's CPU
+ * clock sets profile_sample_due whenever LPC is on the stack; the interpreter
+ * then calls profile_sample() at its next instruction (or, with threaded
+ * dispatch, its next call or backward branch), which records the LPC call
+ * stack. Samples are aggregated by stack, in the collapsed ("folded") form
+ * flamegraph tools read: "/obj/a:f;/obj/b:g:12", leaf frame with its line.
+ */
+
+// Set by the profiling timer signal, so it must be volatile.
+extern volatile sig_atomic_t profile_sample_due;
+
+// Start sampling every interval_usec of CPU time, dropping earlier samples.
+// Returns false if the platform has no profiling timer.
+bool profile_start(uint64_t interval_usec);
+// Stop sampling; the samples are kept until the next profile_start().
+void profile_stop();
+bool profile_running();
+
+void profile_sample();
+
+// Collapsed stack => number of samples.
+const std::unordered_map<std::string, uint64_t>& profile_samples();
+
+#endif
@@ -0,0 +1,826 @@
+#include "base/std.h"
+
+#include "vm/internal/program_cache.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#ifndef _WIN32
+#include <sys/mman.h>
+#endif
+
+#include "applies_table.autogen.h"
+#include "base/internal/rc.h"
+#include "compiler/internal/compiler.h"
+#include "compiler/internal/lexer.h"
+#include "compiler/internal/lexer_utils.h"
+#include "packages/core/outbuf.h"
+#include "vm/internal/base/apply_cache.h"
+#include "vm/internal/base/machine.h"
+#include "vm/internal/master.h"
+#include "vm/internal/otable.h"
+#include "vm/internal/simul_efun.h"
+#include "vm/internal/simulate.h"
+
+/*
+ * Image layout (all integers native-endian; images are not portable
+ * between builds anyway, see build_fingerprint()):
+ *
+ *   ImageHeader
+ *   payload:
+ *     source      obname, real_name, mtime, size
+ *     includes    count, then (path, mtime, size) each
+ *     master      count, then (apply, args, number mask, digest) for each
+ *                 master apply the compile made
+ *     inherits    count, then (filename, layout signature) each
+ *     scalars     program_t counters and the offset of every array
+ *     pool        count, then every shared string the image refers to
+ *     switches    count, then the bytecode offset of each string switch
+ *     file_info   raw copy of prog->file_info
+ *     data        raw copy of the program block after the program_t
+ *                 header, with each shared-string pointer replaced by its
+ *                 pool index + 1 (0 for nullptr), each string switch key
+ *                 by its prog->strings index + 1, and inherit[].prog
+ *                 zeroed.
+ */
+
+namespace {
+
+constexpr char kMagic[8] = {'F', 'L', 'U', 'F', 'F', 'P', 'C', '\0'};
+constexpr uint32_t kFormatVersion = 2;
+constexpr uint32_t kNoOffset = UINT32_MAX;
+// See f_switch(): one case is an LPC_INT key followed by a short address.
+constexpr int kSwitchCaseSize = sizeof(LPC_INT) + sizeof(short);
+
+struct ImageHeader {
+  char magic[8];
+  uint32_t version;
+  uint32_t reserved;
+  uint64_t build;
+  uint64_t env;
+  uint64_t payload_size;
+  uint64_t payload_hash;
+};
+
+program_cache_stats_t stats;
+
+struct Fnv64 {
+  uint64_t h = 14695981039346656037ULL;
+
+  void bytes(const void* p, size_t n) {
+    auto const* c = static_cast<const unsigned char*>(p);
+    for (size_t i = 0; i < n; i++) {
+      h ^= c[i];
+      h *= 1099511628211ULL;
+    }
+  }
+  template <typename T>
+  void num(T v) {
+    auto x = static_cast<uint64_t>(v);
+    bytes(&x, sizeof x);
+  }
+  void str(const char* s) {
+    if (!s) {
+      num(UINT64_MAX);
+      return;
+    }
+    size_t const n = strlen(s);
+    num(n);
+    bytes(s, n);
+  }
+};
+
+class Writer {
+ public:
+  std::string buf;
+
+  void raw(const void* p, size_t n) { buf.append(static_cast<const char*>(p), n); }
+  template <typename T>
+  void num(T v) {
+    raw(&v, sizeof v);
+  }
+  void str(std::string_view s) {
+    num(static_cast<uint32_t>(s.size()));
+    raw(s.data(), s.size());
+  }
+};
+
+class Reader {
+ public:
+  Reader(const char* p, size_t n) : p_(p), end_(p + n) {}
+
+  bool ok() const { return ok_; }
+  bool at_end() const { return p_ == end_; }
+
+  const char* raw(size_t n) {
+    if (!ok_ || static_cast<size_t>(end_ - p_) < n) {
+      ok_ = false;
+      return nullptr;
+    }
+    const char* r = p_;
+    p_ += n;
+    return r;
+  }
+  template <typename T>
+  T num() {
+    T v{};
+    if (const char* r = raw(sizeof v)) {
+      memcpy(&v, r, sizeof v);
+    }
+    return v;
+  }
+  std::string_view str() {
+    auto const n = num<uint32_t>();
+    const char* r = raw(n);
+    return r ? std::string_view(r, n) : std::string_view();
+  }
+
+ private:
+  const char* p_;
+  const char* end_;
+  bool ok_ = true;
+};
+
+// Read-only view of a whole image file.
+class MappedFile {
+ public:
+  MappedFile() = default;
+  MappedFile(const MappedFile&) = delete;
+  MappedFile& operator=(const MappedFile&) = delete;
+  ~MappedFile() {
+#ifndef _WIN32
+    if (data_) munmap(const_cast<char*>(data_), size_);
+#endif
+  }
+
+  bool open(const std::string& path) {
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd == -1) return false;
+    DEFER { close(fd); };
+    struct stat st;
+    if (fstat(fd, &st) == -1 || st.st_size <= 0) return false;
+    size_ = st.st_size;
+#ifndef _WIN32
+    void* p = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (p == MAP_FAILED) return false;
+    data_ = static_cast<const char*>(p);
+#else
+    _setmode(fd, _O_BINARY);
+    copy_.resize(size_);
+    if (read(fd, copy_.data(), size_) != static_cast<ssize_t>(size_)) return false;
+    data_ = copy_.data();
+#endif
+    return true;
+  }
+
+  const char* data() const { return data_; }
+  size_t size() const { return size_; }
+
+ private:
+  const char* data_ = nullptr;
+  size_t size_ = 0;
+#ifdef _WIN32
+  std::string copy_;
+#endif
+};
+
+uint64_t file_stamp(const struct stat& st) {
+#if defined(__APPLE__)
+  return static_cast<uint64_t>(st.st_mtimespec.tv_sec) * 1000000000ULL + st.st_mtimespec.tv_nsec;
+#elif defined(_WIN32)
+  return static_cast<uint64_t>(st.st_mtime) * 1000000000ULL;
+#else
+  return static_cast<uint64_t>(st.st_mtim.tv_sec) * 1000000000ULL + st.st_mtim.tv_nsec;
+#endif
+}
+
+const char* disk_path(const char* path) {
+  while (*path == '/') path++;
+  return path;
+}
+
+// Everything about the driver binary an image bakes in.
+uint64_t build_fingerprint() {
+  static const uint64_t fp = [] {
+    Fnv64 h;
+    h.str(PROJECT_VERSION);
+    h.num(kFormatVersion);
+    for (size_t n : {sizeof(program_t), sizeof(function_t), sizeof(inherit_t), sizeof(class_def_t),
+                     sizeof(class_member_entry_t), sizeof(LPC_INT), sizeof(LPC_FLOAT),
+                     sizeof(ADDRESS_TYPE), sizeof(void*)}) {
+      h.num(n);
+    }
+    for (int i = 0; i < MAX_INSTRS; i++) {
+      const instr_t& in = instrs[i];
+      h.str(in.name);
+      h.num(in.min_arg);
+      h.num(in.max_arg);
+      h.num(in.ret_type);
+      h.num(in.Default);
+      for (short t : in.type) h.num(t);
+    }
+    for (int i = 0; i < NUM_MASTER_APPLIES; i++) {
+      h.str(applies_table[i]);
+    }
+    return h.h;
+  }();
+  return fp;
+}
+
+// Function/variable/class tables as seen by a program that inherits (or,
+// for the simul_efun object, calls into) `prog`. Two programs with equal
+// signatures are interchangeable as far as compiled code referring to
+// them is concerned.
+uint64_t layout_signature(program_t* prog) {
+  Fnv64 h;
+  h.str(prog->filename);
+  h.num(prog->last_inherited);
+  h.num(prog->num_functions_defined);
+  int const num_funcs = prog->last_inherited + prog->num_functions_defined;
+  for (int i = 0; i < num_funcs; i++) {
+    h.num(prog->function_flags[i]);
+    if (prog->function_flags[i] & FUNC_ALIAS) continue;
+    function_t* fun = find_func_entry(prog, i);
+    h.str(fun->funcname);
+    h.num(fun->type);
+    h.num(fun->num_arg);
+    h.num(fun->min_arg);
+    h.num(fun->num_local);
+    h.bytes(fun->default_args_findex, sizeof fun->default_args_findex);
+  }
+  h.num(prog->num_variables_total);
+  for (int i = 0; i < prog->num_variables_total; i++) {
+    h.str(variable_name(prog, i));
+  }
+  h.bytes(prog->variable_types, prog->num_variables_defined * sizeof(unsigned short));
+  h.num(prog->num_classes);
+  for (int i = 0; i < prog->num_classes; i++) {
+    const class_def_t& cd = prog->classes[i];
+    h.str(prog->strings[cd.classname]);
+    h.num(cd.type);
+    h.num(cd.size);
+    for (int j = 0; j < cd.size; j++) {
+      const class_member_entry_t& cm = prog->class_members[cd.index + j];
+      h.str(prog->strings[cm.membername]);
+      h.num(cm.type);
+    }
+  }
+  h.num(prog->num_inherited);
+  for (int i = 0; i < prog->num_inherited; i++) {
+    const inherit_t& inh = prog->inherit[i];
+    h.num(inh.function_index_offset);
+    h.num(inh.variable_index_offset);
+    h.num(inh.type_mod);
+  }
+  if (prog->type_start) {
+    for (int i = 0; i < prog->num_functions_defined; i++) {
+      h.num(prog->type_start[i]);
+      if (prog->type_start[i] == INDEX_START_NONE) continue;
+      function_t* fun = &prog->function_table[i];
+      h.bytes(&prog->argument_types[prog->type_start[i]], fun->num_arg * sizeof(unsigned short));
+    }
+  }
+  return h.h;
+}
+
+// Everything outside the source files a compile depends on.
+uint64_t env_fingerprint() {
+  static unsigned predef_version = ~0U;
+  static uint64_t predef_hash;
+  if (predef_version != get_predefines_version()) {
+    const auto& predefs = get_predefines();
+    std::vector<const std::pair<const std::string, PredefMacro>*> sorted;
+    sorted.reserve(predefs.size());
+    for (const auto& kv : predefs) sorted.push_back(&kv);
+    std::sort(sorted.begin(), sorted.end(), [](auto* a, auto* b) { return a->first < b->first; });
+    Fnv64 h;
+    for (auto* kv : sorted) {
+      h.str(kv->first.c_str());
+      h.num(kv->second.is_function_like);
+      h.num(kv->second.nargs);
+      h.str(kv->second.body.c_str());
+    }
+    predef_hash = h.h;
+    predef_version = get_predefines_version();
+  }
+
+  Fnv64 h;
+  h.num(predef_hash);
+  h.str(CONFIG_STR(__INCLUDE_DIRS__));
+  h.str(CONFIG_STR(__GLOBAL_INCLUDE_FILE__));
+  h.bytes(config_int, sizeof config_int);
+  h.num(DEFAULT_PRAGMAS);
+  auto slots = simul_efun_slot_names();
+  for (size_t i = 0; i < slots.size(); i++) {
+    h.str(slots[i]);
+    h.num(simuls[i].func != nullptr);
+  }
+  if (simul_efun_ob && simul_efun_ob->prog) {
+    h.num(layout_signature(simul_efun_ob->prog));
+  }
+  return h.h;
+}
+
+const char* cache_dir() { return CONFIG_STR(__RC_PROGRAM_CACHE_DIR__); }
+
+// "/std/room.c" -> "<dir>/std%room.c.pc"; '%' is doubled so the mapping
+// stays one-to-one.
+std::string image_path(const char* obname) {
+  std::string path(cache_dir());
+  path += '/';
+  for (const char* p = disk_path(obname); *p; p++) {
+    if (*p == '/') {
+      path += '%';
+    } else {
+      if (*p == '%') path += '%';
+      path += *p;
+    }
+  }
+  path += ".pc";
+  return path;
+}
+
+int string_index(program_t* prog, const char* s) {
+  for (int i = 0; i < prog->num_strings; i++) {
+    if (prog->strings[i] == s) return i;
+  }
+  return -1;
+}
+
+bool encode_image(program_t* prog, const char* real_name, const struct stat& src_st, Writer* w) {
+  w->str(prog->filename);
+  w->str(real_name);
+  w->num(file_stamp(src_st));
+  w->num(static_cast<uint64_t>(src_st.st_size));
+
+  w->num(static_cast<uint32_t>(g_compile.includes.size()));
+  for (const auto& inc : g_compile.includes) {
+    struct stat st;
+    if (stat(disk_path(inc.c_str()), &st) == -1) return false;
+    w->str(inc);
+    w->num(file_stamp(st));
+    w->num(static_cast<uint64_t>(st.st_size));
+  }
+
+  w->num(static_cast<uint32_t>(g_compile.master_calls.size()));
+  for (const auto& call : g_compile.master_calls) {
+    if (!call.result) return false;
+    w->num(call.apply);
+    w->num(static_cast<uint32_t>(call.args.size()));
+    for (const auto& arg : call.args) w->str(arg);
+    w->num(call.number_args);
+    w->num(call.result);
+  }
+
+  w->num(static_cast<uint32_t>(prog->num_inherited));
+  for (int i = 0; i < prog->num_inherited; i++) {
+    program_t* inh = prog->inherit[i].prog;
+    // An inherit the master supplied inline can't be reloaded from disk.
+    struct stat st;
+    if (stat(disk_path(inh->filename), &st) == -1) return false;
+    w->str(inh->filename);
+    w->num(layout_signature(inh));
+  }
+
+  char* base = reinterpret_cast<char*>(prog);
+  auto offset_of = [base](const void* p) {
+    return p ? static_cast<uint32_t>(static_cast<const char*>(p) - base) : kNoOffset;
+  };
+  uint32_t const data_start = offset_of(prog->program);
+  w->num(static_cast<uint32_t>(prog->total_size));
+  w->num(prog->flags);
+  w->num(prog->last_inherited);
+  w->num(prog->heart_beat);
+  w->num(prog->program_size);
+  w->num(prog->num_classes);
+  w->num(prog->num_functions_defined);
+  w->num(prog->num_strings);
+  w->num(prog->num_variables_total);
+  w->num(prog->num_variables_defined);
+  w->num(prog->num_inherited);
+  w->num(prog->num_call_sites);
+  const void* const arrays[] = {prog->program,        prog->function_table, prog->function_flags,
+                                prog->classes,        prog->class_members,  prog->strings,
+                                prog->variable_table, prog->variable_types, prog->inherit,
+                                prog->argument_types, prog->type_start};
+  for (const void* p : arrays) {
+    w->num(offset_of(p));
+  }
+
+  std::string data(prog->program, prog->total_size - data_start);
+  std::vector<const char*> pool;
+  std::unordered_map<const char*, uintptr_t> pool_index;
+  auto put = [&](const void* field, uintptr_t v) {
+    memcpy(&data[static_cast<const char*>(field) - base - data_start], &v, sizeof v);
+  };
+  auto intern = [&](const void* field, const char* s) {
+    uintptr_t id = 0;
+    if (s) {
+      auto it = pool_index.find(s);
+      if (it == pool_index.end()) {
+        pool.push_back(s);
+        it = pool_index.emplace(s, pool.size()).first;
+      }
+      id = it->second;
+    }
+    put(field, id);
+  };
+  for (int i = 0; i < prog->num_functions_defined; i++) {
+    intern(&prog->function_table[i].funcname, prog->function_table[i].funcname);
+  }
+  for (int i = 0; i < prog->num_strings; i++) {
+    intern(&prog->strings[i], prog->strings[i]);
+  }
+  for (int i = 0; i < prog->num_variables_defined; i++) {
+    intern(&prog->variable_table[i], prog->variable_table[i]);
+  }
+  for (int i = 0; i < prog->num_inherited; i++) {
+    put(&prog->inherit[i].prog, 0);
+  }
+
+  std::vector<uint32_t> switches = g_compile.string_switch_tables;
+  std::sort(switches.begin(), switches.end());
+  switches.erase(std::unique(switches.begin(), switches.end()), switches.end());
+  for (uint32_t addr : switches) {
+    char* pc = prog->program + addr;
+    if (addr + 7 > prog->program_size || (pc[0] & 0x0f) != 0x0f || (pc[0] & 0xf0) == 0xf0) {
+      return false;
+    }
+    unsigned short table, end;
+    COPY_SHORT(&table, pc + 1);
+    COPY_SHORT(&end, pc + 3);
+    for (char* e = pc + table; e < pc + end; e += kSwitchCaseSize) {
+      LPC_INT key;
+      COPY_INT(&key, e);
+      LPC_INT id = 0;
+      if (key) {
+        int idx = string_index(prog, reinterpret_cast<const char*>(static_cast<POINTER_INT>(key)));
+        if (idx < 0) return false;
+        id = idx + 1;
+      }
+      memcpy(&data[e - base - data_start], &id, sizeof id);
+    }
+  }
+
+  w->num(static_cast<uint32_t>(pool.size()));
+  for (const char* s : pool) w->str(s);
+  w->num(static_cast<uint32_t>(switches.size()));
+  for (uint32_t addr : switches) w->num(addr);
+  w->num(static_cast<uint32_t>(prog->file_info[0]));
+  w->raw(prog->file_info, prog->file_info[0]);
+  w->num(static_cast<uint32_t>(data.size()));
+  w->raw(data.data(), data.size());
+  return true;
+}
+
+bool write_image(const std::string& path, const std::string& payload) {
+  ImageHeader hdr{};
+  memcpy(hdr.magic, kMagic, sizeof kMagic);
+  hdr.version = kFormatVersion;
+  hdr.build = build_fingerprint();
+  hdr.env = env_fingerprint();
+  hdr.payload_size = payload.size();
+  Fnv64 h;
+  h.bytes(payload.data(), payload.size());
+  hdr.payload_hash = h.h;
+
+  std::string tmp = path + ".tmp";
+  int fd = open(tmp.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if (fd == -1 && errno == ENOENT) {
+    mkdir(cache_dir(), 0755);
+    fd = open(tmp.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  }
+  if (fd == -1) return false;
+#ifdef _WIN32
+  _setmode(fd, _O_BINARY);
+#endif
+  bool ok = write(fd, &hdr, sizeof hdr) == static_cast<ssize_t>(sizeof hdr) &&
+            write(fd, payload.data(), payload.size()) == static_cast<ssize_t>(payload.size());
+  ok = (close(fd) == 0) && ok;
+  if (ok && rename(tmp.c_str(), path.c_str()) == 0) {
+    stats.bytes_written += sizeof hdr + payload.size();
+    return true;
+  }
+  unlink(tmp.c_str());
+  return false;
+}
+
+bool check_dep(Reader* r, const char* path) {
+  auto const stamp = r->num<uint64_t>();
+  auto const size = r->num<uint64_t>();
+  struct stat st;
+  return r->ok() && stat(path, &st) != -1 && file_stamp(st) == stamp &&
+         static_cast<uint64_t>(st.st_size) == size;
+}
+
+// Rebuild a program from an image. Every check that can fail happens
+// before anything is allocated, so a stale image costs no cleanup.
+program_t* decode_image(const MappedFile& file, const char* real_name, const char* obname,
+                        const struct stat& src_st) {
+  if (file.size() < sizeof(ImageHeader)) return nullptr;
+  ImageHeader hdr;
+  memcpy(&hdr, file.data(), sizeof hdr);
+  if (memcmp(hdr.magic, kMagic, sizeof kMagic) != 0 || hdr.version != kFormatVersion ||
+      hdr.build != build_fingerprint() || hdr.env != env_fingerprint() ||
+      hdr.payload_size != file.size() - sizeof hdr) {
+    return nullptr;
+  }
+  const char* payload = file.data() + sizeof hdr;
+  Fnv64 h;
+  h.bytes(payload, hdr.payload_size);
+  if (h.h != hdr.payload_hash) return nullptr;
+
+  Reader r(payload, hdr.payload_size);
+  if (r.str() != obname || r.str() != real_name) return nullptr;
+  if (r.num<uint64_t>() != file_stamp(src_st) ||
+      r.num<uint64_t>() != static_cast<uint64_t>(src_st.st_size)) {
+    return nullptr;
+  }
+  for (auto n = r.num<uint32_t>(); r.ok() && n; n--) {
+    std::string inc(r.str());
+    if (!check_dep(&r, disk_path(inc.c_str()))) return nullptr;
+  }
+
+  // The master has to answer every compile-time apply the way it did for
+  // the compile: a hook may now redirect or deny an #include or inherit.
+  for (auto n = r.num<uint32_t>(); r.ok() && n; n--) {
+    auto const apply = r.num<int>();
+    std::vector<std::string> args(r.num<uint32_t>());
+    for (auto& arg : args) arg = std::string(r.str());
+    auto const number_args = r.num<unsigned>();
+    auto const result = r.num<uint64_t>();
+    if (!r.ok() || apply < 0 || apply >= NUM_MASTER_APPLIES) return nullptr;
+    for (size_t i = 0; i < args.size(); i++) {
+      if (number_args & (1U << i)) {
+        push_number(std::strtoll(args[i].c_str(), nullptr, 10));
+      } else {
+        copy_and_push_string(args[i].c_str());
+      }
+    }
+    if (program_cache_digest(safe_apply_master_ob(apply, args.size())) != result) {
+      return nullptr;
+    }
+  }
+
+  // Inherited programs have to be loaded before their layout can be
+  // compared; this is the one step that can run LPC code.
+  auto const num_inherits = r.num<uint32_t>();
+  std::vector<program_t*> inherits;
+  for (uint32_t i = 0; r.ok() && i < num_inherits; i++) {
+    std::string filename(r.str());
+    auto const sig = r.num<uint64_t>();
+    char inhname[MAX_OBJECT_NAME_SIZE];
+    if (!r.ok() || !filename_to_obname(filename.c_str(), inhname, sizeof inhname)) return nullptr;
+    object_t* inh_obj = ObjectTable::instance().find(inhname);
+    if (!inh_obj) {
+      compiler_next_load_reason = std::string("while loading '/") + inhname +
+                                  "' inherited by '/" + disk_path(obname) + "'";
+      inh_obj = load_object(filename.c_str(), 1);
+    }
+    if (!inh_obj || !inh_obj->prog || filename != inh_obj->prog->filename ||
+        layout_signature(inh_obj->prog) != sig) {
+      return nullptr;
+    }
+    inherits.push_back(inh_obj->prog);
+  }
+
+  auto const total_size = r.num<uint32_t>();
+  program_t scalars;
+  scalars.flags = r.num<unsigned short>();
+  scalars.last_inherited = r.num<unsigned short>();
+  scalars.heart_beat = r.num<unsigned short>();
+  scalars.program_size = r.num<unsigned short>();
+  scalars.num_classes = r.num<unsigned short>();
+  scalars.num_functions_defined = r.num<unsigned short>();
+  scalars.num_strings = r.num<unsigned short>();
+  scalars.num_variables_total = r.num<unsigned short>();
+  scalars.num_variables_defined = r.num<unsigned short>();
+  scalars.num_inherited = r.num<unsigned short>();
+  scalars.num_call_sites = r.num<unsigned short>();
+  uint32_t offsets[11];
+  for (auto& off : offsets) {
+    off = r.num<uint32_t>();
+    if (off != kNoOffset && off > total_size) return nullptr;
+  }
+  if (scalars.num_inherited != inherits.size() || offsets[0] == kNoOffset ||
+      offsets[0] < sizeof(program_t)) {
+    return nullptr;
+  }
+
+  std::vector<std::string_view> pool(r.num<uint32_t>());
+  for (auto& s : pool) s = r.str();
+  std::vector<uint32_t> switches(r.num<uint32_t>());
+  for (auto& addr : switches) addr = r.num<uint32_t>();
+  auto const file_info_size = r.num<uint32_t>();
+  const char* file_info = r.raw(file_info_size);
+  auto const data_size = r.num<uint32_t>();
+  const char* data = r.raw(data_size);
+  if (!r.ok() || !r.at_end() || data_size != total_size - offsets[0] ||
+      file_info_size < 2 * sizeof(unsigned short)) {
+    return nullptr;
+  }
+
+  char* p = reinterpret_cast<char*>(DMALLOC(total_size, TAG_PROGRAM, "program_cache_load"));
+  auto* prog = new (p) program_t;
+  memcpy(p + offsets[0], data, data_size);
+  auto at = [p, &offsets](int i) { return offsets[i] == kNoOffset ? nullptr : p + offsets[i]; };
+  prog->filename = make_shared_string(obname);
+  prog->flags = scalars.flags;
+  prog->last_inherited = scalars.last_inherited;
+  prog->ref = 0;
+  prog->func_ref = 0;
+  prog->program = at(0);
+  prog->function_table = reinterpret_cast<function_t*>(at(1));
+  prog->function_flags = reinterpret_cast<unsigned short*>(at(2));
+  prog->classes = reinterpret_cast<class_def_t*>(at(3));
+  prog->class_members = reinterpret_cast<class_member_entry_t*>(at(4));
+  prog->strings = reinterpret_cast<char**>(at(5));
+  prog->variable_table = reinterpret_cast<char**>(at(6));
+  prog->variable_types = reinterpret_cast<unsigned short*>(at(7));
+  prog->inherit = reinterpret_cast<inherit_t*>(at(8));
+  prog->argument_types = reinterpret_cast<unsigned short*>(at(9));
+  prog->type_start = reinterpret_cast<unsigned short*>(at(10));
+  prog->total_size = total_size;
+  prog->heart_beat = scalars.heart_beat;
+  prog->program_size = scalars.program_size;
+  prog->num_classes = scalars.num_classes;
+  prog->num_functions_defined = scalars.num_functions_defined;
+  prog->num_strings = scalars.num_strings;
+  prog->num_variables_total = scalars.num_variables_total;
+  prog->num_variables_defined = scalars.num_variables_defined;
+  prog->num_inherited = scalars.num_inherited;
+  prog->num_call_sites = scalars.num_call_sites;
+  prog->line_swap_index = 0;
+  prog->apply_table = nullptr;
+
+  // Each slot gets its own reference, just as the compiler hands them out.
+  auto resolve = [&pool](auto* slot) {
+    uintptr_t id;
+    memcpy(&id, slot, sizeof id);
+    const char* s = id ? make_shared_string(std::string(pool[id - 1]).c_str()) : nullptr;
+    *slot = const_cast<char*>(s);
+  };
+  for (int i = 0; i < prog->num_functions_defined; i++) {
+    resolve(&prog->function_table[i].funcname);
+  }
+  for (int i = 0; i < prog->num_strings; i++) resolve(&prog->strings[i]);
+  for (int i = 0; i < prog->num_variables_defined; i++) resolve(&prog->variable_table[i]);
+
+  // String switch keys are shared-string addresses, so the table has to
+  // be re-keyed and re-sorted for this process's string pool.
+  for (uint32_t addr : switches) {
+    char* pc = prog->program + addr;
+    unsigned short table, end;
+    COPY_SHORT(&table, pc + 1);
+    COPY_SHORT(&end, pc + 3);
+    struct Case {
+      LPC_INT key;
+      char addr[sizeof(short)];
+    };
+    std::vector<Case> cases;
+    for (char* e = pc + table; e < pc + end; e += kSwitchCaseSize) {
+      Case c;
+      COPY_INT(&c.key, e);
+      if (c.key) c.key = reinterpret_cast<POINTER_INT>(prog->strings[c.key - 1]);
+      memcpy(c.addr, e + sizeof(LPC_INT), sizeof c.addr);
+      cases.push_back(c);
+    }
+    std::stable_sort(cases.begin(), cases.end(),
+                     [](const Case& a, const Case& b) { return a.key < b.key; });
+    char* e = pc + table;
+    for (const Case& c : cases) {
+      memcpy(e, &c.key, sizeof c.key);
+      memcpy(e + sizeof(LPC_INT), c.addr, sizeof c.addr);
+      e += kSwitchCaseSize;
+    }
+  }
+
+  prog->file_info =
+      reinterpret_cast<unsigned short*>(DMALLOC(file_info_size, TAG_LINENUMBERS, "program_cache_load"));
+  memcpy(prog->file_info, file_info, file_info_size);
+  prog->line_info = reinterpret_cast<unsigned char*>(&prog->file_info[prog->file_info[1]]);
+
+  total_num_prog_blocks++;
+  total_prog_block_size += total_size;
+  reference_prog(prog, "program_cache_load");
+  for (int i = 0; i < prog->num_inherited; i++) {
+    prog->inherit[i].prog = inherits[i];
+    reference_prog(inherits[i], "inheritance");
+  }
+  build_apply_table(prog);
+  return prog;
+}
+
+}  // namespace
+
+uint64_t program_cache_digest(svalue_t* ret) {
+  Fnv64 h;
+  if (ret == reinterpret_cast<svalue_t*>(-1)) {
+    h.num(-1);
+    return h.h;
+  }
+  if (!ret) {
+    h.num(-2);
+    return h.h;
+  }
+  std::vector<svalue_t*> todo{ret};
+  while (!todo.empty()) {
+    svalue_t* v = todo.back();
+    todo.pop_back();
+    h.num(v->type);
+    switch (v->type) {
+      case T_NUMBER:
+        h.num(v->u.number);
+        break;
+      case T_REAL:
+        h.bytes(&v->u.real, sizeof v->u.real);
+        break;
+      case T_STRING:
+        h.str(v->u.string);
+        break;
+      case T_ARRAY:
+        h.num(v->u.arr->size);
+        for (int i = v->u.arr->size - 1; i >= 0; i--) todo.push_back(&v->u.arr->item[i]);
+        break;
+      default:
+        // Objects, mappings, functions: no stable identity to compare.
+        return 0;
+    }
+  }
+  return h.h ? h.h : 1;
+}
+
+bool program_cache_enabled() {
+  const char* dir = cache_dir();
+  return dir && *dir;
+}
+
+program_t* program_cache_load(const char* real_name, const char* obname,
+                              const struct stat& src_st) {
+  if (!program_cache_enabled()) return nullptr;
+  MappedFile file;
+  if (!file.open(image_path(obname))) {
+    stats.misses++;
+    return nullptr;
+  }
+  program_t* prog = decode_image(file, real_name, obname, src_st);
+  if (!prog) {
+    stats.stale++;
+    return nullptr;
+  }
+  stats.hits++;
+  stats.bytes_read += file.size();
+  return prog;
+}
+
+void program_cache_save(program_t* prog, const char* real_name, const struct stat& src_st) {
+  if (!program_cache_enabled()) return;
+  if (!g_compile.save_binary) {
+    stats.save_skips++;
+    return;
+  }
+  push_malloced_string(add_slash(prog->filename));
+  svalue_t* ret = safe_apply_master_ob(APPLY_VALID_SAVE_BINARY, 1);
+  if (ret && !MASTER_APPROVED(ret)) {
+    stats.save_skips++;
+    return;
+  }
+  Writer w;
+  if (!encode_image(prog, real_name, src_st, &w)) {
+    stats.save_skips++;
+    return;
+  }
+  if (!write_image(image_path(prog->filename), w.buf)) {
+    debug_message("program cache: could not write image for /%s: %s\n", prog->filename,
+                  strerror(errno));
+    return;
+  }
+  stats.saves++;
+}
+
+const program_cache_stats_t& program_cache_stats() { return stats; }
+
+uint64_t program_cache_status(outbuffer_t* out, int verbose) {
+  if (!program_cache_enabled() || verbose == -1) return 0;
+  if (verbose == 1) {
+    outbuf_add(out, "Program cache:\n");
+    outbuf_add(out, "-------------------------\n");
+    outbuf_addv(out,
+                "Directory:\t\t%s\nHits:\t\t\t%" PRIu64 "\nMisses:\t\t\t%" PRIu64
+                "\nStale:\t\t\t%" PRIu64 "\nSaves:\t\t\t%" PRIu64 "\nNot saved:\t\t%" PRIu64
+                "\nBytes read:\t\t%" PRIu64 "\nBytes written:\t\t%" PRIu64 "\n",
+                cache_dir(), stats.hits, stats.misses, stats.stale, stats.saves, stats.save_skips,
+                stats.bytes_read, stats.bytes_written);
+  } else {
+    outbuf_addv(out, "%-20s %8" PRIu64 " hits, %" PRIu64 " misses, %" PRIu64 " stale\n",
+                "Program cache", stats.hits, stats.misses, stats.stale);
+  }
+  return 0;
+}
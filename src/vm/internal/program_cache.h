@@ -0,0 +1,66 @@
+#ifndef PROGRAM_CACHE_H
+#define PROGRAM_CACHE_H
+
+#include <cstdint>
+
+/*
+ * On-disk cache of compiled programs.
+ *
+ * When the 'program cache directory' config is set, load_object() stores
+ * every program it compiles from a file as a relocatable image, and on a
+ * later load of the same file uses that image instead of running the
+ * compiler. An image is only used while all of these still hold:
+ *
+ *   - the driver build matches (struct layouts, opcode/efun numbering),
+ *   - the compile environment matches (predefines, include dirs, the
+ *     simul_efun slot numbering),
+ *   - the source file and every #include'd file have the same mtime and
+ *     size as when the program was compiled,
+ *   - every master apply the compiler made (include_file, inherit_program,
+ *     get_include_path, valid_override) gives the same answer when
+ *     replayed,
+ *   - every inherited program, once loaded, has the same layout (function
+ *     and variable tables) it had at compile time.
+ *
+ * Anything else makes the image stale; load_object() then compiles as
+ * usual and overwrites it. Images are written to a temporary file and
+ * renamed into place, so a crash mid-save never leaves a torn image.
+ */
+
+struct program_t;
+struct stat;
+struct outbuffer_t;
+struct svalue_t;
+
+struct program_cache_stats_t {
+  uint64_t hits;       // programs restored from an image
+  uint64_t misses;     // no image on disk
+  uint64_t stale;      // image present but out of date or unreadable
+  uint64_t saves;      // images written
+  uint64_t save_skips; // compiles not cached (pragma, master veto, ...)
+  uint64_t bytes_read;
+  uint64_t bytes_written;
+};
+
+// Whether the cache is configured at all.
+bool program_cache_enabled();
+
+// Restore the program compiled from `real_name` (a mudlib-relative path)
+// for the object file name `obname` (as passed to the compiler). `src_st`
+// is the source file's stat(). May load inherited objects, so it can
+// error() like any load. Returns nullptr on a miss or a stale image.
+program_t* program_cache_load(const char* real_name, const char* obname,
+                              const struct stat& src_st);
+
+// Store `prog`, just compiled from `real_name`, using the compile facts
+// g_compile still holds. Failures are logged and otherwise ignored.
+void program_cache_save(program_t* prog, const char* real_name, const struct stat& src_st);
+
+// Digest of a master apply's return value, as logged by
+// compile_apply_master(); 0 when the value can't be compared later.
+uint64_t program_cache_digest(struct svalue_t* ret);
+
+const program_cache_stats_t& program_cache_stats();
+uint64_t program_cache_status(outbuffer_t* out, int verbose);
+
+#endif
@@ -75,6 +75,14 @@ void init_simul_efun(const char* file) {
   set_simul_efun(new_ob);
 }
 
+std::vector<const char*> simul_efun_slot_names() {
+  std::vector<const char*> names(num_simul_efun, nullptr);
+  for (int i = 0; i < num_simul_efun; i++) {
+    names[simul_names[i].index] = simul_names[i].name;
+  }
+  return names;
+}
+
 static void remove_simuls() {
   int i;
   ident_hash_elem_t* ihe;
@@ -1,6 +1,8 @@
 #ifndef SIMUL_EFUN_H
 #define SIMUL_EFUN_H
 
+#include <vector>
+
 /*
  * simul_efun.c
  */
@@ -12,6 +14,10 @@ void init_simul_efun(const char*);
 void set_simul_efun(struct object_t*);
 void rebuild_simul_efuns();
 
+// Name of every simul_efun slot in runtime-index order, retired slots
+// included: compiled F_SIMUL_EFUN operands index into this numbering.
+std::vector<const char*> simul_efun_slot_names();
+
 #ifdef DEBUGMALLOC_EXTENSIONS
 void mark_simuls(void);
 #endif
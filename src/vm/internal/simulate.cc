@@ -28,6 +28,7 @@
 #include "vm/internal/base/debug.h"
 #include "vm/internal/master.h"
 #include "vm/internal/otable.h"
+#include "vm/internal/program_cache.h"
 #include "vm/internal/simul_efun.h"
 #include "compiler/internal/compiler.h"  // for compiler_next_load_reason
 #include "compiler/internal/lexer.h"     // for total_lines, FIXME
@@ -519,6 +520,23 @@ object_t* load_object(const char* lname, int callcreate) {
     error("Illegal path name '/%s'.\n", real_name);
   }
 
+  // A cached image skips the compile entirely. Restoring it may load
+  // inherited objects, which may in turn have loaded us.
+  prog = nullptr;
+  if (program_cache_enabled()) {
+    save_command_giver(command_giver);
+    prog = program_cache_load(real_name, obname, c_st);
+    restore_command_giver();
+    if (prog && (ob = ObjectTable::instance().find(name))) {
+      free_prog(&prog);
+      num_objects_this_thread--;
+      return ob;
+    }
+  }
+  if (prog) {
+    goto have_program;
+  }
+
   f = open(real_name, O_RDONLY);
 #ifdef _WIN32
   // TODO: change everything to use fopen instead.
@@ -626,6 +644,9 @@ object_t* load_object(const char* lname, int callcreate) {
     num_objects_this_thread--;
     return ob;
   }
+  program_cache_save(prog, real_name, c_st);
+
+have_program:
   ob = get_empty_object(prog->num_variables_total);
   /* Shared string is no good here */
   SETOBNAME(ob, alloc_cstring(name, "load_object"));
@@ -654,6 +675,7 @@ object_t* load_object(const char* lname, int callcreate) {
   if (!(ob->flags & O_DESTRUCTED) && function_exists(APPLY_CLEAN_UP, ob, 1)) {
     ob->flags |= O_WILL_CLEAN_UP;
   }
+  sweep_schedule_object(ob);
   restore_command_giver();
 
   if (ob) {
@@ -778,6 +800,7 @@ object_t* load_object_from_source(const std::string& source, const char* virtual
   if (!(ob->flags & O_DESTRUCTED) && function_exists(APPLY_CLEAN_UP, ob, 1)) {
     ob->flags |= O_WILL_CLEAN_UP;
   }
+  sweep_schedule_object(ob);
   restore_command_giver();
 
   ob->load_time = get_current_time();
@@ -1057,6 +1080,7 @@ int recompile_object(object_t* target) {
       } else {
         ob->flags &= ~O_WILL_CLEAN_UP;
       }
+      sweep_schedule_object(ob);
 #ifdef NO_ADD_ACTION
       if (function_exists(APPLY_CATCH_TELL, ob, 1) ||
           function_exists(APPLY_RECEIVE_MESSAGE, ob, 1)) {
@@ -1557,6 +1581,7 @@ void destruct_object(object_t* ob) {
   ob->next_all = nullptr;
   ob->prev_all = nullptr;
   set_heart_beat(ob, 0);
+  sweep_unschedule_object(ob);
   ob->flags |= O_DESTRUCTED;
   /* moved this here from destruct2() -- see comments in destruct2() */
   if (ob->interactive) {